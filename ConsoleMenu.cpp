@@ -1,4 +1,5 @@
 #include "ConsoleMenu.h"
+#include <chrono>
 
 InputMode GetInputModeFromChar(const char c)
 {
@@ -38,7 +39,10 @@ CONSOLE_MENU_TEXT_COMMAND_DEFINE(4, mArgs[0].c_str(), mArgs[1].c_str(), mArgs[2]
 
 void ConsoleMenu::ConsoleMenuCommandSubMenu::Execute()
 {
-    printf("\n\n");
+    if (!ConsoleMenu::sHeadless)
+    {
+        printf("\n\n");
+    }
     if (mPreOpenMenuFunc)
     {
         mPreOpenMenuFunc();
@@ -123,15 +127,14 @@ ConsoleMenu::~ConsoleMenu()
     mCommands.clear();
 }
 
+/*static*/ bool ConsoleMenu::sHeadless = false;
+/*static*/ bool ConsoleMenu::sHeadlessUnknownCommand = false;
+/*static*/ std::istream* ConsoleMenu::sScript = nullptr;
+
 void ConsoleMenu::RunMenu()
 {
     ResetMenu();
-
-    char c;
-    do
-    {
-        c = _getch();
-    } while (ReceiveInput(c));
+    ReceiveKeysUntilExit();
 }
 
 void ConsoleMenu::RunMenuDirectlyAtCommand(bool shouldExitAfterCommand, const char* const input)
@@ -151,15 +154,153 @@ void ConsoleMenu::RunMenuDirectlyAtCommand(bool shouldExitAfterCommand, const ch
     } while (c != '\0');
 
     EvaluateCommandInput();
+    ReceiveKeysUntilExit();
+}
+
+bool ConsoleMenu::RunCommandLine(const char* const line)
+{
+    bool bStillInMenu = true;
+    return ReceiveCommandLine(line, bStillInMenu);
+}
+
+bool ConsoleMenu::ReceiveCommandLine(const char* const line, bool& outStillInMenu)
+{
+    sHeadless = true;
+    ResetMenu();
+
+    outStillInMenu = true;
+    bool bSucceeded = true;
+    size_t pos = 0;
+    while (bSucceeded && (line[pos] != '\0'))
+    {
+        if (isspace((unsigned char)line[pos]))
+        {
+            ++pos;
+            continue;
+        }
+
+        const size_t tokenStart = pos;
+        while ((line[pos] != '\0') && !isspace((unsigned char)line[pos]))
+        {
+            ++pos;
+        }
+
+        const bool bIsCommandToken = (GetActiveMenu().mInputMode == InputMode::kCommand);
+        if (bIsCommandToken)
+        {
+            // Resolved whole first, so nothing runs for a token that only starts with a key
+            std::string key(line + tokenStart, pos - tokenStart);
+            std::transform(key.begin(), key.end(), key.begin(), [](char c) { return (char)tolower((unsigned char)c); });
+
+            ConsoleMenu& activeMenu = GetActiveMenu();
+            if ((key != "x") && (activeMenu.FindCommand(key) == nullptr))
+            {
+                printf("\nUnknown command \"%.*s\" in %s\n", (int)(pos - tokenStart), line + tokenStart, activeMenu.mDescription.c_str());
+                bSucceeded = false;
+                break;
+            }
+        }
+
+        sHeadlessUnknownCommand = false;
+        for (size_t tokenPos = tokenStart; outStillInMenu && !sHeadlessUnknownCommand && (tokenPos < pos); ++tokenPos)
+        {
+            outStillInMenu = ReceiveInput(line[tokenPos]);
+        }
+
+        if (outStillInMenu && !bIsCommandToken)
+        {
+            // Commits the argument
+            outStillInMenu = ReceiveInput('\r');
+        }
+
+        if (!outStillInMenu)
+        {
+            break;
+        }
+
+        ConsoleMenu& activeMenu = GetActiveMenu();
+        if (sHeadlessUnknownCommand || ((activeMenu.mInputMode == InputMode::kCommand) && (activeMenu.mCurrentPos > 0u)))
+        {
+            printf("\nUnknown command \"%.*s\" in %s\n", (int)(pos - tokenStart), line + tokenStart, activeMenu.mDescription.c_str());
+            bSucceeded = false;
+        }
+    }
+
+    ConsoleMenu& activeMenu = GetActiveMenu();
+    if (bSucceeded && (activeMenu.mInputMode != InputMode::kCommand) && (activeMenu.mInputMode != InputMode::kForceExit))
+    {
+        printf("\nMissing arguments for \"%s\" in %s\n", activeMenu.mCurrentCommand->GetCommand(), activeMenu.mDescription.c_str());
+        bSucceeded = false;
+    }
+
+    ResetMenu();
+    return bSucceeded;
+}
+
+bool ConsoleMenu::RunScript(std::istream& script)
+{
+    std::istream* const previousScript = sScript;
+    sScript = &script;
+
+    bool bSucceeded = true;
+    std::string line;
+    while (std::getline(script, line))
+    {
+        const size_t firstNonSpace = line.find_first_not_of(" \t\r");
+        if ((firstNonSpace == std::string::npos) || (line[firstNonSpace] == '#'))
+        {
+            continue;
+        }
+
+        bool bStillInMenu = true;
+        if (!ReceiveCommandLine(line.c_str(), bStillInMenu))
+        {
+            bSucceeded = false;
+        }
+        if (!bStillInMenu)
+        {
+            break;
+        }
+    }
+
+    sScript = previousScript;
+    return bSucceeded;
+}
+
+void ConsoleMenu::ReceiveKeysUntilExit()
+{
+    if (sHeadless)
+    {
+        RunScript(sScript ? *sScript : std::cin);
+        return;
+    }
+
+    char c;
     do
     {
         c = _getch();
     } while (ReceiveInput(c));
 }
 
+ConsoleMenu& ConsoleMenu::GetActiveMenu()
+{
+    ConsoleMenu* activeMenu = this;
+    while (activeMenu->mInputMode == InputMode::kSubMenu)
+    {
+        activeMenu = activeMenu->mCurrentSubMenu;
+    }
+    return *activeMenu;
+}
+
 void ConsoleMenu::ResetMenu()
 {
     ClearInput();
+    mInputMode = InputMode::kCommand;
+    mExitAfterCommandExecution = false;
+    if (sHeadless)
+    {
+        return;
+    }
 
     putchar('\n');
     PrintHorizontalBreak();
@@ -177,9 +318,6 @@ void ConsoleMenu::ResetMenu()
     {
         printf(" x = Exit\n\n");
     }
-
-    mInputMode = InputMode::kCommand;
-    mExitAfterCommandExecution = false;
 }
 
 void ConsoleMenu::PrintHorizontalBreak()
@@ -281,33 +419,71 @@ bool ConsoleMenu::ReceiveInput(char c)
     return true;
 }
 
+void ConsoleMenu::PushCommand(ConsoleMenuCommandI* command)
+{
+    // Keys run as soon as they're typed in full, so a key that starts another one would always win.
+    // x as the first key exits the menu instead of typing
+    const std::string key = command->GetCommand();
+    if (key.empty() || (key[0] == 'x'))
+    {
+        printf("\nNot adding \"%s\" to %s: keys can't be empty or start with x, which exits the menu\n", key.c_str(), mDescription.c_str());
+        delete command;
+        return;
+    }
+
+    for (const ConsoleMenuCommandI* existingCommand : mCommands)
+    {
+        const std::string existingKey = existingCommand->GetCommand();
+        if (existingKey.starts_with(key) || key.starts_with(existingKey))
+        {
+            printf("\nNot adding \"%s\" to %s: it can't be typed apart from \"%s\"\n", key.c_str(), mDescription.c_str(), existingKey.c_str());
+            delete command;
+            return;
+        }
+    }
+
+    mCommands.push_back(command);
+}
+
+ConsoleMenuCommandI* ConsoleMenu::FindCommand(const std::string& key) const
+{
+    for (ConsoleMenuCommandI* command : mCommands)
+    {
+        if (key == command->GetCommand())
+        {
+            return command;
+        }
+    }
+    return nullptr;
+}
+
 void ConsoleMenu::AddCommand(const char* const input, const char* const description, const FuncPtr0Num& func)
 {
-    mCommands.push_back(new ConsoleMenuCommand0Num(input, description, func));
+    PushCommand(new ConsoleMenuCommand0Num(input, description, func));
 }
 
 void ConsoleMenu::AddSubmenu(const char* const input, ConsoleMenu& subMenu)
 {
-    mCommands.push_back(new ConsoleMenuCommandSubMenu(input, subMenu));
+    PushCommand(new ConsoleMenuCommandSubMenu(input, subMenu));
 }
 
 void ConsoleMenu::AddSubmenu(const char* const input, ConsoleMenu& subMenu, const char* const description)
 {
-    mCommands.push_back(new ConsoleMenuCommandSubMenu(input, subMenu, description));
+    PushCommand(new ConsoleMenuCommandSubMenu(input, subMenu, description));
 }
 
 void ConsoleMenu::AddSubmenu(const char* const input, ConsoleMenu& subMenu, const char* const description, FuncPtr0Num preOpenMenuFunc)
 {
     ConsoleMenuCommandSubMenu* subMenuCommand = new ConsoleMenuCommandSubMenu(input, subMenu, description);
     subMenuCommand->SetPreOpenMenuFunc(preOpenMenuFunc);
-    mCommands.push_back(subMenuCommand);
+    PushCommand(subMenuCommand);
 }
 
 void ConsoleMenu::AddSubmenu(const char* const input, ConsoleMenu& subMenu, FuncPtr0Num preOpenMenuFunc)
 {
     ConsoleMenuCommandSubMenu* subMenuCommand = new ConsoleMenuCommandSubMenu(input, subMenu);
     subMenuCommand->SetPreOpenMenuFunc(preOpenMenuFunc);
-    mCommands.push_back(subMenuCommand);
+    PushCommand(subMenuCommand);
 }
 
 void ConsoleMenu::ReceiveCommandInput(char c)
@@ -355,6 +531,7 @@ void ConsoleMenu::EvaluateCommandInput()
 
     if (partialMatches == 0u)
     {
+        sHeadlessUnknownCommand = sHeadless;
         ClearInput();
     }
 }
@@ -461,16 +638,22 @@ void ConsoleMenu::StartParamInput()
 {
     const ConsoleMenuCommandInput& input = mCurrentCommand->GetInput(mCurrentParam);
     ++mCurrentParam;
-    printf("%s (Param %zu):\n", input.mDescription.c_str(), mCurrentParam);
+    if (!sHeadless)
+    {
+        printf("%s (Param %zu):\n", input.mDescription.c_str(), mCurrentParam);
+    }
 
     ConvertModeTo((input.mInputMode == InputMode::kInvalid ? InputMode::kDecimal : input.mInputMode));
 }
 
 void ConsoleMenu::PutInput(char c)
 {
-    if ((mCurrentPos < sizeof(mInputBuffer)) && (c >= '!') && (c <= '~'))
+    if ((mCurrentPos < sizeof(mInputBuffer) - 1) && (c >= '!') && (c <= '~'))
     {
-        putchar(c);
+        if (!sHeadless)
+        {
+            putchar(c);
+        }
         mInputBuffer[mCurrentPos] = c;
         ++mCurrentPos;
         mInputBuffer[mCurrentPos] = '\0';
@@ -481,7 +664,10 @@ void ConsoleMenu::BackspaceLastInput()
 {
     if (mCurrentPos > 0u)
     {
-        printf("\b \b");
+        if (!sHeadless)
+        {
+            printf("\b \b");
+        }
         --mCurrentPos;
         mInputBuffer[mCurrentPos] = '\0';
     }
@@ -491,7 +677,10 @@ void ConsoleMenu::ClearInput()
 {
     while (mCurrentPos > 0u)
     {
-        printf("\b \b");
+        if (!sHeadless)
+        {
+            printf("\b \b");
+        }
         --mCurrentPos;
     }
     mInputBuffer[0] = '\0';
@@ -501,14 +690,23 @@ void ConsoleMenu::StartNewInputOnNewLine()
 {
     mInputBuffer[0] = '\0';
     mCurrentPos = 0;
-    putchar('\n');
+    if (!sHeadless)
+    {
+        putchar('\n');
+    }
 }
 
 void ConsoleMenu::ExecuteCurrentCommand()
 {
     printf("\n");
+    const auto startTime = std::chrono::steady_clock::now();
     mCurrentCommand->Execute();
     printf("\n");
+    if (sHeadless)
+    {
+        const std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - startTime;
+        printf("[%s %s: %.3f s]\n", mDescription.c_str(), mCurrentCommand->GetCommand(), seconds.count());
+    }
 
     if (mExitAfterCommandExecution)
     {
@@ -137,13 +137,13 @@ private:
 
 #define CONSOLE_MENU_COMMAND_DEFINE(NUMARGS, ...) \
 void ConsoleMenu::AddCommand(const char* const input, const char* const description, const FuncPtr##NUMARGS##Num& func) \
-{ mCommands.push_back(new ConsoleMenuCommand##NUMARGS##Num(input, description, func)); } \
+{ PushCommand(new ConsoleMenuCommand##NUMARGS##Num(input, description, func)); } \
 void ConsoleMenu::AddCommand(const char* const input, const char* const description, const FuncPtr##NUMARGS##Num& func, const ValidateFuncPtr##NUMARGS##Num& validateFunc) \
-{ mCommands.push_back(new ConsoleMenuCommand##NUMARGS##Num(input, description, func, validateFunc)); } \
+{ PushCommand(new ConsoleMenuCommand##NUMARGS##Num(input, description, func, validateFunc)); } \
 void ConsoleMenu::AddCommand(FuncPtr0Num preArgsFunc, const char* const input, const char* const description, const FuncPtr##NUMARGS##Num& func) \
-{ mCommands.push_back(new ConsoleMenuCommand##NUMARGS##Num(preArgsFunc, input, description, func)); } \
+{ PushCommand(new ConsoleMenuCommand##NUMARGS##Num(preArgsFunc, input, description, func)); } \
 void ConsoleMenu::AddCommand(FuncPtr0Num preArgsFunc, const char* const input, const char* const description, const FuncPtr##NUMARGS##Num& func, const ValidateFuncPtr##NUMARGS##Num& validateFunc) \
-{ mCommands.push_back(new ConsoleMenuCommand##NUMARGS##Num(preArgsFunc, input, description, func, validateFunc)); } \
+{ PushCommand(new ConsoleMenuCommand##NUMARGS##Num(preArgsFunc, input, description, func, validateFunc)); } \
 void ConsoleMenu::ConsoleMenuCommand##NUMARGS##Num::PreArgsExecute() \
 { if (mPreArgsFunc) { mPreArgsFunc(); } } \
 void ConsoleMenu::ConsoleMenuCommand##NUMARGS##Num::Execute() \
@@ -180,9 +180,9 @@ ValidateResponse ConsoleMenu::ConsoleMenuCommand##NUMARGS##Num::ValidateArgs() \
 
 #define CONSOLE_MENU_TEXT_COMMAND_DEFINE(NUMARGS, ...) \
 void ConsoleMenu::AddCommand(const char* const input, const char* const description, const FuncPtrText##NUMARGS##Num& func) \
-{ mCommands.push_back(new ConsoleMenuCommandText##NUMARGS##Num(input, description, func)); } \
+{ PushCommand(new ConsoleMenuCommandText##NUMARGS##Num(input, description, func)); } \
 void ConsoleMenu::AddCommand(const char* const input, const char* const description, const FuncPtrText##NUMARGS##Num& func, const ValidateFuncPtrText##NUMARGS##Num& validateFunc) \
-{ mCommands.push_back(new ConsoleMenuCommandText##NUMARGS##Num(input, description, func, validateFunc)); } \
+{ PushCommand(new ConsoleMenuCommandText##NUMARGS##Num(input, description, func, validateFunc)); } \
 void ConsoleMenu::ConsoleMenuCommandText##NUMARGS##Num::Execute() \
 { mFunc( __VA_ARGS__ ); } \
 ValidateResponse ConsoleMenu::ConsoleMenuCommandText##NUMARGS##Num::ValidateArgs() \
@@ -209,6 +209,18 @@ public:
     void RunMenu();
     void RunMenuDirectlyAtCommand(bool shouldExitAfterCommand, const char* const input);
 
+    /**
+    * Headless mode: no menus, prompts or echo, and every command executed prints how long it took.
+    * A command line is the keys that would be typed from this menu, split by whitespace, e.g. "f m 1000000".
+    * Command tokens pick commands and submenus, every other token is one argument (so text arguments can't hold spaces).
+    * A command token must be a whole key (or x), otherwise the line stops there without running it.
+    * Each line starts back at this menu. Returns false if a line had an unknown command or was missing arguments.
+    * A script stops early at a line that exits this menu (x).
+    * Once headless, menus run from inside commands (RunMenu) read their command lines from stdin.
+    **/
+    bool RunCommandLine(const char* const line);
+    bool RunScript(std::istream& script); // One command line per line. Blank lines and lines starting with # are skipped
+
     void AddCommand(const char* const input, const char* const description, const FuncPtr0Num& func);
     CONSOLE_MENU_COMMAND_DECLARE(1, uint64_t);
     CONSOLE_MENU_COMMAND_DECLARE(2, uint64_t, uint64_t);
@@ -253,6 +265,13 @@ public:
     void AddSubmenu(const char* const input, ConsoleMenu& subMenu, const char* const description, FuncPtr0Num preOpenMenuFunc);
 
 private:
+    void PushCommand(ConsoleMenuCommandI* command); // Takes ownership. Deleted instead if its key can't be typed, see the definition
+    ConsoleMenuCommandI* FindCommand(const std::string& key) const; // Exact match only
+
+    void ReceiveKeysUntilExit();
+    bool ReceiveCommandLine(const char* const line, bool& outStillInMenu);
+    ConsoleMenu& GetActiveMenu();
+
     void ResetMenu();
     void PrintHorizontalBreak();
     bool ReceiveInput(char c);
@@ -273,6 +292,10 @@ private:
     void StartNewInputOnNewLine();
     void ExecuteCurrentCommand();
 
+    static bool sHeadless;
+    static bool sHeadlessUnknownCommand; // Set instead of silently dropping the key
+    static std::istream* sScript; // Script being run, so nested menus keep reading from it instead of std::cin
+
     InputMode mInputMode = InputMode::kCommand;
     bool mExitAfterCommandExecution = false;
 
@@ -1,4 +1,5 @@
 #pragma once
+#include <bit>
 
 namespace LazyElementShuffler
 {
@@ -82,7 +83,7 @@ namespace LazyElementShuffler
     template<Bits tMinFactorial, Bits tMaxFactorial>
     constexpr Bits FactorialRange(Size m)
     {
-        const SetSize offsetFromMinFactorial = m - tMinFactorial.AsSetSize();
+        const Size offsetFromMinFactorial = m - tMinFactorial.AsSize();
         switch (offsetFromMinFactorial)
         {
             // Uncomment this to see the constexpr fail for running out of bit space
@@ -177,45 +178,156 @@ namespace LazyElementShuffler
         return cBlocks[index];
     }
 
-    template<Size tBitSourceSize, Size tSetSize>
-    constexpr void FillPermutationFromFixedSet(const std::array<UInt, tBitSourceSize>& bitSource, std::array<Size, 1>& outPermutation)
+    /**
+    * SplitMix64: expands one seed into a stream of well mixed words
+    */
+    constexpr UInt NextSplitMix(UInt& inOutState)
     {
-        
+        UInt z = (inOutState += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
     }
 
     template<Size tBitSourceSize>
-    constexpr void FillPermutation(Size setSize, const std::array<UInt, tBitSourceSize>& bitSource, std::array<Size, 1>& outPermutation)
+    constexpr UInt FoldBitSource(const std::array<UInt, tBitSourceSize>& bitSource)
     {
-
+        UInt state = 0;
+        UInt seed = 0;
+        for (const UInt bits : bitSource)
+        {
+            state ^= bits;
+            seed = NextSplitMix(state);
+        }
+        return seed;
     }
 
+    /**
+    * A seeded bijection over [0, setSize) for any 64 bit set size, evaluated one index at a time in constant memory.
+    * Nothing is materialized, so a shuffled order of 10^12 items can be walked, or jumped into, directly.
+    *
+    * Sets of up to 256 are shuffled for real, with a Fisher-Yates shuffle driven by the seed, and kept as a table. A Feistel
+    * network over only a few bits is far from uniform: with 3 bit halves, Get(0) and Get(1) of a 21 set were off by z~80.
+    * Larger sets use a balanced Feistel network over the smallest even number of bits that covers the set, which is a
+    * bijection on that power of 2 whatever its round function. Each round hashes the half with its own key and round
+    * number. Results past the set size are fed back in (cycle walking) until they land inside it, which stays a bijection
+    * on the set and takes under 4 passes of the network on average.
+    * Indexes outside the set are returned unchanged.
+    */
     class ArbitraryShuffler
     {
     public:
+        static constexpr Size cNumRounds = 8;
+        static constexpr Size cMaxPermutationSetSize = 256;
+
         constexpr ArbitraryShuffler() {}
 
+        constexpr ArbitraryShuffler(UInt setSize, UInt seed)
+            : mSetSize(setSize)
+        {
+            if (setSize <= cMaxPermutationSetSize)
+            {
+                FillSmallPermutation(seed);
+                mShuffleMode = ShuffleMode::Permutation;
+                return;
+            }
 
-    private:
-        enum class ShuffleDataSize : uint8_t
+            // Half of the bits covering [0, setSize), rounded up
+            const UInt halfBits = (std::bit_width(setSize - 1) + 1) / 2;
+            mHalfBits = (Byte)halfBits;
+            mHalfMask = (UInt(1) << halfBits) - 1;
+
+            UInt state = seed;
+            for (UInt& roundKey : mRoundKeys)
+            {
+                roundKey = NextSplitMix(state);
+            }
+            mShuffleMode = ShuffleMode::Feistel;
+        }
+
+        [[nodiscard]] constexpr UInt Get(UInt index) const
         {
-            Single,
-            Small,
-            Large
-        };
+            if (index >= mSetSize)
+            {
+                return index;
+            }
+
+            switch (mShuffleMode)
+            {
+            case ShuffleMode::Permutation:
+                return mSmallPermutation[index];
 
+            case ShuffleMode::Feistel:
+            {
+                do
+                {
+                    index = Encrypt(index);
+                } while (index >= mSetSize);
+                return index;
+            }
+
+            default:
+                return index;
+            }
+        }
+
+        [[nodiscard]] constexpr UInt GetSetSize() const { return mSetSize; }
+
+    private:
         enum class ShuffleMode : uint8_t
         {
             None,
-            CoinFlip,
             Permutation,
-            PermutationExtended,
-            RepeatedShuffling,
-            RepeatedShufflingWithBlockMixing
+            Feistel
         };
 
+        constexpr void FillSmallPermutation(UInt seed)
+        {
+            for (Size position = 0; position < mSetSize; ++position)
+            {
+                mSmallPermutation[position] = (Byte)position;
+            }
 
-        Size mSetSize = 0;
-        UInt mPermutationMultiplier = 0;
+            UInt state = seed;
+            for (Size nextEntry = (Size)mSetSize; nextEntry > 1; --nextEntry)
+            {
+                // Words below the threshold would make the lower remainders more likely
+                const UInt threshold = (0 - (UInt)nextEntry) % nextEntry;
+                UInt randomWord = NextSplitMix(state);
+                while (randomWord < threshold)
+                {
+                    randomWord = NextSplitMix(state);
+                }
+                std::swap(mSmallPermutation[nextEntry - 1], mSmallPermutation[randomWord % nextEntry]);
+            }
+        }
+
+        constexpr UInt RoundFunction(UInt half, UInt roundKey, Size round) const
+        {
+            UInt z = (half + (round * 0x9E3779B97F4A7C15ull)) ^ roundKey;
+            z = (z ^ (z >> 33)) * 0xFF51AFD7ED558CCDull;
+            z = (z ^ (z >> 33)) * 0xC4CEB9FE1A85EC53ull;
+            return (z ^ (z >> 33)) & mHalfMask;
+        }
+
+        constexpr UInt Encrypt(UInt value) const
+        {
+            UInt left = value >> mHalfBits;
+            UInt right = value & mHalfMask;
+            for (Size round = 0; round < cNumRounds; ++round)
+            {
+                const UInt newRight = left ^ RoundFunction(right, mRoundKeys[round], round);
+                left = right;
+                right = newRight;
+            }
+            return (left << mHalfBits) | right;
+        }
+
+        UInt mSetSize = 0;
+        UInt mHalfMask = 0;
+        std::array<UInt, cNumRounds> mRoundKeys = {};
+        std::array<Byte, cMaxPermutationSetSize> mSmallPermutation = {};
+        Byte mHalfBits = 0;
         ShuffleMode mShuffleMode = ShuffleMode::None;
     };
 
@@ -224,17 +336,16 @@ namespace LazyElementShuffler
     {
     public:
         constexpr FixedSetStackShuffler(const std::array<UInt, tBitSourceSize>& bitSource)
-        {
-            FillPermutationFromFixedSet<tBitSourceSize, tSetSize>(bitSource, mPermutation);
-        }
+            : mShuffler(tSetSize, FoldBitSource(bitSource))
+        {}
 
-        constexpr UInt Get(UInt index) const
+        [[nodiscard]] constexpr UInt Get(UInt index) const
         {
-            return index;
+            return mShuffler.Get(index);
         }
 
     private:
-        std::array<Size, 1> mPermutation;
+        ArbitraryShuffler mShuffler;
     };
 
     template<Size tBitSourceSize>
@@ -242,30 +353,18 @@ namespace LazyElementShuffler
     {
     public:
         constexpr StackShuffler(Size setSize, const std::array<UInt, tBitSourceSize>& bitSource)
-        {
-            FillPermutation<tBitSourceSize>(setSize, bitSource, mPermutation);
-        }
+            : mShuffler(setSize, FoldBitSource(bitSource))
+        {}
 
-        constexpr UInt Get(UInt index) const
+        [[nodiscard]] constexpr UInt Get(UInt index) const
         {
-            return index;
+            return mShuffler.Get(index);
         }
 
     private:
-        std::array<Size, 1> mPermutation;
+        ArbitraryShuffler mShuffler;
     };
 
-
-
-
-
-
-
-
-
-
-
-
     class SetRandomizerInternal
     {
     public:
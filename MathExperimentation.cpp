@@ -3,17 +3,25 @@
 #include "ConsoleInfo.h"
 #include "ConsoleMenu.h"
 
+#include <chrono>
 #include <ctime>
 #include <windows.h>
 
 #include "RNG.h"
 #include "Stats.h"
+#include "WPBatchScenario.h"
+#include "WPCatalog.h"
 #include "WPChallenge.h"
+#include "WPComparison.h"
+#include "WPDice.h"
+#include "WPExactSolver.h"
 #include "WPWorker.h"
 #include "WPScenario.h"
+#include "WPSweep.h"
 #include "SmallestSquare.h"
 #include "SquareContainmentMenu.h"
 #include "SetRandomizerMenu.h"
+#include "SetRandomizerQuality.h"
 
 RNG* gRng = nullptr;
 
@@ -66,6 +74,104 @@ void DefenderNextCardVariation()
 	printf("\nCard Variation: %d\n", gDefenderCardVariation);
 }
 
+/**
+ * The catalog against the worker stats and card variations that used to be hardcoded (WPWorker::SetupStatsFromWorkerType
+ * and WPExecutionResources::AddCardVariation), so editing Data/WPCatalog.txt by accident shows up
+ */
+void WorkerPlacementTestCatalog()
+{
+	struct OriginalCard
+	{
+		int32_t mCardLevel;
+		const char* mCardName;
+		std::vector<CardEffectAndMagnitude> mCardEffectsAndMagnitude;
+	};
+
+	const std::array<WPWorkerStats, +WorkerType::Count> originalWorkerStats =
+	{ {
+		{ 0, 1, 4, 3, 1, 1 }, // Basic
+		{ 10, 2, 6, 4, 1, 1 }, // Trained
+		{ 20, 3, 8, 6, 1, 1 }, // Warrior
+		{ 30, 2, 6, 4, 2, 2 }, // Rogue
+	} };
+
+	const std::vector<OriginalCard> originalDefaultDeck =
+	{
+		{ 1, "Reroll 2 Dice", { { CardEffect::RerollDice, 2 } } },
+		{ 1, "Extra Eval Next Turn", { { CardEffect::ExtraEvaluate, 1 } } },
+		{ 1, "+50 skill", { { CardEffect::TempSkill, 50 } } },
+		{ 1, "Heal 1", { { CardEffect::Heal, 1 } } },
+	};
+
+	// Each variation swapped the last default card for this one, at the front
+	const std::vector<OriginalCard> originalVariationCards =
+	{
+		{ 2, "Draw a Card, +1 Temp Bonus Result", { { CardEffect::DrawCard, 1 }, { CardEffect::TempBonusResult, 1 } } },
+		{ 2, "Swap Opponent Dice", { { CardEffect::SwapOpponentDice, 1 } } },
+		{ 2, "Force 1 Damage", { { CardEffect::ForceDamage, 1 } } },
+		{ 2, "+1 Permanent Damage", { { CardEffect::PermanentDamage, 1 } } },
+		{ 2, "+2x Eval Next Turn", { { CardEffect::ExtraEvaluate, 2 } } },
+		{ 2, "Heal 3", { { CardEffect::Heal, 3 } } },
+		{ 2, "Reroll 4 Dice", { { CardEffect::RerollDice, 4 } } },
+		{ 2, "+20 ONLY PERMANENT BONUS", {} },
+		{ 2, "Exchange Dice for Super Dice", { { CardEffect::ReplaceWithRandomEffectDice, 1 } } },
+	};
+
+	const WPCatalog& catalog = WPCatalog::Get();
+	int32_t numErrors = catalog.IsValid() ? 0 : 1;
+
+	for (WorkerType workerType = WorkerType::Basic; workerType < WorkerType::Count; ++workerType)
+	{
+		const WPWorkerStats& stats = catalog.GetWorkerStats(workerType);
+		const WPWorkerStats& original = originalWorkerStats[+workerType];
+		if ((stats.mSkill != original.mSkill) || (stats.mDamage != original.mDamage) || (stats.mHealth_Max != original.mHealth_Max)
+			|| (stats.mHold != original.mHold) || (stats.mFlee != original.mFlee) || (stats.mStartingHandSize != original.mStartingHandSize))
+		{
+			printf("\n%s stats differ from the original", WPWorker::GetWorkerTypeName(workerType));
+			++numErrors;
+		}
+	}
+
+	// One past the last variation too, which played the default deck
+	const int32_t numVariations = (int32_t)originalVariationCards.size() + 2;
+	for (int32_t variationId = 0; variationId < numVariations; ++variationId)
+	{
+		std::vector<const OriginalCard*> originalDeck;
+		if ((variationId > 0) && (variationId <= (int32_t)originalVariationCards.size()))
+		{
+			originalDeck.push_back(&originalVariationCards[variationId - 1]);
+		}
+		for (const OriginalCard& card : originalDefaultDeck)
+		{
+			originalDeck.push_back(&card);
+		}
+		originalDeck.resize(originalDefaultDeck.size());
+
+		const WPDeck& deck = catalog.GetDeck(variationId);
+		bool bMatches = (deck.mNumCards == (int32_t)originalDeck.size());
+		for (int32_t deckIndex = 0; bMatches && (deckIndex < deck.mNumCards); ++deckIndex)
+		{
+			const WPCard& card = catalog.GetCard(deck.mCardIndexes[deckIndex]);
+			const OriginalCard& original = *originalDeck[deckIndex];
+			WPCard originalCard(original.mCardLevel, original.mCardName, original.mCardEffectsAndMagnitude);
+			bMatches = (card.mCardLevel == originalCard.mCardLevel) && (card.mCardName == originalCard.mCardName)
+				&& (card.GetCardEffectMask() == originalCard.GetCardEffectMask());
+			for (CardEffect cardEffect = (CardEffect)0; bMatches && (cardEffect < CardEffect::Count); ++cardEffect)
+			{
+				bMatches = (card.GetMagnitude(cardEffect) == originalCard.GetMagnitude(cardEffect));
+			}
+		}
+
+		if (!bMatches)
+		{
+			printf("\nCard variation %d differs from the original", variationId);
+			++numErrors;
+		}
+	}
+
+	printf("\n%s\n", (numErrors == 0) ? "Catalog matches the original workers and decks" : "Catalog does NOT match the original workers and decks");
+}
+
 void WorkerPlacementDiceTest()
 {
 	WPScenario testScenario(*gRng);
@@ -108,6 +214,254 @@ void WorkerPlacementMultipleRuns(uint64_t numRuns)
 	testScenario.MultiExecute(numRuns);
 }
 
+void WorkerPlacementExportStats(uint64_t numRuns)
+{
+	printf("\nRunning...\n");
+	Stats stats;
+	WPScenario testScenario(*gRng, &stats);
+
+	testScenario.GetAttacker().SetWorkerType(gAttackerWorkerType);
+	testScenario.GetDefender().SetWorkerType(gDefenderWorkerType);
+
+	testScenario.GetAttacker().SetArbitraryCardVariation(gAttackerCardVariation);
+	testScenario.GetDefender().SetArbitraryCardVariation(gDefenderCardVariation);
+
+	testScenario.SetPrintType(ScenarioPrintType::MultiExecute);
+	testScenario.MultiExecute(numRuns);
+
+	char runLabel[128];
+	snprintf(runLabel, sizeof(runLabel), "%s %d vs %s %d, %" PRIu64 " fights",
+		ToString(gAttackerWorkerType).c_str(), gAttackerCardVariation, ToString(gDefenderWorkerType).c_str(), gDefenderCardVariation, numRuns);
+
+	static const char* const kFileNames[+StatsExportFormat::Count] =
+	{
+		"Data/FightStats.csv",
+		"Data/FightStats.jsonl",
+		"Data/FightStats.bin"
+	};
+	const StatsSnapshot snapshot = stats.TakeSnapshot();
+	for (StatsExportFormat format = StatsExportFormat::Csv; format < StatsExportFormat::Count; ++format)
+	{
+		if (snapshot.Export(kFileNames[+format], format, runLabel))
+		{
+			printf("\nAppended to %s", kFileNames[+format]);
+		}
+	}
+	printf("\n");
+}
+
+void WorkerPlacementMergeExportedStats()
+{
+	static const char* const sSummaryNames[] = { "Roll Values", "Fight Rounds", "Winner Health" };
+
+	std::ifstream file("Data/FightStats.bin", std::ios::binary);
+	if (!file.is_open())
+	{
+		printf("\nCould not open Data/FightStats.bin\n");
+		return;
+	}
+	const std::string bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	// Moments and quantile sketches merge exactly, so this is as if every run had been one
+	std::map<int32_t, StatsSummary> mergedSummaries;
+	std::string_view remaining = bytes;
+	std::string runLabel;
+	StatsSnapshot snapshot;
+	int32_t numRuns = 0;
+	while (StatsSnapshot::ReadBinary(remaining, runLabel, snapshot))
+	{
+		for (const StatsSnapshot::Summary& summary : snapshot.mSummaries)
+		{
+			mergedSummaries[summary.mId].Merge(summary.mSummary);
+		}
+		++numRuns;
+	}
+
+	printf("\n%d runs merged", numRuns);
+	if (!remaining.empty())
+	{
+		printf(", the last %zu bytes aren't a version %u record", remaining.size(), StatsSnapshot::cBinaryVersion);
+	}
+	for (const auto& [summaryId, summary] : mergedSummaries)
+	{
+		summary.Print(((summaryId >= 0) && (summaryId < (int32_t)std::size(sSummaryNames))) ? sSummaryNames[summaryId] : "Unknown");
+	}
+	printf("\n");
+}
+
+static const char* const kScenarioResultNames[+ScenarioResult::Count] =
+{
+	"Stalls",
+	"Defender Wins",
+	"Attacker Wins",
+	"Defender Flees",
+	"Attacker Flees",
+	"Both Flees"
+};
+
+void WorkerPlacementExactSolve(uint64_t numOpenings)
+{
+	printf("\nRunning...\n");
+	WPExactSolver solver;
+	WPScenario& solverScenario = solver.GetScenario();
+	solverScenario.GetAttacker().SetWorkerType(gAttackerWorkerType);
+	solverScenario.GetDefender().SetWorkerType(gDefenderWorkerType);
+	solverScenario.GetAttacker().SetArbitraryCardVariation(gAttackerCardVariation);
+	solverScenario.GetDefender().SetArbitraryCardVariation(gDefenderCardVariation);
+
+	const std::chrono::high_resolution_clock::time_point startTime = std::chrono::high_resolution_clock::now();
+	const WPOutcomeDistribution solved = solver.SolveSampledOpenings(numOpenings, gRng->RandomNumber());
+	const double solveSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+
+	// Sampled fights in the same time, to compare against
+	WPScenario sampledScenario(*gRng);
+	sampledScenario.GetAttacker().SetWorkerType(gAttackerWorkerType);
+	sampledScenario.GetDefender().SetWorkerType(gDefenderWorkerType);
+	sampledScenario.GetAttacker().SetArbitraryCardVariation(gAttackerCardVariation);
+	sampledScenario.GetDefender().SetArbitraryCardVariation(gDefenderCardVariation);
+
+	std::array<uint64_t, +ScenarioResult::Count> sampledResults = {};
+	uint64_t numSampled = 0;
+	while ((numSampled < 1000) || (std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count() < 2.0 * solveSeconds))
+	{
+		for (int32_t i = 0; i < 1000; ++i)
+		{
+			sampledResults[+sampledScenario.Execute()]++;
+		}
+		numSampled += 1000;
+	}
+
+	printf("\n%-15s %-18s %-18s\n", "", "Exact/Opening", "Sampled Fights");
+	for (ScenarioResult result = ScenarioResult::Stall; result < ScenarioResult::Count; ++result)
+	{
+		printf("%-15s %6.2f%% +-%5.2f%%   %6.2f%% +-%5.2f%%\n", kScenarioResultNames[+result],
+			solved.GetProbability(result) * 100.0, solved.mHalfWidths[+result] * 100.0,
+			(double)sampledResults[+result] * 100.0 / (double)numSampled, WPSweep::GetConfidenceHalfWidth(sampledResults[+result], numSampled) * 100.0);
+	}
+	printf("%" PRIu64 " openings solved with %" PRIu64 " replays, %" PRIu64 " fights sampled (%.2fs each)\n",
+		numOpenings, solved.mNumRuns, numSampled, solveSeconds);
+
+	// One opening solved exactly, checked against fights that all start from it
+	const WPOpeningFaces attackerFaces = WPDice::RandomOpeningFaces(*gRng);
+	const WPOpeningFaces defenderFaces = WPDice::RandomOpeningFaces(*gRng);
+	const WPOutcomeDistribution openingSolved = solver.SolveOpening(attackerFaces, defenderFaces);
+
+	sampledScenario.GetAttackerResources().SetFixedRollFaces(attackerFaces);
+	sampledScenario.GetDefenderResources().SetFixedRollFaces(defenderFaces);
+	constexpr uint64_t cNumOpeningFights = 100000;
+	std::array<uint64_t, +ScenarioResult::Count> openingResults = {};
+	for (uint64_t i = 0; i < cNumOpeningFights; ++i)
+	{
+		openingResults[+sampledScenario.Execute()]++;
+	}
+
+	printf("\nSingle opening:\n");
+	for (int32_t i = 0; i < cNumOpeningDice; ++i)
+	{
+		WPExecutionResources::MakeDieRoll((DiceType)(i / 2), attackerFaces[i]).Print();
+	}
+	printf(" vs ");
+	for (int32_t i = 0; i < cNumOpeningDice; ++i)
+	{
+		WPExecutionResources::MakeDieRoll((DiceType)(i / 2), defenderFaces[i]).Print();
+	}
+	printf("\n%-15s %-18s %-18s\n", "", "Exact", "Sampled Fights");
+	for (ScenarioResult result = ScenarioResult::Stall; result < ScenarioResult::Count; ++result)
+	{
+		printf("%-15s %6.2f%%            %6.2f%% +-%5.2f%%\n", kScenarioResultNames[+result],
+			openingSolved.GetProbability(result) * 100.0,
+			(double)openingResults[+result] * 100.0 / (double)cNumOpeningFights, WPSweep::GetConfidenceHalfWidth(openingResults[+result], cNumOpeningFights) * 100.0);
+	}
+}
+
+void WorkerPlacementCompareCardVariations(uint64_t cardVariationA, uint64_t cardVariationB, uint64_t numSamples)
+{
+	printf("\nRunning...\n");
+	WPMatchup matchupA;
+	matchupA.mAttackerType = gAttackerWorkerType;
+	matchupA.mDefenderType = gDefenderWorkerType;
+	matchupA.mAttackerCardVariation = (int32_t)cardVariationA;
+	matchupA.mDefenderCardVariation = gDefenderCardVariation;
+
+	WPMatchup matchupB = matchupA;
+	matchupB.mAttackerCardVariation = (int32_t)cardVariationB;
+
+	WPComparisonConfig plainConfig;
+	plainConfig.mNumSamples = numSamples;
+	plainConfig.mCommonRandomNumbers = false;
+	plainConfig.mAntitheticDice = false;
+	plainConfig.mStratifyOpenings = false;
+
+	WPComparisonConfig pairedConfig;
+	pairedConfig.mNumSamples = numSamples;
+
+	const uint32_t seed = gRng->RandomNumber();
+	const WPComparisonResult plainResult = WPComparison::Run(matchupA, matchupB, plainConfig, seed);
+	const WPComparisonResult pairedResult = WPComparison::Run(matchupA, matchupB, pairedConfig, seed);
+
+	printf("\nAttacker card variation %" PRIu64 " vs %" PRIu64 "\n", cardVariationA, cardVariationB);
+	printf("Independent: %.2f%% vs %.2f%%, difference %+.2f%% +-%.2f%% (%" PRIu64 " fights each)\n",
+		plainResult.mRateA * 100.0, plainResult.mRateB * 100.0, plainResult.mDifference * 100.0, plainResult.mHalfWidth * 100.0, plainResult.mNumFights);
+	printf("Paired:      %.2f%% vs %.2f%%, difference %+.2f%% +-%.2f%% (%" PRIu64 " fights each, worth %.0f independent fights)\n",
+		pairedResult.mRateA * 100.0, pairedResult.mRateB * 100.0, pairedResult.mDifference * 100.0, pairedResult.mHalfWidth * 100.0, pairedResult.mNumFights,
+		(double)pairedResult.mNumFights * pairedResult.GetVarianceReduction());
+}
+
+void WorkerPlacementBatchFights(uint64_t numFights)
+{
+	printf("\nRunning...\n");
+	WPMatchup matchup;
+	matchup.mAttackerType = gAttackerWorkerType;
+	matchup.mDefenderType = gDefenderWorkerType;
+	matchup.mAttackerCardVariation = gAttackerCardVariation;
+	matchup.mDefenderCardVariation = gDefenderCardVariation;
+	matchup.mAttackerDiceStrategy = WPBatchScenario::MakeLanedDiceStrategy();
+	matchup.mDefenderDiceStrategy = WPBatchScenario::MakeLanedDiceStrategy();
+	matchup.mAttackerCardStrategy.clear();
+	matchup.mDefenderCardStrategy.clear();
+
+	std::chrono::high_resolution_clock::time_point startTime = std::chrono::high_resolution_clock::now();
+	WPScenario scenario(*gRng);
+	matchup.Apply(scenario);
+	WPResultCounts scalarResults = {};
+	for (uint64_t i = 0; i < numFights; ++i)
+	{
+		scalarResults[+scenario.Execute()]++;
+	}
+	const double scalarSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+
+	startTime = std::chrono::high_resolution_clock::now();
+	WPBatchScenario batchScenario(*gRng, matchup);
+	WPResultCounts batchResults = {};
+	batchScenario.Run(numFights, batchResults);
+	const double batchSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+
+	printf("\n%-15s %-18s %-18s\n", "", "One at a time", "Batched");
+	for (ScenarioResult result = ScenarioResult::Stall; result < ScenarioResult::Count; ++result)
+	{
+		printf("%-15s %6.2f%% +-%5.2f%%   %6.2f%% +-%5.2f%%\n", kScenarioResultNames[+result],
+			(double)scalarResults[+result] * 100.0 / (double)numFights, WPSweep::GetConfidenceHalfWidth(scalarResults[+result], numFights) * 100.0,
+			(double)batchResults[+result] * 100.0 / (double)numFights, WPSweep::GetConfidenceHalfWidth(batchResults[+result], numFights) * 100.0);
+	}
+	printf("%.0f vs %.0f fights per second (%.1fx)\n", (double)numFights / scalarSeconds, (double)numFights / batchSeconds, scalarSeconds / batchSeconds);
+}
+
+void WorkerPlacementSweep(uint64_t maxCardVariation, uint64_t numThreads)
+{
+	printf("\nRunning...\n");
+	WPSweepConfig config = WPSweepConfig::MakeFullSweep((int32_t)maxCardVariation);
+	config.mNumThreads = (size_t)numThreads;
+
+	WPSweep sweep(config);
+	sweep.Run(gRng->RandomNumber());
+	sweep.PrintSummary();
+
+	if (sweep.WriteCSV("Data/FightSweep.csv"))
+	{
+		printf("Wrote Data/FightSweep.csv\n");
+	}
+}
+
 void WorkerPlacementMultipleChallenges(uint64_t numRuns)
 {
 	printf("\nRunning...\n");
@@ -167,7 +521,7 @@ void WorkerPlacementMultipleChallengesCard(uint64_t numRuns)
 	Stats stats;
 	WPChallenge testChallenge(*gRng, &stats);
 	testChallenge.SetupChallengeToRoundDefaults(1);
-	testChallenge.GetExecutionResources().AddCardVariation(1);
+	testChallenge.GetExecutionResources().SetCardVariation(1);
 
 	int32_t wins = 0;
 
@@ -179,6 +533,97 @@ void WorkerPlacementMultipleChallengesCard(uint64_t numRuns)
 	printf("\nWins: %d\n", wins);
 }
 
+void WorkerPlacementExactChallenges(uint64_t numRuns)
+{
+	static const char* const sSetupNames[] = { "Default", "Two trained", "One warrior", "One 2 card" };
+	constexpr double cMaxPassingZ = 4.0;
+	constexpr double cMinExpectedPerCell = 5.0;
+
+	printf("\nRunning...\n");
+	int32_t numFailed = 0;
+	for (int32_t setup = 0; setup < 4; ++setup)
+	{
+		WPChallenge testChallenge(*gRng);
+		testChallenge.SetupChallengeToRoundDefaults(1);
+		switch (setup)
+		{
+		case 1: testChallenge.TryUpgradeNWorkers(1, WorkerType::Basic, WorkerType::Trained); break;
+		case 2: testChallenge.TryUpgradeNWorkers(1, WorkerType::Trained, WorkerType::Warrior); break;
+		case 3: testChallenge.GetExecutionResources().SetCardVariation(1); break;
+		default: break;
+		}
+
+		const std::chrono::high_resolution_clock::time_point startTime = std::chrono::high_resolution_clock::now();
+		const ChallengeWinDistribution& distribution = testChallenge.GetExactWinDistribution();
+		const double exactMicroseconds = std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - startTime).count();
+
+		std::array<uint64_t, DicePool::cCapacity + 1> sampledCounts = {};
+		uint64_t sampledWins = 0;
+		uint64_t numImpossible = 0; // Win counts the exact distribution gives no chance
+		for (uint64_t run = 0; run < numRuns; ++run)
+		{
+			const int32_t wins = testChallenge.Execute().mWins;
+			sampledWins += wins;
+			if ((wins < 0) || (wins >= (int32_t)sampledCounts.size()) || (distribution.mProbabilities[wins] <= 0.0))
+			{
+				++numImpossible;
+				continue;
+			}
+			sampledCounts[wins]++;
+		}
+
+		// Chi-square of the sampled win counts against the exact ones. Neighbouring counts are pooled until each cell is
+		// expected at least 5 times, so the approximation holds, and a small last cell joins the one before it
+		std::vector<std::pair<double, double>> cells; // Observed, expected
+		std::pair<double, double> pooledCell = { 0.0, 0.0 };
+		for (size_t wins = 0; wins < distribution.mProbabilities.size(); ++wins)
+		{
+			pooledCell.first += (double)sampledCounts[wins];
+			pooledCell.second += distribution.mProbabilities[wins] * (double)numRuns;
+			if (pooledCell.second >= cMinExpectedPerCell)
+			{
+				cells.push_back(pooledCell);
+				pooledCell = { 0.0, 0.0 };
+			}
+		}
+		if (pooledCell.second > 0.0)
+		{
+			if (cells.empty())
+			{
+				cells.push_back(pooledCell);
+			}
+			else
+			{
+				cells.back().first += pooledCell.first;
+				cells.back().second += pooledCell.second;
+			}
+		}
+
+		double chiSquare = 0.0;
+		for (const auto& [observed, expected] : cells)
+		{
+			chiSquare += ((observed - expected) * (observed - expected)) / expected;
+		}
+		const double z = (cells.size() > 1) ? SetRandomizerQuality::GetChiSquareZ(chiSquare, cells.size() - 1) : 0.0;
+		const bool bPassed = (numImpossible == 0) && (z < cMaxPassingZ);
+		numFailed += bPassed ? 0 : 1;
+
+		printf("\n%s: %.4f expected wins exact (%.0fus), %.4f sampled. Chi-square Z %.2f over %zu cells%s %s\n", sSetupNames[setup],
+			distribution.GetExpectedWins(), exactMicroseconds, (numRuns > 0) ? ((double)sampledWins / (double)numRuns) : 0.0,
+			z, cells.size(), (numImpossible > 0) ? ", impossible win counts sampled" : "", bPassed ? "PASSED" : "FAILED");
+		for (size_t wins = 0; wins < distribution.mProbabilities.size(); ++wins)
+		{
+			if ((distribution.mProbabilities[wins] > 0.0) || (sampledCounts[wins] > 0))
+			{
+				printf("  %zu wins: %6.2f%% exact, %6.2f%% sampled\n", wins, distribution.mProbabilities[wins] * 100.0,
+					(numRuns > 0) ? ((double)sampledCounts[wins] * 100.0 / (double)numRuns) : 0.0);
+			}
+		}
+	}
+
+	printf("\n%s\n", (numFailed == 0) ? "Sampled challenges match the exact distributions" : "Sampled challenges do NOT match the exact distributions");
+}
+
 void TriangleSmallestSquare(uint64_t aX, uint64_t aY, uint64_t bX, uint64_t bY, uint64_t cX, uint64_t cY)
 {
 	const NamedVector2 posA(aX, aY);
@@ -208,24 +653,44 @@ void TriangleSmallestSquareAssumeOrigin(uint64_t bX, uint64_t bY, uint64_t cX, u
 /**
  * Main
  */
-int main()
+/**
+ * With no arguments the menus are interactive. Otherwise they run headless:
+ *   MathExperimentation f m 1000000      Runs one command line, starting at the main menu
+ *   MathExperimentation --script runs.txt Runs each line of a file, or of stdin for "-"
+ */
+int main(int argc, char* argv[])
 {
     gRng = new RNG();
 
+	// The other menus don't use the catalog, so they stay usable from any working directory
+	const bool bHasCatalog = WPCatalog::Get().IsValid();
+	if (!bHasCatalog)
+	{
+		printf("\nData/WPCatalog.txt is missing or malformed, see above. The fight and challenge menus are disabled\n");
+	}
+
 
 	ConsoleMenu fightMenu("Fight Menu");
 	fightMenu.AddCommand("s", "Single Fight", WorkerPlacementDiceTest);
 	fightMenu.AddCommand("m", "Multiple Fights", WorkerPlacementMultipleRuns);
+	fightMenu.AddCommand("e", "Multiple Fights, appending stats to Data/FightStats.csv, .jsonl and .bin;dFights", WorkerPlacementExportStats);
 	fightMenu.AddCommand("aw", "Attacker: Next Worker Type", AttackerNextWorkerType);
 	fightMenu.AddCommand("dw", "Defender: Next Worker Type", DefenderNextWorkerType);
 	fightMenu.AddCommand("ac", "Attacker: Next Card Variation", AttackerNextCardVariation);
 	fightMenu.AddCommand("dc", "Defender: Next Card Variation", DefenderNextCardVariation);
+	fightMenu.AddCommand("ce", "Combine Exported: Merge every run appended to Data/FightStats.bin and print the combined summaries", WorkerPlacementMergeExportedStats);
+	fightMenu.AddCommand("w", "Sweep all matchups to CSV;dMax Card Variation;dThreads (0 for all)", WorkerPlacementSweep);
+	fightMenu.AddCommand("cv", "Compare two attacker card variations with paired fights;dCard Variation A;dCard Variation B;dOpenings", WorkerPlacementCompareCardVariations);
+	fightMenu.AddCommand("b", "Batched fights vs one at a time, ordered dice and no card strategy;dFights", WorkerPlacementBatchFights);
+	fightMenu.AddCommand("tc", "Test Catalog: Workers and decks match the original hardcoded ones", WorkerPlacementTestCatalog);
+	fightMenu.AddCommand("os", "Opening Solve: Exact outcomes after the opening roll vs sampled fights;dOpenings", WorkerPlacementExactSolve);
 
 	ConsoleMenu challengeMenu("Challenge Menu");
 	challengeMenu.AddCommand("m", "Multiple Challenges", WorkerPlacementMultipleChallenges);
 	challengeMenu.AddCommand("tt", "Test two trained", WorkerPlacementMultipleChallengesTTT);
 	challengeMenu.AddCommand("tw", "Test one warrior", WorkerPlacementMultipleChallengesWar);
 	challengeMenu.AddCommand("tc", "Test one 2 card", WorkerPlacementMultipleChallengesCard);
+	challengeMenu.AddCommand("te", "Test exact win distributions against sampled challenges (chi-square);dRuns", WorkerPlacementExactChallenges);
 
 	ConsoleMenu triangleMenu("Triangle Menu");
 	triangleMenu.AddCommand("a", "All sides: Smallest Square;dA.x;dA.y;dB.x;dB.y;dC.x;dC.y", TriangleSmallestSquare);
@@ -238,13 +703,57 @@ int main()
 
 
     ConsoleMenu mainMenu("Main Menu");
-	mainMenu.AddSubmenu("f", fightMenu);
-	mainMenu.AddSubmenu("c", challengeMenu);
+	if (bHasCatalog)
+	{
+		mainMenu.AddSubmenu("f", fightMenu);
+		mainMenu.AddSubmenu("c", challengeMenu);
+	}
 	mainMenu.AddSubmenu("t", triangleMenu);
     mainMenu.AddSubmenu("s", squareContainmentMenu, SquareContainmentMenu::PreOpenMenu);
     SetRandomizerMenu setRandomizerMenu("r", mainMenu);
-	mainMenu.RunMenu();
+
+	bool bSucceeded = true;
+	if (argc < 2)
+	{
+		mainMenu.RunMenu();
+	}
+	else if (strcmp(argv[1], "--script") == 0)
+	{
+		if (argc < 3)
+		{
+			printf("\nUsage: --script <file, or - for stdin>\n");
+			bSucceeded = false;
+		}
+		else if (strcmp(argv[2], "-") == 0)
+		{
+			bSucceeded = mainMenu.RunScript(std::cin);
+		}
+		else
+		{
+			std::ifstream script(argv[2]);
+			if (script.is_open())
+			{
+				bSucceeded = mainMenu.RunScript(script);
+			}
+			else
+			{
+				printf("\nCould not open %s\n", argv[2]);
+				bSucceeded = false;
+			}
+		}
+	}
+	else
+	{
+		std::string commandLine;
+		for (int argIndex = 1; argIndex < argc; ++argIndex)
+		{
+			commandLine += argv[argIndex];
+			commandLine += ' ';
+		}
+		bSucceeded = mainMenu.RunCommandLine(commandLine.c_str());
+	}
 
 	delete gRng;
+	return bSucceeded ? 0 : 1;
 }
 
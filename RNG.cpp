@@ -5,6 +5,16 @@ RNG::RNG()
 	mRandomDist.seed(static_cast<uint32_t>(std::time(nullptr)) + 0xC0135BAB);
 }
 
+RNG::RNG(uint32_t seed)
+{
+	Seed(seed);
+}
+
+void RNG::Seed(uint32_t seed)
+{
+	mRandomDist.seed(seed);
+}
+
 uint32_t RNG::RandomNumber() const
 {
 	return mRandomDist();
@@ -12,5 +22,52 @@ uint32_t RNG::RandomNumber() const
 
 size_t RNG::RandomIndex(size_t size) const
 {
+	if (mChoiceScript)
+	{
+		return mChoiceScript->NextChoice(size);
+	}
 	return RandomNumber() % size;
 }
+
+void RNGChoiceScript::Clear()
+{
+	mChoices.clear();
+	mNextChoice = 0;
+}
+
+size_t RNGChoiceScript::NextChoice(size_t numChoices)
+{
+	if (mNextChoice == mChoices.size())
+	{
+		mChoices.push_back({ 0, (uint32_t)numChoices });
+	}
+	return mChoices[mNextChoice++].mChoice;
+}
+
+bool RNGChoiceScript::Advance()
+{
+	// A run that stopped early leaves choices it never reached, which belong to no sequence
+	mChoices.resize(mNextChoice);
+	mNextChoice = 0;
+
+	while (!mChoices.empty())
+	{
+		Choice& lastChoice = mChoices.back();
+		if (++lastChoice.mChoice < lastChoice.mNumChoices)
+		{
+			return true;
+		}
+		mChoices.pop_back();
+	}
+	return false;
+}
+
+double RNGChoiceScript::GetProbability() const
+{
+	double probability = 1.0;
+	for (size_t i = 0; i < mNextChoice; ++i)
+	{
+		probability /= (double)mChoices[i].mNumChoices;
+	}
+	return probability;
+}
@@ -1,15 +1,50 @@
 #pragma once
 #include "MathCommon.h"
 
+/**
+ * Stands in for random draws with a scripted sequence of choices, so every path through a process that only
+ * draws through RNG::RandomIndex can be visited. Draws past the end of the script take choice 0 and are recorded.
+ * After each run, Advance moves to the next unvisited sequence, depth first.
+ */
+class RNGChoiceScript
+{
+public:
+	void Clear();
+	void Restart() { mNextChoice = 0; } // Call before each run
+
+	size_t NextChoice(size_t numChoices);
+	bool Advance(); // false once every sequence has been visited
+
+	double GetProbability() const; // Of the choices taken so far this run
+	size_t GetNumChoicesTaken() const { return mNextChoice; }
+	size_t GetNumChoices() const { return mChoices.size(); } // After Advance, choices from this depth on differ from the last run
+
+private:
+	struct Choice
+	{
+		uint32_t mChoice = 0;
+		uint32_t mNumChoices = 0;
+	};
+
+	std::vector<Choice> mChoices;
+	size_t mNextChoice = 0;
+};
+
 class RNG
 {
 public:
 	RNG();
+	RNG(uint32_t seed);
+
+	void Seed(uint32_t seed);
 
 	uint32_t RandomNumber() const;
 	size_t RandomIndex(size_t size) const;
 
+	void SetChoiceScript(RNGChoiceScript* choiceScript) { mChoiceScript = choiceScript; } // nullptr to go back to random draws
+
 private:
 	mutable std::mt19937 mRandomDist;
+	RNGChoiceScript* mChoiceScript = nullptr;
 };
 
@@ -17,14 +17,12 @@
 *   Allow callers to limit zooming in shuffles?
 *   Math: Are any permutation combinations equivalent to another? Proof?
 *   Are there any extended permutation + shuffle techniques?
-*   Rejection Sampling
 * 
 * Shuffle Math
 *   If setsize > max && (setsize / max) < 2:
 *   else: shift via remainder
 *
 * RNG
-*   Document bias in the RNG from modulos that aren't a power of 2
 *   Allow callers to feed obfuscating into the RNG
 *   Remove RNG function. Replace with fed in RNG only
 *   This should also remove the thread-unsafe std::vector
@@ -134,7 +132,7 @@ namespace Factoradics
             block.MaxFactorial += baseFactorial;
             block.MinSetPosition += baseFactorial;
 
-            const Bits unbiasedMaxBase = ConstFactorialRange(block.MinFactorial, block.MaxFactorial);
+            const Bits unbiasedMaxBase = ConstFactorialRange(block.MinSetPosition, block.MaxFactorial);
             block.MaxNumOfMaxFactoradic = Bits::Max() / unbiasedMaxBase; // Truncation intentional
 
             baseFactorial = nextBase;
@@ -144,6 +142,23 @@ namespace Factoradics
         return blocks;
     }();
 
+    /**
+     * For every set position covered by the blocks, where its entry is when the blocks are laid out back to back
+     * Lets PermutationExtended look up an index without searching for its block
+     */
+    constexpr std::array<uint16_t, cBlocks.back().MaxFactorial> cExtendedOffsets = []() consteval
+    {
+        std::array<uint16_t, cBlocks.back().MaxFactorial> offsets = {};
+        for (SetSize blockIndex = 0; blockIndex < cBlocks.size(); ++blockIndex)
+        {
+            for (SetSize position = cBlocks[blockIndex].MinSetPosition; position < cBlocks[blockIndex].MaxFactorial; ++position)
+            {
+                offsets[position] = (uint16_t)((blockIndex * SetRandomizerInternal::cPermutationIndexesPerBlock) + (position - cBlocks[blockIndex].MinSetPosition));
+            }
+        }
+        return offsets;
+    }();
+
     consteval Block GetBlock(SetSize index)
     {
         return cBlocks[index];
@@ -154,6 +169,19 @@ namespace Factoradics
         return cBlocks[index];
     }
 
+    /**
+    * ConstFactorialRange, for ranges only known at run time
+    */
+    constexpr uint64_t FactorialRangeAtRunTime(SetSize min, SetSize max)
+    {
+        uint64_t value = 1;
+        for (; max > min; --max)
+        {
+            value *= max;
+        }
+        return value;
+    }
+
     /**
      * Build an indexed permutation sequence for our current random seed
      * See: https://oeis.org/A030299 (but off by 1)
@@ -164,8 +192,8 @@ namespace Factoradics
     class PermutationBuilder
     {
     public:
-        PermutationBuilder(int32_t setSize)
-            : mNextEntry(setSize > tMaxBlock.MaxFactorial ? tMaxBlock.MaxFactorial : setSize)
+        PermutationBuilder(SetSize setSize)
+            : mNextEntry(std::min(setSize, tMaxBlock.MaxFactorial))
         {
             std::iota(mPositionSet.begin(), mPositionSet.end(), 0);
         }
@@ -173,19 +201,24 @@ namespace Factoradics
         template<size_t tBlockIndex, Block tBlock = GetBlock(tBlockIndex)>
         void FillBlock(SetRandomizerInternal::PermutationBlock& permutationIndexes, Bits randomBits)
         {
-            // TODO: Rejection Sampling
-
-            randomBits.DivAndSetToRemainder(FactorialRange<tBlock.MinFactorial, tBlock.MaxFactorial>(mNextEntry));
+            // Biased unless randomBits is uniform over this block's range, see SetRandomizerSampling::Rejection
+            // Ranges are products from the block's first set position, so its lowest entry still has a choice of every position left
+            randomBits.DivAndSetToRemainder(FactorialRange<tBlock.MinSetPosition, tBlock.MaxFactorial>(mNextEntry));
 
             --mNextEntry;
-            Bits quotient = randomBits.DivAndSetToRemainder(FactorialRange<tBlock.MinFactorial, tBlock.MaxFactorial>(mNextEntry));
+            Bits quotient = randomBits.DivAndSetToRemainder(FactorialRange<tBlock.MinSetPosition, tBlock.MaxFactorial>(mNextEntry));
             permutationIndexes[mNextEntry - tBlock.MinSetPosition] = GetAndRemovePosition(quotient);
+            if (mNextEntry == tBlock.MinSetPosition)
+            {
+                // The set ends one entry into this block, which was the last position left in it
+                return;
+            }
 
             constexpr SetSize cLoopMin = (tBlock.MinFactorial + ((SetSize)tBlock.CoinflipFinalTwo));
             while (mNextEntry > cLoopMin)
             {
                 --mNextEntry;
-                quotient = randomBits.DivAndSetToRemainder(FactorialRange<tBlock.MinFactorial, tBlock.MaxFactorial>(mNextEntry));
+                quotient = randomBits.DivAndSetToRemainder(FactorialRange<tBlock.MinSetPosition, tBlock.MaxFactorial>(mNextEntry));
                 permutationIndexes[mNextEntry - tBlock.MinSetPosition] = GetAndRemovePosition(quotient);
             }
 
@@ -205,7 +238,7 @@ namespace Factoradics
         }
 
         template<size_t tBlockIndex>
-        inline void FillBlockAndFallThrough(std::span<SetRandomizerInternal::PermutationBlock>& permutationBlocks, const std::vector<Bits>& randomBits)
+        inline void FillBlockAndFallThrough(std::span<SetRandomizerInternal::PermutationBlock>& permutationBlocks, std::span<const Bits::UnderlyingType> randomBits)
         {
             FillBlock<tBlockIndex>(permutationBlocks[tBlockIndex], randomBits[tBlockIndex]);
             if constexpr (tBlockIndex > 0)
@@ -223,115 +256,102 @@ namespace Factoradics
         }
 
         alignas(16) std::array<uint8_t, tMaxBlock.MaxFactorial> mPositionSet;
-        int64_t mNextEntry;
+        SetSize mNextEntry; // Never below the current block's MinSetPosition, so it can't wrap
     };
-};
 
-
-void SetRandomizerInternal::RandomizeSingleBlock(SetRandomizerInternal::PermutationBlock& permutationBlock) noexcept
-{
-    using namespace Factoradics;
-    const Bits randomBits = MakeRandom();
-    mShuffleMode = ShuffleMode::None;
-
-    if (mSetSize < 2)
+    template<SetSize tMaxBlockIndex>
+    void FillExtendedBlocks(uint32_t setSize, std::span<SetRandomizerInternal::PermutationBlock>& permutationBlocks, std::span<const Bits::UnderlyingType> randomBits)
     {
-        return;
+        PermutationBuilder<tMaxBlockIndex> builder(setSize);
+        builder.template FillBlockAndFallThrough<tMaxBlockIndex>(permutationBlocks, randomBits);
     }
 
-    if (mSetSize == 2)
+    using FillExtendedBlocksFunc = void(*)(uint32_t, std::span<SetRandomizerInternal::PermutationBlock>&, std::span<const Bits::UnderlyingType>);
+
+    /**
+    * FillExtendedBlocks for each max block index, so PermutationExtended picks its builder with one indexed call
+    */
+    template<size_t... tMaxBlockIndexes>
+    consteval std::array<FillExtendedBlocksFunc, sizeof...(tMaxBlockIndexes)> MakeFillExtendedBlocks(std::index_sequence<tMaxBlockIndexes...>)
     {
-        // Caution: PermutationBuilder::FillStandardBlock expects a set size of atleast 3
-        // This shuffle mode is here specifically to guard for that
-        permutationBlock[0] = (uint8_t)randomBits.GetFinalBit();
-        mShuffleMode = ShuffleMode::CoinFlip;
-        return;
+        return { &FillExtendedBlocks<(SetSize)tMaxBlockIndexes>... };
     }
 
-    PermutationBuilder<0> permutationBuilder(mSetSize);
-    permutationBuilder.FillBlock<0>(permutationBlock, randomBits);
+    // [Factoradics::Block Limited]
+    constexpr std::array<FillExtendedBlocksFunc, cBlocks.size()> cFillExtendedBlocks = MakeFillExtendedBlocks(std::make_index_sequence<cBlocks.size()>());
+};
 
-    if (mSetSize <= GetBlockAtRunTime(0).MaxFactorial)
-    {
-        mShuffleMode = ShuffleMode::Permutation;
-        return;
-    }
 
-    // TODO: Deal with sets sized 30~39, esp 35~39
-    mPermutationMultiplier = mSetSize / cPermutationIndexesPerBlock;
-    mShuffleMode = ShuffleMode::RepeatedShuffling;
-    return;
+/*static*/ uint32_t SetRandomizerInternal::GetMaxPermutationSetSize(size_t numBlocks) noexcept
+{
+    using namespace Factoradics;
+    const SetSize blockSize = std::clamp<SetSize>(numBlocks, 1, cBlocks.size());
+    return (uint32_t)GetBlockAtRunTime(blockSize - 1).MaxFactorial;
 }
 
 template<SetRandomizerInternal::ShuffleDataSize tDataSize>
-void SetRandomizerInternal::Randomize(std::span<SetRandomizerInternal::PermutationBlock> permutationBlocks)
+size_t SetRandomizerInternal::PrepareRandomize(size_t numBlocks) noexcept
 {
     using namespace Factoradics;
-    const Bits randomBits = MakeRandom();
     mShuffleMode = ShuffleMode::None;
 
     if (mSetSize < 2)
     {
-        return;
+        return 0;
     }
 
     if (mSetSize == 2)
     {
         // Caution: PermutationBuilder::FillStandardBlock expects a set size of atleast 3
         // This shuffle mode is here specifically to guard for that
-        permutationBlocks[0][0] = (uint8_t)randomBits.GetFinalBit();
         mShuffleMode = ShuffleMode::CoinFlip;
-        return;
+        return 1;
     }
 
     if (mSetSize <= GetBlockAtRunTime(0).MaxFactorial)
     {
-        PermutationBuilder<0> permutationBuilder(mSetSize);
-        permutationBuilder.FillBlock<0>(permutationBlocks[0], randomBits);
         mShuffleMode = ShuffleMode::Permutation;
-        return;
+        return 1;
     }
 
-    if (mSetSize <= cBlocks.back().MaxFactorial)
+    if constexpr (tDataSize == SetRandomizerInternal::ShuffleDataSize::Single)
     {
-        const SetSize blockSize = std::min(permutationBlocks.size(), cBlocks.size());
+        // TODO: Deal with sets sized 30~39, esp 35~39
+        mShuffleMode = ShuffleMode::RepeatedShuffling;
+        return 1;
+    }
 
-        if constexpr (tDataSize == SetRandomizerInternal::ShuffleDataSize::Small)
-        {
-            for (SetSize blockIndex = 0; blockIndex < blockSize; ++blockIndex)
-            {
-                if (mSetSize <= GetBlockAtRunTime(blockIndex).MaxFactorial)
-                {
-                    FillWithPermutationExtended(blockIndex, permutationBlocks);
-                    return;
-                }
-            }
-        }
-        else if constexpr (tDataSize == SetRandomizerInternal::ShuffleDataSize::Large)
+    // Sets past what our blocks can hold are shuffled below instead
+    const SetSize blockSize = std::min(numBlocks, cBlocks.size());
+    if (mSetSize <= GetBlockAtRunTime(blockSize - 1).MaxFactorial)
+    {
+        SetSize blockIndex = 0;
+        if constexpr (tDataSize == SetRandomizerInternal::ShuffleDataSize::Large)
         {
             /**
             * This polynomial fits set size to be equal to or 1 greater than what fits in each block
             * Doing this only lets us save a few checks. Which is why we don't bother with smaller permutation block sizes
             */
             const double setAsDouble = (double)mSetSize;
-            SetSize blockIndex = (SetSize)(1.177 + (0.07143 * setAsDouble) + (0.000162 * setAsDouble * setAsDouble));
+            blockIndex = (SetSize)(1.177 + (0.07143 * setAsDouble) + (0.000162 * setAsDouble * setAsDouble));
             blockIndex = std::min(blockIndex, blockSize - 1);
 
-            for (; blockIndex > 0; --blockIndex)
+            while ((blockIndex > 0) && (mSetSize <= GetBlockAtRunTime(blockIndex).MinSetPosition))
             {
-                if (mSetSize > GetBlockAtRunTime(blockIndex).MinSetPosition)
-                {
-                    FillWithPermutationExtended(blockIndex, permutationBlocks);
-                    return;
-                }
+                --blockIndex;
+            }
+        }
+        else
+        {
+            while (mSetSize > GetBlockAtRunTime(blockIndex).MaxFactorial)
+            {
+                ++blockIndex;
             }
         }
 
-
-        // The 0th block index was already verified as not valid by this point. Reaching this point should be impossible
-        // See above: mShuffleMode = ShuffleMode::Permutation;
-        mShuffleMode = ShuffleMode::None;
-        return;
+        mMaxBlockIndex = (uint8_t)blockIndex;
+        mShuffleMode = ShuffleMode::PermutationExtended;
+        return blockIndex + 1;
     }
 
     // TODO: Don't do block mixing
@@ -340,73 +360,196 @@ void SetRandomizerInternal::Randomize(std::span<SetRandomizerInternal::Permutati
     // Or more so especially, [1.75x, 2.0x)
 
     // mSetSize > 1 && all other options exhausted
+    mShuffleMode = ShuffleMode::RepeatedShufflingWithBlockMixing;
+    return numBlocks;
+}
+
+template size_t SetRandomizerInternal::PrepareRandomize<SetRandomizerInternal::ShuffleDataSize::Single>(size_t) noexcept;
+template size_t SetRandomizerInternal::PrepareRandomize<SetRandomizerInternal::ShuffleDataSize::Small>(size_t) noexcept;
+template size_t SetRandomizerInternal::PrepareRandomize<SetRandomizerInternal::ShuffleDataSize::Large>(size_t) noexcept;
+
+const char* SetRandomizerInternal::GetShuffleModeName() const noexcept
+{
+    static const char* const kShuffleModeNames[] = // By ShuffleMode
     {
-        mPermutationMultiplier = mSetSize / cPermutationIndexesPerBlock;
-        for (SetRandomizerInternal::PermutationBlock& permutationBlock : permutationBlocks)
+        "None",
+        "CoinFlip",
+        "Permutation",
+        "PermutationExtended",
+        "RepeatedShuffling",
+        "RepeatedShufflingWithBlockMixing"
+    };
+    return kShuffleModeNames[(size_t)mShuffleMode];
+}
+
+uint64_t SetRandomizerInternal::GetWordRange(size_t wordIndex) const noexcept
+{
+    using namespace Factoradics;
+    switch (mShuffleMode)
+    {
+    case ShuffleMode::CoinFlip:
+        return 2;
+
+    case ShuffleMode::Permutation:
+        return FactorialRangeAtRunTime(GetBlockAtRunTime(0).MinSetPosition, mSetSize);
+
+    case ShuffleMode::PermutationExtended:
+    {
+        // Every block is full but the last, which stops at the set size
+        const Block& block = GetBlockAtRunTime(wordIndex);
+        return FactorialRangeAtRunTime(block.MinSetPosition, std::min<SetSize>(mSetSize, block.MaxFactorial));
+    }
+
+    case ShuffleMode::RepeatedShuffling:
+    case ShuffleMode::RepeatedShufflingWithBlockMixing:
+        return FactorialRangeAtRunTime(GetBlockAtRunTime(0).MinSetPosition, GetBlockAtRunTime(0).MaxFactorial);
+
+    default:
+        return 1;
+    }
+}
+
+void SetRandomizerInternal::Randomize(std::span<const Factoradics::Bits::UnderlyingType> randomWords, std::span<SetRandomizerInternal::PermutationBlock> permutationBlocks)
+{
+    using namespace Factoradics;
+    switch (mShuffleMode)
+    {
+    case ShuffleMode::CoinFlip:
+        permutationBlocks[0][0] = (uint8_t)Bits(randomWords[0]).GetFinalBit();
+        return;
+
+    case ShuffleMode::Permutation:
+    {
+        PermutationBuilder<0> permutationBuilder(mSetSize);
+        permutationBuilder.FillBlock<0>(permutationBlocks[0], randomWords[0]);
+        return;
+    }
+
+    case ShuffleMode::PermutationExtended:
+        FillWithPermutationExtended(randomWords, permutationBlocks);
+        return;
+
+    case ShuffleMode::RepeatedShuffling:
+    case ShuffleMode::RepeatedShufflingWithBlockMixing:
+    {
+        for (size_t blockIndex = 0; blockIndex < randomWords.size(); ++blockIndex)
         {
-            const Bits permutationRandomEx = MakeRandom();
             PermutationBuilder<0> permutationBuilder(mSetSize);
-            permutationBuilder.FillBlock<0>(permutationBlock, permutationRandomEx);
+            permutationBuilder.FillBlock<0>(permutationBlocks[blockIndex], randomWords[blockIndex]);
         }
+        PrepareRepeatedShuffleSteps(permutationBlocks.first(randomWords.size()));
+        return;
+    }
 
-        mShuffleMode = ShuffleMode::RepeatedShufflingWithBlockMixing;
+    default:
+        return;
     }
 }
 
-template void SetRandomizerInternal::Randomize<SetRandomizerInternal::ShuffleDataSize::Small>(std::span<SetRandomizerInternal::PermutationBlock>);
-template void SetRandomizerInternal::Randomize<SetRandomizerInternal::ShuffleDataSize::Large>(std::span<SetRandomizerInternal::PermutationBlock>);
+bool SetRandomizerInternal::IsValidRandomized(std::span<const SetRandomizerInternal::PermutationBlock> permutationBlocks) const noexcept
+{
+    using namespace Factoradics;
 
+    // entries[offsets[i]] for i in [0, numEntries) must be a permutation of [0, numEntries)
+    const auto isPermutation = [](const uint8_t* const entries, std::span<const uint16_t> offsets, uint32_t numEntries) -> bool
+    {
+        std::array<bool, std::numeric_limits<uint8_t>::max() + 1> seen = {};
+        for (uint32_t index = 0; index < numEntries; ++index)
+        {
+            const uint8_t entry = entries[offsets.empty() ? index : offsets[index]];
+            if ((entry >= numEntries) || seen[entry])
+            {
+                return false;
+            }
+            seen[entry] = true;
+        }
+        return true;
+    };
 
-void SetRandomizerInternal::FillWithPermutationExtended(Factoradics::SetSize maxBlockIndex, std::span<SetRandomizerInternal::PermutationBlock>& permutationBlocks)
+    switch (mShuffleMode)
+    {
+    case ShuffleMode::CoinFlip:
+        return permutationBlocks[0][0] <= 1;
+
+    case ShuffleMode::Permutation:
+        return isPermutation(permutationBlocks[0].data(), {}, mSetSize);
+
+    case ShuffleMode::PermutationExtended:
+    {
+        // Laid out over the blocks, see FillInversePermutation
+        const SetSize numBlocks = std::min(permutationBlocks.size(), cBlocks.size());
+        const uint32_t numMapped = std::min(mSetSize, (uint32_t)GetBlockAtRunTime(numBlocks - 1).MaxFactorial);
+        return isPermutation(permutationBlocks[0].data(), cExtendedOffsets, numMapped);
+    }
+
+    case ShuffleMode::RepeatedShuffling:
+    case ShuffleMode::RepeatedShufflingWithBlockMixing:
+        return std::all_of(permutationBlocks.begin(), permutationBlocks.end(), [&isPermutation](const PermutationBlock& block)
+        {
+            return isPermutation(block.data(), {}, cPermutationIndexesPerBlock);
+        });
+
+    default:
+        return true;
+    }
+}
+
+void SetRandomizerInternal::RestoreRandomized(size_t numRandomWords, std::span<const SetRandomizerInternal::PermutationBlock> permutationBlocks) noexcept
 {
-    using namespace Factoradics;
-    mShuffleMode = ShuffleMode::PermutationExtended;
+    if ((mShuffleMode == ShuffleMode::RepeatedShuffling) || (mShuffleMode == ShuffleMode::RepeatedShufflingWithBlockMixing))
+    {
+        PrepareRepeatedShuffleSteps(permutationBlocks.first(numRandomWords));
+    }
+}
 
-    std::vector<Bits> randomBits;
-    randomBits.reserve(maxBlockIndex + 1);
-    for (size_t i = 0; i <= maxBlockIndex; ++i)
+void SetRandomizerInternal::PrepareRepeatedShuffleSteps(std::span<const SetRandomizerInternal::PermutationBlock> permutationBlocks) noexcept
+{
+    // Every full base 20 digit of the set size gets mapped once per pass
+    uint32_t numDigits = 0;
+    for (uint64_t digitSpan = cPermutationIndexesPerBlock; digitSpan <= mSetSize; digitSpan *= cPermutationIndexesPerBlock)
     {
-        randomBits.push_back(MakeRandom());
+        ++numDigits;
     }
-    switch (maxBlockIndex)
+    mNumRepeatedShuffleSteps = (uint8_t)(cRepeatedShufflePasses * numDigits);
+
+    for (uint32_t stepIndex = 0; stepIndex < mNumRepeatedShuffleSteps; ++stepIndex)
     {
-    // [Factoradics::Block Limited]
-    case 27: { PermutationBuilder<27> builder(mSetSize); builder.FillBlockAndFallThrough<27>(permutationBlocks, randomBits); } break;
-    case 26: { PermutationBuilder<26> builder(mSetSize); builder.FillBlockAndFallThrough<26>(permutationBlocks, randomBits); } break;
-    case 25: { PermutationBuilder<25> builder(mSetSize); builder.FillBlockAndFallThrough<25>(permutationBlocks, randomBits); } break;
-    case 24: { PermutationBuilder<24> builder(mSetSize); builder.FillBlockAndFallThrough<24>(permutationBlocks, randomBits); } break;
-    case 23: { PermutationBuilder<23> builder(mSetSize); builder.FillBlockAndFallThrough<23>(permutationBlocks, randomBits); } break;
-    case 22: { PermutationBuilder<22> builder(mSetSize); builder.FillBlockAndFallThrough<22>(permutationBlocks, randomBits); } break;
-    case 21: { PermutationBuilder<21> builder(mSetSize); builder.FillBlockAndFallThrough<21>(permutationBlocks, randomBits); } break;
-    case 20: { PermutationBuilder<20> builder(mSetSize); builder.FillBlockAndFallThrough<20>(permutationBlocks, randomBits); } break;
-    case 19: { PermutationBuilder<19> builder(mSetSize); builder.FillBlockAndFallThrough<19>(permutationBlocks, randomBits); } break;
-    case 18: { PermutationBuilder<18> builder(mSetSize); builder.FillBlockAndFallThrough<18>(permutationBlocks, randomBits); } break;
-    case 17: { PermutationBuilder<17> builder(mSetSize); builder.FillBlockAndFallThrough<17>(permutationBlocks, randomBits); } break;
-    case 16: { PermutationBuilder<16> builder(mSetSize); builder.FillBlockAndFallThrough<16>(permutationBlocks, randomBits); } break;
-    case 15: { PermutationBuilder<15> builder(mSetSize); builder.FillBlockAndFallThrough<15>(permutationBlocks, randomBits); } break;
-    case 14: { PermutationBuilder<14> builder(mSetSize); builder.FillBlockAndFallThrough<14>(permutationBlocks, randomBits); } break;
-    case 13: { PermutationBuilder<13> builder(mSetSize); builder.FillBlockAndFallThrough<13>(permutationBlocks, randomBits); } break;
-    case 12: { PermutationBuilder<12> builder(mSetSize); builder.FillBlockAndFallThrough<12>(permutationBlocks, randomBits); } break;
-    case 11: { PermutationBuilder<11> builder(mSetSize); builder.FillBlockAndFallThrough<11>(permutationBlocks, randomBits); } break;
-    case 10: { PermutationBuilder<10> builder(mSetSize); builder.FillBlockAndFallThrough<10>(permutationBlocks, randomBits); } break;
-    case  9: { PermutationBuilder< 9> builder(mSetSize); builder.FillBlockAndFallThrough< 9>(permutationBlocks, randomBits); } break;
-    case  8: { PermutationBuilder< 8> builder(mSetSize); builder.FillBlockAndFallThrough< 8>(permutationBlocks, randomBits); } break;
-    case  7: { PermutationBuilder< 7> builder(mSetSize); builder.FillBlockAndFallThrough< 7>(permutationBlocks, randomBits); } break;
-    case  6: { PermutationBuilder< 6> builder(mSetSize); builder.FillBlockAndFallThrough< 6>(permutationBlocks, randomBits); } break;
-    case  5: { PermutationBuilder< 5> builder(mSetSize); builder.FillBlockAndFallThrough< 5>(permutationBlocks, randomBits); } break;
-    case  4: { PermutationBuilder< 4> builder(mSetSize); builder.FillBlockAndFallThrough< 4>(permutationBlocks, randomBits); } break;
-    case  3: { PermutationBuilder< 3> builder(mSetSize); builder.FillBlockAndFallThrough< 3>(permutationBlocks, randomBits); } break;
-    case  2: { PermutationBuilder< 2> builder(mSetSize); builder.FillBlockAndFallThrough< 2>(permutationBlocks, randomBits); } break;
-    case  1: { PermutationBuilder< 1> builder(mSetSize); builder.FillBlockAndFallThrough< 1>(permutationBlocks, randomBits); } break;
-    case  0: { PermutationBuilder< 0> builder(mSetSize); builder.FillBlockAndFallThrough< 0>(permutationBlocks, randomBits); } break;
-    default: mShuffleMode = ShuffleMode::None; break;
+        RepeatedShuffleStep& step = mRepeatedShuffleSteps[stepIndex];
+        step.mStride = 1;
+        for (uint32_t digit = stepIndex % numDigits; digit > 0; --digit)
+        {
+            step.mStride *= cPermutationIndexesPerBlock;
+        }
+
+        const uint64_t digitSpan = (uint64_t)step.mStride * cPermutationIndexesPerBlock;
+        step.mMappedSize = (uint32_t)((mSetSize / digitSpan) * digitSpan);
+        step.mBlockIndex = (uint8_t)(stepIndex % permutationBlocks.size());
+
+        // The shift is the block read as base 20 digits, starting from a different entry every step
+        const PermutationBlock& block = permutationBlocks[step.mBlockIndex];
+        uint64_t shift = 0;
+        for (uint32_t digit = 0; digit < 7; ++digit)
+        {
+            shift = (shift * cPermutationIndexesPerBlock) + block[(stepIndex + digit) % cPermutationIndexesPerBlock];
+        }
+        step.mShift = (uint32_t)(shift % mSetSize);
+    }
+}
+
+void SetRandomizerInternal::FillWithPermutationExtended(std::span<const Factoradics::Bits::UnderlyingType> randomBits, std::span<SetRandomizerInternal::PermutationBlock>& permutationBlocks)
+{
+    using namespace Factoradics;
+    if (mMaxBlockIndex >= cFillExtendedBlocks.size())
+    {
+        mShuffleMode = ShuffleMode::None;
+        return;
     }
+    cFillExtendedBlocks[mMaxBlockIndex](mSetSize, permutationBlocks, randomBits);
 }
 
 namespace
 {
-    template<bool MixedBlocks>
-    inline uint32_t RepeatedShuffling(const uint32_t setSize, uint32_t index, uint32_t permutationMultiplier, std::span<const SetRandomizerInternal::PermutationBlock>& permutationBlocks)
+    inline uint32_t RepeatedShuffling(const uint32_t setSize, uint32_t index, std::span<const SetRandomizerInternal::RepeatedShuffleStep> steps, std::span<const SetRandomizerInternal::PermutationBlock> permutationBlocks)
     {
         /**
         
@@ -494,85 +637,55 @@ The above example is a showcase of a transform with a factoradic max base of 3 o
         */
 
 
-        // const uint32_t shuffles = 3 + (((uint32_t)std::log2((double)setSize)) >> 1
-        // (std::bit_width(setSize) + 1) >> 1
-
-        using namespace Factoradics;
-
+        /**
+         * Each step maps one base 20 digit of the index, then shifts the whole set:
+         *   index div stride --> [Q_low], div 20 --> [[high_digit]_low], map(block) --> [[high_block[digit]]_low],
+         *   combine 20, combine stride, shift(step shift)
+         * Only indexes below mMappedSize have the full digit (Final rule), the rest are only shifted, which is what
+         * carries them into the mapped part on later steps.
+         * Passes go over every digit from the lowest up, so each step is an O(1) bijection and a whole lookup is O(log(setSize))
+         */
+        if (index >= setSize)
+        {
+            return index;
+        }
 
-        for (uint32_t revMultiplier = 1, combMult = permutationMultiplier;
-            combMult > 0;
-            revMultiplier <<= 1, combMult >>= 1)
+        for (const SetRandomizerInternal::RepeatedShuffleStep& step : steps)
         {
-            const uint32_t blockSize = SetRandomizerInternal::cPermutationIndexesPerBlock * revMultiplier;
-            if (index < (blockSize * combMult))
+            if (index < step.mMappedSize)
             {
-                const std::ldiv_t baseMultDiv = std::ldiv(index, revMultiplier);
-                const std::ldiv_t blockDiv = std::ldiv(baseMultDiv.quot, SetRandomizerInternal::cPermutationIndexesPerBlock);
-                uint32_t usedBlock = 0;
-                index = (blockDiv.quot * SetRandomizerInternal::cPermutationIndexesPerBlock) * permutationBlocks[usedBlock][blockDiv.rem];
-                index = (index * revMultiplier) + baseMultDiv.rem;
+                const uint32_t high = index / step.mStride;
+                const uint32_t low = index - (high * step.mStride);
+                const uint32_t digit = high % SetRandomizerInternal::cPermutationIndexesPerBlock;
+                index = ((high - digit + permutationBlocks[step.mBlockIndex][digit]) * step.mStride) + low;
             }
-        }
-
-        // index = (index + (setSize >> 1)) % setSize;
-
-        // Shift by overshot
-        // Map by quotient
-        // 
-
 
+            index = (index >= step.mShift) ? (index - step.mShift) : (index + (setSize - step.mShift));
+        }
         return index;
     }
 
-    template<bool MixedBlocks>
-    inline uint32_t ShuffleContinuousBatch(const uint32_t setSize, uint32_t index, uint32_t permutationMultiplier, std::span<const SetRandomizerInternal::PermutationBlock>& permutationBlocks)
+    /**
+     * Undoes RepeatedShuffling given the inverse permutation blocks: the same steps, last one first
+     */
+    inline uint32_t RepeatedUnshuffling(const uint32_t setSize, uint32_t index, std::span<const SetRandomizerInternal::RepeatedShuffleStep> steps, std::span<const SetRandomizerInternal::PermutationBlock> inversePermutationBlocks)
     {
-        const uint32_t shuffles = 3 + (((uint32_t)std::log2((double)setSize)) >> 1);
-        // (std::bit_width(setSize) + 1) >> 1
-
-        for (uint32_t i = 0; true;)
+        if (index >= setSize)
         {
-            if (index < (SetRandomizerInternal::cPermutationIndexesPerBlock * permutationMultiplier))
-            {
-                // Shuffle specifics
-                const std::ldiv_t blockDiv = std::ldiv(index, SetRandomizerInternal::cPermutationIndexesPerBlock);
-
-                uint32_t usedBlock = 0;
-                if constexpr (MixedBlocks)
-                {
-                    usedBlock = i % permutationBlocks.size();
-                }
-                index = permutationBlocks[usedBlock][blockDiv.rem] + (blockDiv.quot * SetRandomizerInternal::cPermutationIndexesPerBlock);
-            }
+            return index;
+        }
 
-            for (uint32_t revMultiplier = 2, combMult = permutationMultiplier >> 1;
-                combMult > 0;
-                revMultiplier <<= 1, combMult >>= 1)
-            {
-                const uint32_t blockSize = SetRandomizerInternal::cPermutationIndexesPerBlock * revMultiplier;
-                if (index < (blockSize * combMult))
-                {
-                    const std::ldiv_t baseMultDiv = std::ldiv(index, revMultiplier);
-                    index = baseMultDiv.quot;
-
-                    const std::ldiv_t blockDiv = std::ldiv(index, SetRandomizerInternal::cPermutationIndexesPerBlock);
-                    uint32_t usedBlock = 0;
-                    if constexpr (MixedBlocks)
-                    {
-                        usedBlock = i % permutationBlocks.size();
-                    }
-                    index = permutationBlocks[usedBlock][blockDiv.rem] + (blockDiv.quot * SetRandomizerInternal::cPermutationIndexesPerBlock);
-
-                    index = (index * revMultiplier) + baseMultDiv.rem;
-                }
-            }
+        for (auto step = steps.rbegin(); step != steps.rend(); ++step)
+        {
+            index = (index < (setSize - step->mShift)) ? (index + step->mShift) : (index - (setSize - step->mShift));
 
-            if (++i; i >= shuffles)
+            if (index < step->mMappedSize)
             {
-                break;
+                const uint32_t high = index / step->mStride;
+                const uint32_t low = index - (high * step->mStride);
+                const uint32_t digit = high % SetRandomizerInternal::cPermutationIndexesPerBlock;
+                index = ((high - digit + inversePermutationBlocks[step->mBlockIndex][digit]) * step->mStride) + low;
             }
-            index = (index + (setSize >> 1)) % setSize;
         }
         return index;
     }
@@ -581,7 +694,7 @@ The above example is a showcase of a transform with a factoradic max base of 3 o
 uint32_t SetRandomizerInternal::GetWheeledIndex(uint32_t index, std::span<const SetRandomizerInternal::PermutationBlock> permutationBlocks) const
 {
     using namespace Factoradics;
-    if (index > mSetSize)
+    if (index >= mSetSize)
     {
         return index;
     }
@@ -615,31 +728,157 @@ uint32_t SetRandomizerInternal::GetWheeledIndex(uint32_t index, std::span<const
      * For both RepeatedShuffling types:
      *
      *  We have to repeat the shuffle at least 3 times in order to de-bias the remainder ("cutting" the set each time)
-     *  Since every shuffle has to be in increasing block sizes (starting from 19),
-     *  there will be an "unshuffled" bit at the bottom, which we need to shuffle in and then out
-     *  e.g. At a set size of 200, with a divisor of 19, we'd have 10 indexes unshuffled at the end
-     *  So we:
-     *      Shuffle the 190, leaving an unshuffled 10
-     *      Split the bottom 100 to the top.
-     *      Shuffle again (now including the unshuffled 10).
-     *          Note: This puts us in a state where the final 10 are guaranteed to NOT be the largest values
-     *          This is non-ideal. It biases the shuffler to have the bottom 190 be slightly larger if we left it like this
-     *      Split the bottom 100 to the top (again).
-     *      Shuffle again, redistributing the once-lowered 10 back into the base 190
+     *  Every step only maps indexes that fill whole digits, so there will be an "unshuffled" bit at the top,
+     *  e.g. At a set size of 210, mapping the lowest digit leaves 200 to 209 alone and the second digit leaves 0 to 9 alone
+     *  The shift after every step moves that unmapped part somewhere the next steps do map
+     *  With block mixing, each step uses the next block, otherwise every step uses the first
      */
     case ShuffleMode::RepeatedShuffling:
+    case ShuffleMode::RepeatedShufflingWithBlockMixing:
     {
-        return RepeatedShuffling<false>(mSetSize, index, mPermutationMultiplier, permutationBlocks);
+        return RepeatedShuffling(mSetSize, index, std::span(mRepeatedShuffleSteps.data(), mNumRepeatedShuffleSteps), permutationBlocks);
     }
+    }
+}
 
+void SetRandomizerInternal::FillInversePermutation(std::span<const SetRandomizerInternal::PermutationBlock> permutationBlocks, std::span<SetRandomizerInternal::PermutationBlock> inversePermutationBlocks) const
+{
+    using namespace Factoradics;
+    switch (mShuffleMode)
+    {
+    case ShuffleMode::Permutation:
+    {
+        for (uint32_t index = 0; index < mSetSize; ++index)
+        {
+            inversePermutationBlocks[0][permutationBlocks[0][index]] = (uint8_t)index;
+        }
+        return;
+    }
+
+    case ShuffleMode::PermutationExtended:
+    {
+        // Entries are positions in the whole set, so the inverse is laid out over the blocks the same way
+        const SetSize numBlocks = std::min(permutationBlocks.size(), cBlocks.size());
+        const uint32_t numMapped = std::min(mSetSize, (uint32_t)GetBlockAtRunTime(numBlocks - 1).MaxFactorial);
+        const uint8_t* const permutations = permutationBlocks[0].data();
+        uint8_t* const inversePermutations = inversePermutationBlocks[0].data();
+        for (uint32_t index = 0; index < numMapped; ++index)
+        {
+            inversePermutations[cExtendedOffsets[permutations[cExtendedOffsets[index]]]] = (uint8_t)index;
+        }
+        return;
+    }
+
+    case ShuffleMode::RepeatedShuffling:
     case ShuffleMode::RepeatedShufflingWithBlockMixing:
     {
-        return RepeatedShuffling<true>(mSetSize, index, mPermutationMultiplier, permutationBlocks);
+        for (size_t blockIndex = 0; blockIndex < permutationBlocks.size(); ++blockIndex)
+        {
+            for (uint32_t index = 0; index < cPermutationIndexesPerBlock; ++index)
+            {
+                inversePermutationBlocks[blockIndex][permutationBlocks[blockIndex][index]] = (uint8_t)index;
+            }
+        }
+        return;
+    }
+
+    case ShuffleMode::CoinFlip:
+        // Its own inverse
+        inversePermutationBlocks[0][0] = permutationBlocks[0][0];
+        return;
+
+    default:
+        return;
+    }
+}
+
+uint32_t SetRandomizerInternal::GetUnwheeledIndex(uint32_t wheeledIndex, std::span<const SetRandomizerInternal::PermutationBlock> inversePermutationBlocks) const
+{
+    using namespace Factoradics;
+    if (wheeledIndex >= mSetSize)
+    {
+        return wheeledIndex;
+    }
+
+    switch (mShuffleMode)
+    {
+    default:
+    case ShuffleMode::None:
+        return mSetSize - 1;
+
+    case ShuffleMode::CoinFlip:
+        return (wheeledIndex ^ inversePermutationBlocks[0][0]) & 0b1;
+
+    case ShuffleMode::Permutation:
+        return inversePermutationBlocks[0][wheeledIndex];
+
+    case ShuffleMode::PermutationExtended:
+    {
+        const SetSize numBlocks = std::min(inversePermutationBlocks.size(), cBlocks.size());
+        if (wheeledIndex < GetBlockAtRunTime(numBlocks - 1).MaxFactorial)
+        {
+            return inversePermutationBlocks[0].data()[cExtendedOffsets[wheeledIndex]];
+        }
+        return wheeledIndex;
     }
+
+    case ShuffleMode::RepeatedShuffling:
+    case ShuffleMode::RepeatedShufflingWithBlockMixing:
+        return RepeatedUnshuffling(mSetSize, wheeledIndex, std::span(mRepeatedShuffleSteps.data(), mNumRepeatedShuffleSteps), inversePermutationBlocks);
     }
 }
 
-Factoradics::Bits SetRandomizerInternal::MakeRandom() const
+void SetRandomizerInternal::GetWheeledIndices(std::span<const uint32_t> indices, std::span<uint32_t> outWheeledIndices, std::span<const SetRandomizerInternal::PermutationBlock> permutationBlocks) const
 {
-    return Factoradics::Bits(((int64_t)mRandomFunc() << 32) & INT64_MAX | (int64_t)mRandomFunc());
+    using namespace Factoradics;
+    static_assert(sizeof(PermutationBlock) == cPermutationIndexesPerBlock, "Blocks are read as one flat array");
+
+    const size_t numIndices = std::min(indices.size(), outWheeledIndices.size());
+    switch (mShuffleMode)
+    {
+    case ShuffleMode::Permutation:
+    {
+        const uint8_t* const permutation = permutationBlocks[0].data();
+        for (size_t i = 0; i < numIndices; ++i)
+        {
+            const uint32_t index = indices[i];
+            outWheeledIndices[i] = (index < mSetSize) ? permutation[index] : GetWheeledIndex(index, permutationBlocks);
+        }
+        return;
+    }
+
+    case ShuffleMode::PermutationExtended:
+    {
+        // Past the last block we have, GetWheeledIndex leaves the index alone
+        const SetSize numBlocks = std::min(permutationBlocks.size(), cBlocks.size());
+        const uint32_t numMapped = std::min(mSetSize, (uint32_t)GetBlockAtRunTime(numBlocks - 1).MaxFactorial);
+        const uint8_t* const permutations = permutationBlocks[0].data();
+        for (size_t i = 0; i < numIndices; ++i)
+        {
+            const uint32_t index = indices[i];
+            outWheeledIndices[i] = (index < numMapped) ? permutations[cExtendedOffsets[index]] : GetWheeledIndex(index, permutationBlocks);
+        }
+        return;
+    }
+
+    case ShuffleMode::RepeatedShuffling:
+    case ShuffleMode::RepeatedShufflingWithBlockMixing:
+    {
+        const std::span<const RepeatedShuffleStep> steps(mRepeatedShuffleSteps.data(), mNumRepeatedShuffleSteps);
+        for (size_t i = 0; i < numIndices; ++i)
+        {
+            outWheeledIndices[i] = RepeatedShuffling(mSetSize, indices[i], steps, permutationBlocks);
+        }
+        return;
+    }
+
+    default:
+    {
+        for (size_t i = 0; i < numIndices; ++i)
+        {
+            outWheeledIndices[i] = GetWheeledIndex(indices[i], permutationBlocks);
+        }
+        return;
+    }
+    }
 }
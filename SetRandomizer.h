@@ -1,7 +1,28 @@
 #pragma once
+#include <numeric>
+#include <string_view>
+#include "ThreadPool.h"
+
 template<size_t tSize>
 concept WithinPermutationBlockBounds = tSize > 0 && tSize <= 28;
 
+/**
+* Any standard random engine, held by value, or by reference when given as a reference type (e.g. std::mt19937_64&)
+*/
+template<typename TRandom>
+concept SetRandomizerRandom = std::uniform_random_bit_generator<std::remove_reference_t<TRandom>>;
+
+/**
+* How random words are turned into permutations
+* Modulo: every word is used as is, reduced modulo its range. Permutations are very slightly biased
+* Rejection: words at or above the largest multiple of their range are drawn again, so every permutation is equally likely
+*/
+enum class SetRandomizerSampling : uint8_t
+{
+    Modulo,
+    Rejection
+};
+
 
 
 namespace Factoradics
@@ -62,6 +83,22 @@ public:
     static constexpr size_t cPermutationIndexesPerBlock = 20;
     using PermutationBlock = std::array<uint8_t, cPermutationIndexesPerBlock>;
 
+    /**
+    * One div, map, combine and shift of RepeatedShuffling, see SetRandomizer.cpp
+    */
+    struct RepeatedShuffleStep
+    {
+        uint32_t mStride = 1; // Place value of the base 20 digit that's mapped
+        uint32_t mMappedSize = 0; // Indexes below this have every digit up to and including the mapped one. The rest are only shifted
+        uint32_t mShift = 0;
+        uint8_t mBlockIndex = 0;
+    };
+
+    /**
+    * The largest set that numBlocks blocks shuffle as a single permutation. Larger sets are shuffled repeatedly instead
+    */
+    [[nodiscard]] static uint32_t GetMaxPermutationSetSize(size_t numBlocks) noexcept;
+
 private:
     enum class ShuffleDataSize : uint8_t
     {
@@ -80,55 +117,90 @@ private:
         RepeatedShufflingWithBlockMixing
     };
 
-    SetRandomizerInternal(uint32_t(*randomFunc)(), uint32_t setSize) noexcept
-        : mRandomFunc(randomFunc)
-        , mSetSize(setSize)
+    static constexpr size_t cRepeatedShufflePasses = 3;
+    static constexpr size_t cMaxRepeatedShuffleSteps = cRepeatedShufflePasses * 7; // A uint32_t set has at most 7 full base 20 digits
+
+    explicit SetRandomizerInternal(uint32_t setSize) noexcept
+        : mSetSize(setSize)
     {}
 
-    void RandomizeSingleBlock(SetRandomizerInternal::PermutationBlock& permutationBlock) noexcept;
+    /**
+    * Picks the shuffle mode for the set size, and returns how many random words Randomize then takes (at most numBlocks)
+    */
     template<ShuffleDataSize tDataSize>
-    void Randomize(std::span<SetRandomizerInternal::PermutationBlock> permutationBlocks);
+    [[nodiscard]] size_t PrepareRandomize(size_t numBlocks) noexcept;
+    [[nodiscard]] uint64_t GetWordRange(size_t wordIndex) const noexcept; // Randomize only uses each word modulo this
+    [[nodiscard]] const char* GetShuffleModeName() const noexcept;
+    void Randomize(std::span<const Factoradics::Bits::UnderlyingType> randomWords, std::span<SetRandomizerInternal::PermutationBlock> permutationBlocks);
 
-    void FillWithPermutationExtended(Factoradics::SetSize maxBlockIndex, std::span<SetRandomizerInternal::PermutationBlock>& permutationBlocks);
+    /**
+    * Rebuilds what Randomize derives from the blocks, for blocks that were filled earlier (see SetRandomizer::Deserialize)
+    * PrepareRandomize must already have returned numRandomWords for the same set size
+    */
+    [[nodiscard]] bool IsValidRandomized(std::span<const SetRandomizerInternal::PermutationBlock> permutationBlocks) const noexcept; // Every entry read is in range and none repeat
+    void RestoreRandomized(size_t numRandomWords, std::span<const SetRandomizerInternal::PermutationBlock> permutationBlocks) noexcept;
+    void PrepareRepeatedShuffleSteps(std::span<const SetRandomizerInternal::PermutationBlock> permutationBlocks) noexcept;
+    void FillWithPermutationExtended(std::span<const Factoradics::Bits::UnderlyingType> randomBits, std::span<SetRandomizerInternal::PermutationBlock>& permutationBlocks);
     [[nodiscard]] uint32_t GetWheeledIndex(uint32_t index, std::span<const SetRandomizerInternal::PermutationBlock> permutationBlocks) const;
-    [[nodiscard]] Factoradics::Bits MakeRandom() const;
+    void GetWheeledIndices(std::span<const uint32_t> indices, std::span<uint32_t> outWheeledIndices, std::span<const SetRandomizerInternal::PermutationBlock> permutationBlocks) const;
+    void FillInversePermutation(std::span<const SetRandomizerInternal::PermutationBlock> permutationBlocks, std::span<SetRandomizerInternal::PermutationBlock> inversePermutationBlocks) const;
+    [[nodiscard]] uint32_t GetUnwheeledIndex(uint32_t wheeledIndex, std::span<const SetRandomizerInternal::PermutationBlock> inversePermutationBlocks) const;
 
-    uint32_t(* const mRandomFunc)();
     uint32_t mSetSize = 0;
-    uint32_t mPermutationMultiplier = 0;
+    uint8_t mMaxBlockIndex = 0; // PermutationExtended fills blocks 0 to this
     ShuffleMode mShuffleMode = ShuffleMode::None;
+    uint8_t mNumRepeatedShuffleSteps = 0;
+    std::array<RepeatedShuffleStep, cMaxRepeatedShuffleSteps> mRepeatedShuffleSteps; // Derived from the blocks on each Randomize
 
-    template<size_t tPermutationBlocks> requires WithinPermutationBlockBounds<tPermutationBlocks> friend class SetRandomizer;
+    template<size_t tPermutationBlocks, typename TRandom> requires WithinPermutationBlockBounds<tPermutationBlocks> && SetRandomizerRandom<TRandom> friend class SetRandomizer;
 };
 
-template <size_t tPermutationBlocks> requires WithinPermutationBlockBounds<tPermutationBlocks>
+template <size_t tPermutationBlocks, typename TRandom = std::mt19937_64> requires WithinPermutationBlockBounds<tPermutationBlocks> && SetRandomizerRandom<TRandom>
 class SetRandomizer
 {
 public:
-    SetRandomizer(uint32_t(*randomFunc)(), uint32_t setSize) noexcept
-    : mInternalRandomizer(randomFunc, setSize)
+    SetRandomizer(TRandom random, uint32_t setSize, SetRandomizerSampling sampling = SetRandomizerSampling::Modulo) noexcept
+    : mRandom(std::forward<TRandom>(random))
+    , mInternalRandomizer(setSize)
+    , mSampling(sampling)
+    {
+        Randomize();
+    }
+
+    /**
+    * Seeds its own engine, and keeps the seed so Serialize can store the engine as seed and draw count
+    */
+    SetRandomizer(uint64_t seed, uint32_t setSize, SetRandomizerSampling sampling = SetRandomizerSampling::Modulo) noexcept
+        requires (!std::is_reference_v<TRandom>)
+    : mRandom(seed)
+    , mInternalRandomizer(setSize)
+    , mSampling(sampling)
+    , mSeed(seed)
+    , mHasSeed(true)
     {
         Randomize();
     }
 
     void Randomize()
     {
-        if constexpr (tPermutationBlocks == 1)
-        {
-            mInternalRandomizer.RandomizeSingleBlock(mPermutationIndexes[0]);
-        }
-        /**
-        * "6" is somewhat arbitrary here. Changing the number should have no actual impact on functionality.
-        * This branch is only done for the intent of runtime performance for some use cases
-        */
-        else if constexpr (tPermutationBlocks < 6)
+        const size_t numRandomWords = mInternalRandomizer.PrepareRandomize<cDataSize>(tPermutationBlocks);
+
+        std::array<Factoradics::Bits::UnderlyingType, tPermutationBlocks> randomWords;
+        if (mSampling == SetRandomizerSampling::Rejection)
         {
-            mInternalRandomizer.Randomize<SetRandomizerInternal::ShuffleDataSize::Small>(std::span(mPermutationIndexes));
+            MakeUnbiasedWords(std::span(randomWords.data(), numRandomWords));
         }
         else
         {
-            mInternalRandomizer.Randomize<SetRandomizerInternal::ShuffleDataSize::Large>(std::span(mPermutationIndexes));
+            for (size_t wordIndex = 0; wordIndex < numRandomWords; ++wordIndex)
+            {
+                randomWords[wordIndex] = MakeRandomWord();
+            }
         }
+        mInternalRandomizer.Randomize(std::span(randomWords.data(), numRandomWords), std::span(mPermutationIndexes));
+        mNumFilledBlocks = numRandomWords;
+
+        mInternalRandomizer.FillInversePermutation(std::span(mPermutationIndexes), std::span(mInversePermutationIndexes));
     }
 
     [[nodiscard]] uint32_t GetWheeledIndex(uint32_t index) const
@@ -136,10 +208,316 @@ public:
         return mInternalRandomizer.GetWheeledIndex(index, std::span(mPermutationIndexes));
     }
 
+    /**
+    * Where the element at wheeledIndex came from: GetUnwheeledIndex(GetWheeledIndex(i)) == i for every i in the set
+    */
+    [[nodiscard]] uint32_t GetUnwheeledIndex(uint32_t wheeledIndex) const
+    {
+        return mInternalRandomizer.GetUnwheeledIndex(wheeledIndex, std::span(mInversePermutationIndexes));
+    }
+
+    /**
+    * Same results as GetWheeledIndex on each index, but the shuffle mode is only dispatched once for the whole span
+    * Permutation lookups become a flat table lookup instead of a search over the blocks
+    */
+    void GetWheeledIndices(std::span<const uint32_t> indices, std::span<uint32_t> outWheeledIndices) const
+    {
+        mInternalRandomizer.GetWheeledIndices(indices, outWheeledIndices, std::span(mPermutationIndexes));
+    }
+
+    /**
+    * Calls func(index, wheeledIndex) for every index in [begin, end), mapped in batches
+    */
+    template<typename Func>
+    void ForEachWheeled(uint32_t begin, uint32_t end, Func&& func) const
+    {
+        std::array<uint32_t, cWheeledBatchSize> indices;
+        std::array<uint32_t, cWheeledBatchSize> wheeledIndices;
+        while (begin < end)
+        {
+            const uint32_t batchSize = std::min(end - begin, (uint32_t)cWheeledBatchSize);
+            std::iota(indices.begin(), indices.begin() + batchSize, begin);
+            GetWheeledIndices(std::span(indices.data(), batchSize), std::span(wheeledIndices.data(), batchSize));
+            for (uint32_t batchIndex = 0; batchIndex < batchSize; ++batchIndex)
+            {
+                func(begin + batchIndex, wheeledIndices[batchIndex]);
+            }
+            begin += batchSize;
+        }
+    }
+
+    /**
+    * Calls func(index, wheeledIndex, runnerIndex) for every index in the set, spread over the runners of threadPool
+    * The set is cut into chunks of cParallelChunkSize indexes, which idle runners claim one at a time until none are left
+    * Runners only read the randomizer (blocks and step table are all made by Randomize), so it must not be randomized meanwhile
+    * func is called concurrently, in no particular order across chunks
+    */
+    template<typename Func>
+    void ParallelForEachWheeled(ThreadPool& threadPool, Func&& func) const
+    {
+        const size_t setSize = GetSetSize();
+        const size_t numChunks = (setSize + cParallelChunkSize - 1) / cParallelChunkSize;
+        threadPool.ParallelFor(numChunks, [this, setSize, &func](size_t chunkIndex, size_t runnerIndex)
+        {
+            const size_t begin = chunkIndex * cParallelChunkSize;
+            const size_t end = std::min(begin + cParallelChunkSize, setSize);
+            ForEachWheeled((uint32_t)begin, (uint32_t)end, [&func, runnerIndex](uint32_t index, uint32_t wheeledIndex)
+            {
+                func(index, wheeledIndex, runnerIndex);
+            });
+        });
+    }
+
+    /**
+    * Appends the state to outBytes, so a long traversal can stop and pick up where it left off. Little endian:
+    * "SRST", uint32 version, uint32 set size, then uint8 block count, shuffle mode, sampling and whether the engine's seed
+    * is known. With a known seed, uint64 seed and uint64 engine draws since seeding follow. Then the blocks the last
+    * Randomize filled, 20 bytes each. A 1 block set is 52 bytes, 28 blocks of repeated shuffling 592.
+    * Without a known seed (the engine was given already seeded) the engine isn't part of the state, so restore it separately
+    * Everything derived from the blocks (inverse blocks, repeated shuffle steps) is rebuilt by Deserialize instead
+    */
+    void Serialize(std::string& outBytes) const
+    {
+        outBytes += "SRST";
+        AppendBinaryValue(outBytes, cBinaryVersion);
+        AppendBinaryValue(outBytes, mInternalRandomizer.mSetSize);
+        AppendBinaryValue(outBytes, (uint8_t)tPermutationBlocks);
+        AppendBinaryValue(outBytes, (uint8_t)mInternalRandomizer.mShuffleMode);
+        AppendBinaryValue(outBytes, (uint8_t)mSampling);
+        AppendBinaryValue(outBytes, (uint8_t)mHasSeed);
+        if (mHasSeed)
+        {
+            AppendBinaryValue(outBytes, mSeed);
+            AppendBinaryValue(outBytes, mNumRandomDraws);
+        }
+        outBytes.append((const char*)mPermutationIndexes.data(), mNumFilledBlocks * sizeof(SetRandomizerInternal::PermutationBlock));
+    }
+
+    /**
+    * Replaces the state with one from Serialize, and returns how many bytes were read, or 0 (leaving the state alone) when
+    * the bytes aren't a valid state of this version and block count. Every block must be a permutation of the positions
+    * its shuffle mode reads, so a damaged blob is turned away rather than indexing out of bounds.
+    * Nothing is replayed: GetWheeledIndex(k) resumes at any k straight away. A seeded engine is reseeded and discards
+    * the draws it had made, so the next Randomize continues its stream
+    */
+    size_t Deserialize(std::string_view bytes)
+    {
+        std::string_view remaining = bytes;
+        uint32_t version = 0;
+        uint32_t setSize = 0;
+        uint8_t numBlocks = 0;
+        uint8_t shuffleMode = 0;
+        uint8_t sampling = 0;
+        uint8_t hasSeed = 0;
+        uint64_t seed = 0;
+        uint64_t numRandomDraws = 0;
+        if (!remaining.starts_with("SRST"))
+        {
+            return 0;
+        }
+        remaining.remove_prefix(4);
+        if (!ReadBinaryValue(remaining, version) || (version != cBinaryVersion)
+            || !ReadBinaryValue(remaining, setSize)
+            || !ReadBinaryValue(remaining, numBlocks) || (numBlocks != tPermutationBlocks)
+            || !ReadBinaryValue(remaining, shuffleMode)
+            || !ReadBinaryValue(remaining, sampling) || (sampling > (uint8_t)SetRandomizerSampling::Rejection)
+            || !ReadBinaryValue(remaining, hasSeed) || (hasSeed > 1))
+        {
+            return 0;
+        }
+        if (hasSeed && (!ReadBinaryValue(remaining, seed) || !ReadBinaryValue(remaining, numRandomDraws)))
+        {
+            return 0;
+        }
+
+        // The shuffle mode only depends on the set size, so a mismatch means the blob came from a different build
+        SetRandomizerInternal internalRandomizer(setSize);
+        const size_t numRandomWords = internalRandomizer.PrepareRandomize<cDataSize>(tPermutationBlocks);
+        const size_t numFilledBytes = numRandomWords * sizeof(SetRandomizerInternal::PermutationBlock);
+        if ((shuffleMode != (uint8_t)internalRandomizer.mShuffleMode) || (remaining.size() < numFilledBytes))
+        {
+            return 0;
+        }
+
+        // Blocks past the filled ones are never read, so they keep whatever they held
+        std::array<SetRandomizerInternal::PermutationBlock, tPermutationBlocks> permutationIndexes = mPermutationIndexes;
+        std::memcpy(permutationIndexes.data(), remaining.data(), numFilledBytes);
+        remaining.remove_prefix(numFilledBytes);
+        if (!internalRandomizer.IsValidRandomized(std::span(permutationIndexes)))
+        {
+            return 0;
+        }
+
+        if (hasSeed)
+        {
+            if constexpr (requires(Random& random) { Random(seed); random.discard(numRandomDraws); })
+            {
+                mRandom = Random(seed);
+                mRandom.discard(numRandomDraws);
+            }
+            else
+            {
+                return 0;
+            }
+        }
+        mHasSeed = (hasSeed != 0);
+        mSeed = seed;
+        mNumRandomDraws = numRandomDraws;
+
+        internalRandomizer.RestoreRandomized(numRandomWords, std::span(permutationIndexes));
+        mInternalRandomizer = internalRandomizer;
+        mSampling = (SetRandomizerSampling)sampling;
+        mPermutationIndexes = permutationIndexes;
+        mNumFilledBlocks = numRandomWords;
+        mInternalRandomizer.FillInversePermutation(std::span(mPermutationIndexes), std::span(mInversePermutationIndexes));
+        return bytes.size() - remaining.size();
+    }
+
+    static constexpr uint32_t cBinaryVersion = 2; // Serialize
+
     [[nodiscard]] uint32_t GetSetSize() const { return mInternalRandomizer.mSetSize; }
+    [[nodiscard]] const char* GetShuffleModeName() const { return mInternalRandomizer.GetShuffleModeName(); } // How the current set size is shuffled
+    [[nodiscard]] SetRandomizerSampling GetSampling() const { return mSampling; }
+    void SetSampling(SetRandomizerSampling sampling) { mSampling = sampling; } // Takes effect on the next Randomize
     [[nodiscard]] consteval size_t GetNumBlocks() const { return tPermutationBlocks; }
 
 private:
+    using Random = std::remove_reference_t<TRandom>;
+
+    /**
+    * "6" is somewhat arbitrary here. Changing the number should have no actual impact on functionality.
+    * This branch is only done for the intent of runtime performance for some use cases
+    */
+    static constexpr SetRandomizerInternal::ShuffleDataSize cDataSize =
+        (tPermutationBlocks == 1) ? SetRandomizerInternal::ShuffleDataSize::Single :
+        (tPermutationBlocks < 6) ? SetRandomizerInternal::ShuffleDataSize::Small :
+        SetRandomizerInternal::ShuffleDataSize::Large;
+
+    static constexpr size_t cWheeledBatchSize = 256;
+    static constexpr size_t cParallelChunkSize = cWheeledBatchSize * 16; // 16KB of wheeled indexes, so a chunk's output stays in L1
+
+    /**
+    * 63 random bits, from one call when the engine makes 64 bits at a time
+    */
+    [[nodiscard]] Factoradics::Bits::UnderlyingType MakeRandomWord()
+    {
+        if constexpr ((Random::min() == 0) && (Random::max() == std::numeric_limits<uint64_t>::max()))
+        {
+            return (Factoradics::Bits::UnderlyingType)(DrawRandom() & INT64_MAX);
+        }
+        else if constexpr ((Random::min() == 0) && (Random::max() == std::numeric_limits<uint32_t>::max()))
+        {
+            const Factoradics::Bits::UnderlyingType highBits = (Factoradics::Bits::UnderlyingType)DrawRandom();
+            return ((highBits << 32) & INT64_MAX) | (Factoradics::Bits::UnderlyingType)DrawRandom();
+        }
+        else
+        {
+            CountingRandom countingRandom{ *this };
+            return std::uniform_int_distribution<Factoradics::Bits::UnderlyingType>(0, INT64_MAX)(countingRandom);
+        }
+    }
+
+    /**
+    * Every value taken from the engine goes through here, so a seeded engine can be restored with seed and discard
+    */
+    [[nodiscard]] typename Random::result_type DrawRandom()
+    {
+        ++mNumRandomDraws;
+        return mRandom();
+    }
+
+    struct CountingRandom
+    {
+        using result_type = typename Random::result_type;
+        static constexpr result_type min() { return Random::min(); }
+        static constexpr result_type max() { return Random::max(); }
+        result_type operator()() { return mRandomizer.DrawRandom(); }
+
+        SetRandomizer& mRandomizer;
+    };
+
+    /**
+    * Words uniform over each word's range, for SetRandomizerSampling::Rejection
+    * Whatever a draw has left after its word is taken (the quotient, or how far past the limit a rejected draw was)
+    * is still uniform, so it's pooled and spent on the next words before the engine is called again
+    */
+    void MakeUnbiasedWords(std::span<Factoradics::Bits::UnderlyingType> outWords)
+    {
+        uint64_t pool = 0;
+        uint64_t poolRange = 1;
+        for (size_t wordIndex = 0; wordIndex < outWords.size(); ++wordIndex)
+        {
+            const uint64_t range = mInternalRandomizer.GetWordRange(wordIndex);
+            while (true)
+            {
+                uint64_t value = pool;
+                uint64_t valueRange = poolRange;
+                pool = 0;
+                poolRange = 1;
+                if (valueRange < range)
+                {
+                    AddToPool(pool, poolRange, value, valueRange);
+                    value = (uint64_t)MakeRandomWord();
+                    valueRange = cWordRange;
+                }
+
+                const uint64_t limit = valueRange - (valueRange % range);
+                if (value < limit)
+                {
+                    outWords[wordIndex] = (Factoradics::Bits::UnderlyingType)(value % range);
+                    AddToPool(pool, poolRange, value / range, limit / range);
+                    break;
+                }
+                AddToPool(pool, poolRange, value - limit, valueRange - limit);
+            }
+        }
+    }
+
+    /**
+    * Combines two uniform values into one while the combined range fits in a word, otherwise keeps the wider one
+    */
+    static void AddToPool(uint64_t& inOutPool, uint64_t& inOutPoolRange, uint64_t value, uint64_t valueRange)
+    {
+        if (inOutPoolRange <= (cWordRange / valueRange))
+        {
+            inOutPool = (inOutPool * valueRange) + value;
+            inOutPoolRange *= valueRange;
+        }
+        else if (valueRange > inOutPoolRange)
+        {
+            inOutPool = value;
+            inOutPoolRange = valueRange;
+        }
+    }
+
+    template<typename T>
+    static void AppendBinaryValue(std::string& outBytes, T value)
+    {
+        outBytes.append((const char*)&value, sizeof(value));
+    }
+
+    template<typename T>
+    static bool ReadBinaryValue(std::string_view& inOutBytes, T& outValue)
+    {
+        if (inOutBytes.size() < sizeof(outValue))
+        {
+            return false;
+        }
+        std::memcpy(&outValue, inOutBytes.data(), sizeof(outValue));
+        inOutBytes.remove_prefix(sizeof(outValue));
+        return true;
+    }
+
+    static constexpr uint64_t cWordRange = 1ull << 63; // MakeRandomWord
+
+    TRandom mRandom;
     SetRandomizerInternal mInternalRandomizer;
+    SetRandomizerSampling mSampling = SetRandomizerSampling::Modulo;
     alignas(16) std::array<SetRandomizerInternal::PermutationBlock, tPermutationBlocks> mPermutationIndexes;
+    alignas(16) std::array<SetRandomizerInternal::PermutationBlock, tPermutationBlocks> mInversePermutationIndexes;
+    size_t mNumFilledBlocks = 0; // By the last Randomize. Serialize only stores these
+
+    uint64_t mSeed = 0;
+    uint64_t mNumRandomDraws = 0; // Values taken from the engine, since seeding when the seed is known
+    bool mHasSeed = false;
 };
\ No newline at end of file
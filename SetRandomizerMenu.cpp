@@ -1,21 +1,16 @@
 #include "SetRandomizerMenu.h"
 
 #include "SetRandomizer.h"
+#include "SetRandomizerQuality.h"
+#include "LazyElementShuffler.h"
 #include "MathPrint.h"
 
 #include <random>
 
-std::mt19937 sDist;
-
 namespace
 {
-    uint32_t RandomNumber()
-    {
-        return sDist();
-    }
-
-    template<size_t Blocks>
-    void PrintRandomizer(SetRandomizer<Blocks>& randomizer)
+    template<size_t Blocks, typename TRandom>
+    void PrintRandomizer(SetRandomizer<Blocks, TRandom>& randomizer)
     {
         const uint64_t setSize = randomizer.GetSetSize();
         uint32_t padding = 1;
@@ -36,18 +31,19 @@ namespace
         std::vector<uint32_t> results;
         uint32_t index = 0;
         uint32_t numErrors = 0;
-        uint32_t totalTime = 0;
+
+        // Timed as one batch, a clock read per entry would cost more than the entry. See "qs" for throughput
+        std::vector<uint32_t> indices(setSize);
+        std::iota(indices.begin(), indices.end(), 0);
+        results.resize(setSize);
+        const std::chrono::high_resolution_clock::time_point startTime = std::chrono::high_resolution_clock::now();
+        randomizer.GetWheeledIndices(indices, results);
+        const std::chrono::high_resolution_clock::time_point endTime = std::chrono::high_resolution_clock::now();
+        const uint32_t totalTime = (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - startTime).count();
 
         {
-            for (index = 0; index < setSize; ++index)
+            for (const uint32_t val : results)
             {
-                const std::chrono::high_resolution_clock::time_point t1 = std::chrono::high_resolution_clock::now();
-                const uint32_t val = randomizer.GetWheeledIndex(static_cast<uint32_t>(index));
-                const std::chrono::high_resolution_clock::time_point t2 = std::chrono::high_resolution_clock::now();
-                totalTime += (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(t2 - t1).count();
-
-                results.push_back(val);
-
                 if (existing.find(val) == existing.end())
                 {
                     existing.insert(val);
@@ -105,6 +101,65 @@ namespace
         printf("\n^ SetSize: %llu, Blocks: %u, Num Errors: %u, Time: %uns, Time per Entry: %uns", 
             setSize, (uint32_t)Blocks, numErrors, totalTime, timePerEntry);
     }
+
+    /**
+    * Nanoseconds per Randomize for a set as large as Blocks blocks shuffle in one permutation
+    */
+    template<size_t Blocks>
+    double TimeRandomize(std::mt19937_64& random, uint64_t numPasses, SetRandomizerSampling sampling)
+    {
+        SetRandomizer<Blocks, std::mt19937_64&> randomizer(random, SetRandomizerInternal::GetMaxPermutationSetSize(Blocks), sampling);
+        const std::chrono::high_resolution_clock::time_point startTime = std::chrono::high_resolution_clock::now();
+        for (uint64_t pass = 0; pass < numPasses; ++pass)
+        {
+            randomizer.Randomize();
+        }
+        const std::chrono::high_resolution_clock::time_point endTime = std::chrono::high_resolution_clock::now();
+        return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - startTime).count() / (double)numPasses;
+    }
+
+    template<size_t... tBlocks>
+    std::array<double, sizeof...(tBlocks)> TimeRandomizeEachBlockCount(std::mt19937_64& random, uint64_t numPasses, SetRandomizerSampling sampling, std::index_sequence<tBlocks...>)
+    {
+        return { TimeRandomize<tBlocks + 1>(random, numPasses, sampling)... };
+    }
+
+    /**
+    * Counts indexes of the set that don't come back from GetUnwheeledIndex(GetWheeledIndex(index))
+    * or whose wheeled index is outside the set or repeated, plus indices from setSize up that don't map to themselves
+    */
+    template<size_t Blocks>
+    uint64_t CountInverseErrors(std::mt19937_64& random, uint32_t setSize)
+    {
+        const SetRandomizer<Blocks, std::mt19937_64&> randomizer(random, setSize);
+        std::vector<bool> seen(setSize);
+        uint64_t numErrors = 0;
+        randomizer.ForEachWheeled(0, setSize, [&](uint32_t index, uint32_t wheeledIndex)
+        {
+            if ((wheeledIndex >= setSize) || seen[wheeledIndex] || (randomizer.GetUnwheeledIndex(wheeledIndex) != index))
+            {
+                ++numErrors;
+            }
+            else
+            {
+                seen[wheeledIndex] = true;
+            }
+        });
+
+        // Indices past the set, starting right at the boundary, are left alone by every lookup
+        const std::array<uint32_t, 3> outsideIndices = { setSize, setSize + 1, std::numeric_limits<uint32_t>::max() };
+        std::array<uint32_t, 3> outsideWheeledIndices = {};
+        randomizer.GetWheeledIndices(outsideIndices, outsideWheeledIndices);
+        for (size_t i = 0; i < outsideIndices.size(); ++i)
+        {
+            const uint32_t index = outsideIndices[i];
+            if ((randomizer.GetWheeledIndex(index) != index) || (randomizer.GetUnwheeledIndex(index) != index) || (outsideWheeledIndices[i] != index))
+            {
+                ++numErrors;
+            }
+        }
+        return numErrors;
+    }
 }
 
 
@@ -137,6 +192,12 @@ SetRandomizerMenu::SetRandomizerMenu(const char* const input, ConsoleMenu& paren
     mMenuVisualize.AddCommand("tl", "Test Large", [this]() { Cmd_TestLarge(); });
     mMenuVisualize.AddCommand("tv", "Test Various", [this]() { Cmd_TestVarious(); });
 
+    mMenu.AddCommand("bw", "Benchmark Wheeled Indices: One at a time vs Batched (28 blocks);dSet Size;dPasses", [this](uint64_t setSize, uint64_t numPasses) { Cmd_BenchmarkWheeledIndices(setSize, numPasses); });
+    mMenu.AddCommand("br", "Benchmark Randomize: Reseed cost for every block count (1 to 28), Modulo vs Rejection sampling;dPasses", [this](uint64_t numPasses) { Cmd_BenchmarkRandomize(numPasses); });
+    mMenu.AddCommand("qs", "Quality Suite: Throughput and uniformity per set size, block count and sampling, to Data/SetRandomizerQuality.csv;dTrials;dThreads", [this](uint64_t numTrials, uint64_t numThreads) { Cmd_QualitySuite(numTrials, numThreads); });
+    mMenu.AddCommand("lz", "Lazy Shuffler: Walk a shuffled order of any size;dSet Size;dSteps", [this](uint64_t setSize, uint64_t numSteps) { Cmd_LazyShuffle(setSize, numSteps); });
+    mMenu.AddCommand("lu", "Lazy Shuffler Uniformity: Pairs of shuffled indexes at small set sizes;dTrials per Pair", [this](uint64_t numTrialsPerPair) { Cmd_LazyUniformity(numTrialsPerPair); });
+    mMenu.AddCommand("ti", "Test Inverse: Unwheeling every wheeled index gives it back;dMax Set Size;dSet Size Step", [this](uint64_t maxSetSize, uint64_t setSizeStep) { Cmd_TestInverse(maxSetSize, setSizeStep); });
     mMenu.AddCommand("mdt", "Make Docs: Transformer;dSet Size", [this](uint64_t setSize) { Cmd_MakeDocs_Transformer(setSize); });
     mMenu.AddCommand("mds", "Make Docs: Standard Transform in cpp", [this]() { Cmd_MakeDocs_StandardTransform(); });
 }
@@ -144,35 +205,35 @@ SetRandomizerMenu::SetRandomizerMenu(const char* const input, ConsoleMenu& paren
 void SetRandomizerMenu::Cmd_VisualizeN_1(uint64_t n)
 {
     Reseed();
-    SetRandomizer<1> randomizer(&RandomNumber, (uint32_t)n);
+    SetRandomizer<1, std::mt19937_64&> randomizer(mRandom, (uint32_t)n);
     PrintRandomizer(randomizer);
 }
 
 void SetRandomizerMenu::Cmd_VisualizeN_2(uint64_t n)
 {
     Reseed();
-    SetRandomizer<2> randomizer(&RandomNumber, (uint32_t)n);
+    SetRandomizer<2, std::mt19937_64&> randomizer(mRandom, (uint32_t)n);
     PrintRandomizer(randomizer);
 }
 
 void SetRandomizerMenu::Cmd_VisualizeN_3(uint64_t n)
 {
     Reseed();
-    SetRandomizer<3> randomizer(&RandomNumber, (uint32_t)n);
+    SetRandomizer<3, std::mt19937_64&> randomizer(mRandom, (uint32_t)n);
     PrintRandomizer(randomizer);
 }
 
 void SetRandomizerMenu::Cmd_VisualizeN_13(uint64_t n)
 {
     Reseed();
-    SetRandomizer<13> randomizer(&RandomNumber, (uint32_t)n);
+    SetRandomizer<13, std::mt19937_64&> randomizer(mRandom, (uint32_t)n);
     PrintRandomizer(randomizer);
 }
 
 void SetRandomizerMenu::Cmd_VisualizeN_28(uint64_t n)
 {
     Reseed();
-    SetRandomizer<28> randomizer(&RandomNumber, (uint32_t)n);
+    SetRandomizer<28, std::mt19937_64&> randomizer(mRandom, (uint32_t)n);
     PrintRandomizer(randomizer);
 }
 
@@ -200,6 +261,185 @@ void SetRandomizerMenu::Cmd_TestLarge()
     Cmd_VisualizeN_13(4680);  printf("\n\n");
 }
 
+void SetRandomizerMenu::Cmd_BenchmarkWheeledIndices(uint64_t setSize, uint64_t numPasses)
+{
+    Reseed();
+    const SetRandomizer<28, std::mt19937_64&> randomizer(mRandom, (uint32_t)setSize);
+    numPasses = std::max<uint64_t>(numPasses, 1);
+
+    std::vector<uint32_t> indices(setSize);
+    std::iota(indices.begin(), indices.end(), 0);
+    std::vector<uint32_t> scalarResults(setSize);
+    std::vector<uint32_t> batchedResults(setSize);
+
+    const std::chrono::high_resolution_clock::time_point scalarStart = std::chrono::high_resolution_clock::now();
+    for (uint64_t pass = 0; pass < numPasses; ++pass)
+    {
+        for (size_t index = 0; index < indices.size(); ++index)
+        {
+            scalarResults[index] = randomizer.GetWheeledIndex(indices[index]);
+        }
+    }
+    const std::chrono::high_resolution_clock::time_point batchedStart = std::chrono::high_resolution_clock::now();
+    for (uint64_t pass = 0; pass < numPasses; ++pass)
+    {
+        randomizer.GetWheeledIndices(indices, batchedResults);
+    }
+    const std::chrono::high_resolution_clock::time_point batchedEnd = std::chrono::high_resolution_clock::now();
+
+    uint64_t forEachMismatches = 0;
+    randomizer.ForEachWheeled(0, (uint32_t)setSize, [&](uint32_t index, uint32_t wheeledIndex) { forEachMismatches += (wheeledIndex != scalarResults[index]); });
+
+    const double numLookups = (double)setSize * (double)numPasses;
+    const double scalarNs = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(batchedStart - scalarStart).count() / std::max(numLookups, 1.0);
+    const double batchedNs = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(batchedEnd - batchedStart).count() / std::max(numLookups, 1.0);
+    const uint64_t mismatches = (uint64_t)std::inner_product(scalarResults.begin(), scalarResults.end(), batchedResults.begin(), (uint64_t)0, std::plus<>(), std::not_equal_to<>());
+
+    printf("\nSetSize: %llu, Passes: %llu", setSize, numPasses);
+    printf("\nOne at a time: %.2fns per index", scalarNs);
+    printf("\nBatched:       %.2fns per index (%.2fx)", batchedNs, (batchedNs > 0.0) ? (scalarNs / batchedNs) : 0.0);
+    printf("\nMismatches: %llu batched, %llu ForEachWheeled", mismatches, forEachMismatches);
+}
+
+void SetRandomizerMenu::Cmd_BenchmarkRandomize(uint64_t numPasses)
+{
+    Reseed();
+    numPasses = std::max<uint64_t>(numPasses, 1);
+    const std::array<double, 28> moduloNs = TimeRandomizeEachBlockCount(mRandom, numPasses, SetRandomizerSampling::Modulo, std::make_index_sequence<28>());
+    const std::array<double, 28> rejectionNs = TimeRandomizeEachBlockCount(mRandom, numPasses, SetRandomizerSampling::Rejection, std::make_index_sequence<28>());
+
+    printf("\nPasses: %llu, ns per Randomize", numPasses);
+    printf("\nBlocks  SetSize    Modulo  Rejection  (Cost)");
+    for (size_t blockIndex = 0; blockIndex < moduloNs.size(); ++blockIndex)
+    {
+        const uint32_t setSize = SetRandomizerInternal::GetMaxPermutationSetSize(blockIndex + 1);
+        const double cost = (moduloNs[blockIndex] > 0.0) ? (rejectionNs[blockIndex] / moduloNs[blockIndex]) : 0.0;
+        printf("\n%6zu  %7u  %8.1f  %9.1f  (%.2fx)", blockIndex + 1, setSize, moduloNs[blockIndex], rejectionNs[blockIndex], cost);
+    }
+}
+
+void SetRandomizerMenu::Cmd_QualitySuite(uint64_t numTrials, uint64_t numThreads)
+{
+    Reseed();
+    SetRandomizerQualityConfig config = SetRandomizerQualityConfig::MakeDefault();
+    config.mNumTrials = numTrials;
+    config.mNumThreads = (size_t)numThreads;
+
+    printf("\nRunning...");
+    SetRandomizerQuality quality(config);
+    quality.Run(mRandom());
+    quality.PrintSummary();
+
+    if (quality.WriteCSV("Data/SetRandomizerQuality.csv"))
+    {
+        printf("Wrote Data/SetRandomizerQuality.csv\n");
+    }
+}
+
+void SetRandomizerMenu::Cmd_LazyShuffle(uint64_t setSize, uint64_t numSteps)
+{
+    Reseed();
+    const uint64_t seed = mRandom();
+    const LazyElementShuffler::ArbitraryShuffler shuffler(setSize, seed);
+    numSteps = std::min(numSteps, setSize);
+
+    printf("\nFirst of the shuffled order:");
+    for (uint64_t index = 0; index < std::min<uint64_t>(numSteps, 16); ++index)
+    {
+        printf(" %llu", shuffler.Get(index));
+    }
+
+    // Small enough sets are walked in full, to check every index comes out exactly once
+    constexpr uint64_t cMaxCheckedSetSize = 1ull << 28;
+    std::vector<bool> seen((setSize <= cMaxCheckedSetSize) ? setSize : 0);
+    uint64_t numErrors = 0;
+
+    const std::chrono::high_resolution_clock::time_point startTime = std::chrono::high_resolution_clock::now();
+    for (uint64_t index = 0; index < numSteps; ++index)
+    {
+        const uint64_t shuffledIndex = shuffler.Get(index);
+        if (shuffledIndex >= setSize)
+        {
+            ++numErrors;
+        }
+        else if (!seen.empty())
+        {
+            numErrors += seen[shuffledIndex];
+            seen[shuffledIndex] = true;
+        }
+    }
+    const std::chrono::high_resolution_clock::time_point endTime = std::chrono::high_resolution_clock::now();
+
+    const double totalNs = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - startTime).count();
+    printf("\nSetSize: %llu, Steps: %llu, Num Errors: %llu, Time per Entry: %.2fns", setSize, numSteps, numErrors, totalNs / (double)std::max<uint64_t>(numSteps, 1));
+}
+
+void SetRandomizerMenu::Cmd_LazyUniformity(uint64_t numTrialsPerPair)
+{
+    Reseed();
+    numTrialsPerPair = std::max<uint64_t>(numTrialsPerPair, 1);
+
+    // Either side of the switch from the shuffled table to the Feistel network, and the sizes it used to fail at
+    constexpr std::array<uint64_t, 7> cSetSizes = { 2, 3, 21, 40, 100, 256, 257 };
+    constexpr double cMaxPassingZ = 5.0;
+
+    uint64_t numFailed = 0;
+    for (const uint64_t setSize : cSetSizes)
+    {
+        const uint64_t numPairs = setSize * (setSize - 1);
+        const uint64_t numTrials = numPairs * numTrialsPerPair;
+        // Every ordered pair (Get(0), Get(1)) should come up equally often over many seeds, even consecutive ones
+        const uint64_t firstSeed = mRandom();
+        std::vector<uint32_t> pairCounts(setSize * setSize);
+        for (uint64_t trial = 0; trial < numTrials; ++trial)
+        {
+            const LazyElementShuffler::ArbitraryShuffler shuffler(setSize, firstSeed + trial);
+            ++pairCounts[(shuffler.Get(0) * setSize) + shuffler.Get(1)];
+        }
+
+        double chiSquare = 0.0;
+        for (uint64_t first = 0; first < setSize; ++first)
+        {
+            for (uint64_t second = 0; second < setSize; ++second)
+            {
+                if (first != second)
+                {
+                    const double difference = (double)pairCounts[(first * setSize) + second] - (double)numTrialsPerPair;
+                    chiSquare += (difference * difference) / (double)numTrialsPerPair;
+                }
+            }
+        }
+
+        const double z = SetRandomizerQuality::GetChiSquareZ(chiSquare, numPairs - 1);
+        const bool bPassed = std::abs(z) < cMaxPassingZ;
+        numFailed += bPassed ? 0 : 1;
+        printf("\nSetSize: %llu, Trials: %llu, Pair Z: %.2f %s", setSize, numTrials, z, bPassed ? "" : "FAILED");
+    }
+
+    printf("\n%s", (numFailed == 0) ? "Every set size is uniform" : "Some set sizes are not uniform");
+}
+
+void SetRandomizerMenu::Cmd_TestInverse(uint64_t maxSetSize, uint64_t setSizeStep)
+{
+    Reseed();
+    setSizeStep = std::max<uint64_t>(setSizeStep, 1);
+
+    std::array<uint64_t, 5> numErrors = {};
+    uint64_t numSetSizes = 0;
+    for (uint64_t setSize = 0; setSize <= maxSetSize; setSize += setSizeStep)
+    {
+        numErrors[0] += CountInverseErrors<1>(mRandom, (uint32_t)setSize);
+        numErrors[1] += CountInverseErrors<2>(mRandom, (uint32_t)setSize);
+        numErrors[2] += CountInverseErrors<3>(mRandom, (uint32_t)setSize);
+        numErrors[3] += CountInverseErrors<13>(mRandom, (uint32_t)setSize);
+        numErrors[4] += CountInverseErrors<28>(mRandom, (uint32_t)setSize);
+        ++numSetSizes;
+    }
+
+    printf("\n%llu set sizes up to %llu. Num Errors by block count: 1: %llu, 2: %llu, 3: %llu, 13: %llu, 28: %llu",
+        numSetSizes, maxSetSize, numErrors[0], numErrors[1], numErrors[2], numErrors[3], numErrors[4]);
+}
+
 struct SetRandomizerTNode
 {
     SetRandomizerTNode(SetRandomizerMenu& parent, uint64_t inNumericalValue)
@@ -503,5 +743,5 @@ void SetRandomizerMenu::Reseed()
 {
     const std::chrono::high_resolution_clock::time_point time = std::chrono::high_resolution_clock::now();
     const uint32_t timeSinceStart = (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(time - mStartTime).count();
-    sDist.seed(timeSinceStart);
+    mRandom.seed(timeSinceStart);
 }
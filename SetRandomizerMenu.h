@@ -1,6 +1,7 @@
 #pragma once
 #include "ConsoleMenu.h"
 #include <chrono>
+#include <random>
 
 struct SetRandomizerTNode;
 
@@ -17,6 +18,12 @@ private:
     void Cmd_VisualizeN_28(uint64_t n);
     void Cmd_TestVarious();
     void Cmd_TestLarge();
+    void Cmd_BenchmarkWheeledIndices(uint64_t setSize, uint64_t numPasses);
+    void Cmd_BenchmarkRandomize(uint64_t numPasses);
+    void Cmd_QualitySuite(uint64_t numTrials, uint64_t numThreads);
+    void Cmd_LazyShuffle(uint64_t setSize, uint64_t numSteps);
+    void Cmd_LazyUniformity(uint64_t numTrialsPerPair);
+    void Cmd_TestInverse(uint64_t maxSetSize, uint64_t setSizeStep);
 
     void Cmd_MakeDocs_Transformer(uint64_t setSize);
     void Cmd_MakeDocs_StandardTransform();
@@ -39,6 +46,7 @@ private:
     uint64_t mTransformerLimit = 0;
 
     const std::chrono::high_resolution_clock::time_point mStartTime;
+    std::mt19937_64 mRandom; // Shared by every randomizer the menu makes, seeded by Reseed
 
     friend struct SetRandomizerTNode;
 };
@@ -0,0 +1,436 @@
+#include "SetRandomizerQuality.h"
+
+#include <chrono>
+#include <intrin.h>
+#include <mutex>
+#include "ThreadPool.h"
+
+static const char* const kSamplingNames[] = { "Modulo", "Rejection" }; // By SetRandomizerSampling
+
+namespace
+{
+    struct alignas(64) RunnerCount // A cache line each, so runners don't contend over neighbouring counts
+    {
+        uint64_t mCount = 0;
+    };
+}
+
+/*static*/ SetRandomizerQualityConfig SetRandomizerQualityConfig::MakeDefault()
+{
+    SetRandomizerQualityConfig config;
+    config.mSetSizes = { 2, 3, 7, 20, 21, 33, 34, 64, 100, 137, 254, 255, 500, 1000, 100000, 1000000, 9999991 };
+    config.mNumBlocks = { 1, 3, 28 };
+    config.mSamplings = { SetRandomizerSampling::Modulo, SetRandomizerSampling::Rejection };
+    return config;
+}
+
+std::vector<uint32_t> SetRandomizerQualityConfig::MakeBijectionSetSizes() const
+{
+    std::vector<uint32_t> setSizes;
+    const double logMin = std::log(2.0);
+    const double logMax = std::log((double)cMaxBijectionSetSize);
+    for (uint32_t i = 0; i < mNumBijectionSetSizes; ++i)
+    {
+        const double t = (mNumBijectionSetSizes > 1) ? ((double)i / (double)(mNumBijectionSetSizes - 1)) : 1.0;
+        const uint32_t setSize = (uint32_t)std::llround(std::exp(logMin + ((logMax - logMin) * t)));
+        const bool bAlreadyAdded = (!setSizes.empty() && (setSizes.back() == setSize))
+            || (std::find(mSetSizes.begin(), mSetSizes.end(), setSize) != mSetSizes.end());
+        if (!bAlreadyAdded)
+        {
+            setSizes.push_back(setSize);
+        }
+    }
+    return setSizes;
+}
+
+SetRandomizerQuality::SetRandomizerQuality(const SetRandomizerQualityConfig& config)
+: mConfig(config)
+{
+    for (uint32_t setSize : mConfig.mSetSizes)
+    for (size_t numBlocks : mConfig.mNumBlocks)
+    for (SetRandomizerSampling sampling : mConfig.mSamplings)
+    {
+        if (std::find(SetRandomizerQualityConfig::cSupportedNumBlocks.begin(), SetRandomizerQualityConfig::cSupportedNumBlocks.end(), numBlocks) == SetRandomizerQualityConfig::cSupportedNumBlocks.end())
+        {
+            printf("\nSkipping %zu blocks, which isn't one of the supported block counts", numBlocks);
+            continue;
+        }
+
+        SetRandomizerQualityCell& cell = mCells.emplace_back();
+        cell.mSetSize = setSize;
+        cell.mNumBlocks = numBlocks;
+        cell.mSampling = sampling;
+    }
+
+    const std::vector<uint32_t> bijectionSetSizes = mConfig.MakeBijectionSetSizes();
+    for (size_t numBlocks : mConfig.mNumBlocks)
+    for (SetRandomizerSampling sampling : mConfig.mSamplings)
+    for (uint32_t setSize : bijectionSetSizes)
+    {
+        if (std::find(SetRandomizerQualityConfig::cSupportedNumBlocks.begin(), SetRandomizerQualityConfig::cSupportedNumBlocks.end(), numBlocks) == SetRandomizerQualityConfig::cSupportedNumBlocks.end())
+        {
+            continue;
+        }
+
+        SetRandomizerQualityCell& cell = mCells.emplace_back();
+        cell.mSetSize = setSize;
+        cell.mNumBlocks = numBlocks;
+        cell.mSampling = sampling;
+        cell.mBijectionOnly = true;
+    }
+}
+
+void SetRandomizerQuality::Run(uint64_t seed)
+{
+    const std::chrono::high_resolution_clock::time_point startTime = std::chrono::high_resolution_clock::now();
+
+    ThreadPool threadPool(mConfig.mNumThreads);
+    for (size_t cellIndex = 0; cellIndex < mCells.size(); ++cellIndex)
+    {
+        // Seeded per cell so a cell's results don't depend on which cells run with it
+        RunCell(mCells[cellIndex], seed ^ (cellIndex * 0x9E3779B97F4A7C15ull), threadPool);
+    }
+
+    const std::chrono::high_resolution_clock::time_point endTime = std::chrono::high_resolution_clock::now();
+    mRunSeconds = std::chrono::duration<double>(endTime - startTime).count();
+}
+
+void SetRandomizerQuality::RunCell(SetRandomizerQualityCell& cell, uint64_t seed, ThreadPool& threadPool) const
+{
+    if (cell.mBijectionOnly)
+    {
+        switch (cell.mNumBlocks)
+        {
+        case 1: TestCellBijection<1>(cell, seed, threadPool); break;
+        case 2: TestCellBijection<2>(cell, seed, threadPool); break;
+        case 3: TestCellBijection<3>(cell, seed, threadPool); break;
+        case 13: TestCellBijection<13>(cell, seed, threadPool); break;
+        case 28: TestCellBijection<28>(cell, seed, threadPool); break;
+        default: break;
+        }
+        return;
+    }
+
+    switch (cell.mNumBlocks)
+    {
+    case 1: TimeCell<1>(cell, seed, threadPool); TestCellBijection<1>(cell, seed, threadPool); TestCellUniformity<1>(cell, seed, threadPool); break;
+    case 2: TimeCell<2>(cell, seed, threadPool); TestCellBijection<2>(cell, seed, threadPool); TestCellUniformity<2>(cell, seed, threadPool); break;
+    case 3: TimeCell<3>(cell, seed, threadPool); TestCellBijection<3>(cell, seed, threadPool); TestCellUniformity<3>(cell, seed, threadPool); break;
+    case 13: TimeCell<13>(cell, seed, threadPool); TestCellBijection<13>(cell, seed, threadPool); TestCellUniformity<13>(cell, seed, threadPool); break;
+    case 28: TimeCell<28>(cell, seed, threadPool); TestCellBijection<28>(cell, seed, threadPool); TestCellUniformity<28>(cell, seed, threadPool); break;
+    default: break;
+    }
+}
+
+template<size_t tNumBlocks>
+void SetRandomizerQuality::TimeCell(SetRandomizerQualityCell& cell, uint64_t seed, ThreadPool& threadPool) const
+{
+    SetRandomizer<tNumBlocks> randomizer(std::mt19937_64(seed), cell.mSetSize, cell.mSampling);
+    cell.mShuffleModeName = randomizer.GetShuffleModeName();
+
+    if (cell.mSetSize > 0)
+    {
+        std::vector<uint32_t> indices(cell.mSetSize);
+        std::iota(indices.begin(), indices.end(), 0);
+        std::vector<uint32_t> wheeledIndices(cell.mSetSize);
+        const uint64_t numPasses = std::max<uint64_t>((mConfig.mMinTimedIndexes + cell.mSetSize - 1) / cell.mSetSize, 1);
+
+        const std::chrono::high_resolution_clock::time_point startTime = std::chrono::high_resolution_clock::now();
+        const uint64_t startTicks = __rdtsc();
+        for (uint64_t pass = 0; pass < numPasses; ++pass)
+        {
+            randomizer.GetWheeledIndices(indices, wheeledIndices);
+        }
+        const uint64_t endTicks = __rdtsc();
+        const std::chrono::high_resolution_clock::time_point endTime = std::chrono::high_resolution_clock::now();
+
+        const double numIndexes = (double)numPasses * (double)cell.mSetSize;
+        cell.mNsPerIndex = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - startTime).count() / numIndexes;
+        cell.mCyclesPerIndex = (double)(endTicks - startTicks) / numIndexes;
+
+        // Wall time over every runner, so this is per index of the whole set rather than per runner
+        std::vector<RunnerCount> runnerSums(threadPool.GetNumRunners());
+        const std::chrono::high_resolution_clock::time_point parallelStartTime = std::chrono::high_resolution_clock::now();
+        for (uint64_t pass = 0; pass < numPasses; ++pass)
+        {
+            randomizer.ParallelForEachWheeled(threadPool, [&runnerSums](uint32_t, uint32_t wheeledIndex, size_t runnerIndex)
+            {
+                runnerSums[runnerIndex].mCount += wheeledIndex;
+            });
+        }
+        const std::chrono::high_resolution_clock::time_point parallelEndTime = std::chrono::high_resolution_clock::now();
+        cell.mParallelNsPerIndex = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(parallelEndTime - parallelStartTime).count() / numIndexes;
+    }
+
+    const uint64_t numRandomizes = std::max<uint64_t>(mConfig.mNumTimedRandomizes, 1);
+    const std::chrono::high_resolution_clock::time_point startTime = std::chrono::high_resolution_clock::now();
+    for (uint64_t randomizeIndex = 0; randomizeIndex < numRandomizes; ++randomizeIndex)
+    {
+        randomizer.Randomize();
+    }
+    const std::chrono::high_resolution_clock::time_point endTime = std::chrono::high_resolution_clock::now();
+    cell.mNsPerRandomize = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - startTime).count() / (double)numRandomizes;
+}
+
+template<size_t tNumBlocks>
+void SetRandomizerQuality::TestCellBijection(SetRandomizerQualityCell& cell, uint64_t seed, ThreadPool& threadPool) const
+{
+    const uint32_t setSize = cell.mSetSize;
+    if ((setSize == 0) || (setSize > SetRandomizerQualityConfig::cMaxBijectionSetSize))
+    {
+        return;
+    }
+
+    const SetRandomizer<tNumBlocks> randomizer(std::mt19937_64(seed), setSize, cell.mSampling);
+    cell.mShuffleModeName = randomizer.GetShuffleModeName();
+    std::vector<uint32_t> wheeledIndices(setSize);
+    std::vector<RunnerCount> runnerErrors(threadPool.GetNumRunners());
+    randomizer.ParallelForEachWheeled(threadPool, [&](uint32_t index, uint32_t wheeledIndex, size_t runnerIndex)
+    {
+        wheeledIndices[index] = wheeledIndex;
+        runnerErrors[runnerIndex].mCount += (wheeledIndex >= setSize) || (randomizer.GetUnwheeledIndex(wheeledIndex) != index);
+    });
+
+    uint64_t numErrors = 0;
+    for (const RunnerCount& errors : runnerErrors)
+    {
+        numErrors += errors.mCount;
+    }
+
+    // Unwheeling back catches most repeats already, this catches the rest. Out of range indexes were counted above
+    std::vector<bool> seen(setSize);
+    for (const uint32_t wheeledIndex : wheeledIndices)
+    {
+        if (wheeledIndex >= setSize)
+        {
+            continue;
+        }
+        if (seen[wheeledIndex])
+        {
+            ++numErrors;
+        }
+        seen[wheeledIndex] = true;
+    }
+
+    cell.mBijectionChecked = true;
+    cell.mNumBijectionErrors = numErrors;
+}
+
+template<size_t tNumBlocks>
+void SetRandomizerQuality::TestCellUniformity(SetRandomizerQualityCell& cell, uint64_t seed, ThreadPool& threadPool) const
+{
+    const uint32_t setSize = cell.mSetSize;
+    if ((setSize < 2) || (setSize > SetRandomizerQualityConfig::cMaxUniformitySetSize) || (mConfig.mNumTrials == 0))
+    {
+        return;
+    }
+
+    // Counts are [index * setSize + position] and [index * setSize + nextIndex]
+    std::vector<uint64_t> positionCounts((size_t)setSize * setSize);
+    std::vector<uint64_t> adjacencyCounts((size_t)setSize * setSize);
+    uint64_t numErrors = 0;
+    std::mutex countsMutex;
+
+    const size_t numChunks = threadPool.GetNumRunners() * 4;
+    threadPool.ParallelFor(numChunks, [&](size_t chunkIndex, size_t)
+    {
+        const uint64_t firstTrial = (mConfig.mNumTrials * chunkIndex) / numChunks;
+        const uint64_t endTrial = (mConfig.mNumTrials * (chunkIndex + 1)) / numChunks;
+        if (firstTrial == endTrial)
+        {
+            return;
+        }
+
+        SetRandomizer<tNumBlocks> randomizer(std::mt19937_64(seed + ((chunkIndex + 1) * 0xBF58476D1CE4E5B9ull)), setSize, cell.mSampling);
+        std::vector<uint32_t> indices(setSize);
+        std::iota(indices.begin(), indices.end(), 0);
+        std::vector<uint32_t> wheeledIndices(setSize);
+        std::vector<uint64_t> seenOnTrial(setSize, UINT64_MAX);
+
+        std::vector<uint32_t> chunkPositionCounts((size_t)setSize * setSize);
+        std::vector<uint32_t> chunkAdjacencyCounts((size_t)setSize * setSize);
+        uint64_t chunkErrors = 0;
+
+        for (uint64_t trial = firstTrial; trial < endTrial; ++trial)
+        {
+            randomizer.Randomize();
+            randomizer.GetWheeledIndices(indices, wheeledIndices);
+
+            bool bValid = true;
+            for (uint32_t index = 0; index < setSize; ++index)
+            {
+                const uint32_t wheeledIndex = wheeledIndices[index];
+                if ((wheeledIndex >= setSize) || (seenOnTrial[wheeledIndex] == trial))
+                {
+                    ++chunkErrors;
+                    bValid = false;
+                    continue;
+                }
+                seenOnTrial[wheeledIndex] = trial;
+                ++chunkPositionCounts[((size_t)wheeledIndex * setSize) + index];
+            }
+
+            if (bValid)
+            {
+                for (uint32_t index = 0; index + 1 < setSize; ++index)
+                {
+                    ++chunkAdjacencyCounts[((size_t)wheeledIndices[index] * setSize) + wheeledIndices[index + 1]];
+                }
+            }
+        }
+
+        const std::lock_guard<std::mutex> lock(countsMutex);
+        for (size_t countIndex = 0; countIndex < positionCounts.size(); ++countIndex)
+        {
+            positionCounts[countIndex] += chunkPositionCounts[countIndex];
+            adjacencyCounts[countIndex] += chunkAdjacencyCounts[countIndex];
+        }
+        numErrors += chunkErrors;
+    });
+
+    const double expected = (double)mConfig.mNumTrials / (double)setSize;
+    double positionChiSquare = 0.0;
+    double adjacencyChiSquare = 0.0;
+    for (uint32_t index = 0; index < setSize; ++index)
+    {
+        for (uint32_t other = 0; other < setSize; ++other)
+        {
+            const size_t countIndex = ((size_t)index * setSize) + other;
+            const double positionDelta = (double)positionCounts[countIndex] - expected;
+            positionChiSquare += positionDelta * positionDelta / expected;
+
+            if (index != other) // Never adjacent to itself
+            {
+                const double adjacencyDelta = (double)adjacencyCounts[countIndex] - expected;
+                adjacencyChiSquare += adjacencyDelta * adjacencyDelta / expected;
+            }
+        }
+    }
+
+    cell.mNumTrials = mConfig.mNumTrials;
+    cell.mNumErrors = numErrors;
+    cell.mPositionChiSquare = positionChiSquare;
+    cell.mPositionDegreesOfFreedom = (uint64_t)(setSize - 1) * (setSize - 1); // Every row and column sums to the trials
+    cell.mPositionZ = GetChiSquareZ(positionChiSquare, cell.mPositionDegreesOfFreedom);
+    cell.mAdjacencyChiSquare = adjacencyChiSquare;
+    cell.mAdjacencyDegreesOfFreedom = ((uint64_t)setSize * (setSize - 1)) - 1;
+    cell.mAdjacencyZ = GetChiSquareZ(adjacencyChiSquare, cell.mAdjacencyDegreesOfFreedom);
+}
+
+/*static*/ double SetRandomizerQuality::GetChiSquareZ(double chiSquare, uint64_t degreesOfFreedom)
+{
+    if (degreesOfFreedom == 0)
+    {
+        return 0.0;
+    }
+
+    // Wilson-Hilferty: the cube root of chi-square over its degrees of freedom is close to normal
+    const double variance = 2.0 / (9.0 * (double)degreesOfFreedom);
+    return (std::cbrt(chiSquare / (double)degreesOfFreedom) - (1.0 - variance)) / std::sqrt(variance);
+}
+
+bool SetRandomizerQuality::WriteCSV(const char* const fileName) const
+{
+    std::ofstream file(fileName);
+    if (!file.is_open())
+    {
+        printf("\nCould not open %s for writing\n", fileName);
+        return false;
+    }
+
+    file << "SetSize,Blocks,Sampling,ShuffleMode,NsPerIndex,CyclesPerIndex,ParallelNsPerIndex,NsPerRandomize,BijectionErrors,"
+        "Trials,Errors,PositionChiSquare,PositionDoF,PositionZ,AdjacencyChiSquare,AdjacencyDoF,AdjacencyZ\n";
+
+    char throughput[96];
+    char uniformity[192];
+    for (const SetRandomizerQualityCell& cell : mCells)
+    {
+        if (cell.mBijectionOnly)
+        {
+            snprintf(throughput, sizeof(throughput), ",,,");
+        }
+        else
+        {
+            snprintf(throughput, sizeof(throughput), "%.3f,%.3f,%.3f,%.1f", cell.mNsPerIndex, cell.mCyclesPerIndex, cell.mParallelNsPerIndex, cell.mNsPerRandomize);
+        }
+        if (cell.mNumTrials > 0)
+        {
+            snprintf(uniformity, sizeof(uniformity), "%" PRIu64 ",%" PRIu64 ",%.2f,%" PRIu64 ",%.3f,%.2f,%" PRIu64 ",%.3f",
+                cell.mNumTrials, cell.mNumErrors,
+                cell.mPositionChiSquare, cell.mPositionDegreesOfFreedom, cell.mPositionZ,
+                cell.mAdjacencyChiSquare, cell.mAdjacencyDegreesOfFreedom, cell.mAdjacencyZ);
+        }
+        else
+        {
+            snprintf(uniformity, sizeof(uniformity), "0,,,,,,,");
+        }
+
+        file << cell.mSetSize << ','
+            << cell.mNumBlocks << ','
+            << kSamplingNames[(size_t)cell.mSampling] << ','
+            << cell.mShuffleModeName << ','
+            << throughput << ',';
+        if (cell.mBijectionChecked)
+        {
+            file << cell.mNumBijectionErrors;
+        }
+        file << ','
+            << uniformity << '\n';
+    }
+    return true;
+}
+
+void SetRandomizerQuality::PrintSummary() const
+{
+    printf("\n%8s %6s %-9s %-32s %8s %8s %8s %9s %6s %8s %8s %6s",
+        "SetSize", "Blocks", "Sampling", "ShuffleMode", "ns/Index", "Cyc/Idx", "ParNs/Ix", "ns/Reseed", "BijErr", "PosZ", "AdjZ", "Errors");
+
+    uint64_t numErrors = 0;
+    uint64_t numBijectionErrors = 0;
+    size_t numBijectionOnlyCells = 0;
+    uint32_t maxBijectionSetSize = 0;
+    double worstZ = 0.0;
+    for (const SetRandomizerQualityCell& cell : mCells)
+    {
+        if (cell.mBijectionChecked)
+        {
+            maxBijectionSetSize = std::max(maxBijectionSetSize, cell.mSetSize);
+        }
+
+        // Only listed when they fail, there are too many to read through
+        if (cell.mBijectionOnly)
+        {
+            ++numBijectionOnlyCells;
+            numBijectionErrors += cell.mNumBijectionErrors;
+            if (cell.mNumBijectionErrors > 0)
+            {
+                printf("\n%8u %6zu %-9s %-32s %8s %8s %8s %9s %6" PRIu64,
+                    cell.mSetSize, cell.mNumBlocks, kSamplingNames[(size_t)cell.mSampling], cell.mShuffleModeName,
+                    "", "", "", "", cell.mNumBijectionErrors);
+            }
+            continue;
+        }
+
+        printf("\n%8u %6zu %-9s %-32s %8.2f %8.2f %8.2f %9.1f",
+            cell.mSetSize, cell.mNumBlocks, kSamplingNames[(size_t)cell.mSampling], cell.mShuffleModeName,
+            cell.mNsPerIndex, cell.mCyclesPerIndex, cell.mParallelNsPerIndex, cell.mNsPerRandomize);
+        if (cell.mBijectionChecked)
+        {
+            printf(" %6" PRIu64, cell.mNumBijectionErrors);
+            numBijectionErrors += cell.mNumBijectionErrors;
+        }
+        else
+        {
+            printf(" %6s", "");
+        }
+        if (cell.mNumTrials > 0)
+        {
+            printf(" %8.2f %8.2f %6" PRIu64, cell.mPositionZ, cell.mAdjacencyZ, cell.mNumErrors);
+            numErrors += cell.mNumErrors;
+            worstZ = std::max({ worstZ, std::abs(cell.mPositionZ), std::abs(cell.mAdjacencyZ) });
+        }
+    }
+
+    printf("\nCells: %zu (and %zu bijection only), Trials per cell: %" PRIu64 ", Bijection errors: %" PRIu64 " (sizes up to %u), Errors: %" PRIu64 ", Largest |z|: %.2f, Time: %.2fs\n",
+        mCells.size() - numBijectionOnlyCells, numBijectionOnlyCells, mConfig.mNumTrials, numBijectionErrors, maxBijectionSetSize, numErrors, worstZ, mRunSeconds);
+}
@@ -0,0 +1,104 @@
+#pragma once
+#include "SetRandomizer.h"
+
+struct SetRandomizerQualityConfig
+{
+    std::vector<uint32_t> mSetSizes;
+    std::vector<size_t> mNumBlocks; // Each one of cSupportedNumBlocks
+    std::vector<SetRandomizerSampling> mSamplings;
+
+    uint64_t mNumTrials = 10000; // Randomizes per cell for the uniformity tests
+    uint64_t mMinTimedIndexes = 1 << 22; // Per cell, in whole passes over the set
+    uint64_t mNumTimedRandomizes = 20000; // Per cell
+    size_t mNumThreads = 0; // 0 uses every hardware thread
+    uint32_t mNumBijectionSetSizes = 40; // Extra sizes per block count and sampling that are only checked to be bijections, see MakeBijectionSetSizes
+
+    static constexpr std::array<size_t, 5> cSupportedNumBlocks = { 1, 2, 3, 13, 28 };
+    static constexpr uint32_t cMaxUniformitySetSize = 512; // Uniformity counts grow with the set size squared. Larger sets are only timed
+    static constexpr uint32_t cMaxBijectionSetSize = 10000000; // Every index of sets up to this is wheeled and unwheeled once
+
+    /**
+    * Set sizes on both sides of each shuffle mode's limits, with 1, 3 and 28 blocks and both samplings
+    */
+    static SetRandomizerQualityConfig MakeDefault();
+
+    /**
+    * mNumBijectionSetSizes sizes log spaced from 2 to cMaxBijectionSetSize, minus the ones already in mSetSizes
+    */
+    std::vector<uint32_t> MakeBijectionSetSizes() const;
+};
+
+struct SetRandomizerQualityCell
+{
+    uint32_t mSetSize = 0;
+    size_t mNumBlocks = 0;
+    SetRandomizerSampling mSampling = SetRandomizerSampling::Modulo;
+    const char* mShuffleModeName = "";
+    bool mBijectionOnly = false; // Not timed or tested for uniformity
+
+    // Throughput
+    double mNsPerIndex = 0.0;
+    double mCyclesPerIndex = 0.0; // Time stamp counter ticks, which may not match the core clock
+    double mParallelNsPerIndex = 0.0; // Through ParallelForEachWheeled on every runner
+    double mNsPerRandomize = 0.0;
+
+    // Bijection, over every index of one randomize
+    bool mBijectionChecked = false;
+    uint64_t mNumBijectionErrors = 0; // Wheeled indexes outside the set or repeated, or that don't unwheel back
+
+    // Uniformity. The z scores are near 0 when uniform, see SetRandomizerQuality
+    uint64_t mNumTrials = 0; // 0 when the set was only timed
+    uint64_t mNumErrors = 0; // Wheeled indexes outside the set or repeated
+    double mPositionChiSquare = 0.0;
+    uint64_t mPositionDegreesOfFreedom = 0;
+    double mPositionZ = 0.0;
+    double mAdjacencyChiSquare = 0.0;
+    uint64_t mAdjacencyDegreesOfFreedom = 0;
+    double mAdjacencyZ = 0.0;
+};
+
+/**
+ * Speed and uniformity of SetRandomizer for every combination of set size, block count and sampling. Each combination is a cell.
+ *
+ * Throughput is timed one cell at a time, around whole batches so the clock isn't part of it:
+ * - ns and cycles per index of GetWheeledIndices over the whole set, repeated for mMinTimedIndexes
+ * - ns per index of ParallelForEachWheeled over the whole set on every runner. The others run on the calling thread only
+ * - ns per Randomize, i.e. reseed latency
+ *
+ * Uniformity randomizes the set mNumTrials times, with the trials split across a ThreadPool, and counts:
+ * - Position frequency: how often each index wheels to each position
+ * - Pair adjacency: how often each ordered pair of indexes wheels to neighbouring positions
+ * A uniform shuffle expects both to be mNumTrials / setSize everywhere. Each is reported as a chi-square statistic and
+ * its z score (Wilson-Hilferty), so a |z| past ~4 flags a regression whatever the set size.
+ *
+ * Sets up to cMaxBijectionSetSize are also checked to be bijections: every index is wheeled with ParallelForEachWheeled, and must
+ * unwheel back to itself and land on a position no other index did. The sizes from MakeBijectionSetSizes add bijection only cells,
+ * so the whole range is sampled and not just the sizes picked for timing.
+ * Shuffle modes that can't reach every permutation (repeated shuffling) are expected to score badly at enough trials.
+ */
+class SetRandomizerQuality
+{
+public:
+    SetRandomizerQuality(const SetRandomizerQualityConfig& config);
+
+    void Run(uint64_t seed);
+    bool WriteCSV(const char* const fileName) const;
+    void PrintSummary() const;
+
+    const std::vector<SetRandomizerQualityCell>& GetCells() const { return mCells; }
+
+    static double GetChiSquareZ(double chiSquare, uint64_t degreesOfFreedom);
+
+private:
+    template<size_t tNumBlocks>
+    void TimeCell(SetRandomizerQualityCell& cell, uint64_t seed, ThreadPool& threadPool) const;
+    template<size_t tNumBlocks>
+    void TestCellUniformity(SetRandomizerQualityCell& cell, uint64_t seed, ThreadPool& threadPool) const;
+    template<size_t tNumBlocks>
+    void TestCellBijection(SetRandomizerQualityCell& cell, uint64_t seed, ThreadPool& threadPool) const;
+    void RunCell(SetRandomizerQualityCell& cell, uint64_t seed, ThreadPool& threadPool) const;
+
+    SetRandomizerQualityConfig mConfig;
+    std::vector<SetRandomizerQualityCell> mCells;
+    double mRunSeconds = 0.0;
+};
@@ -1,63 +1,845 @@
 #include "Stats.h"
 #include "MathPrint.h"
 
-void Stats::ClearIntDistribution()
+void StatsMoments::Add(double value)
 {
-	mIntDistribution.clear();
-	mIntDistributionValueMin = INT_MAX;
-	mIntDistributionValueMax = 0;
-	mIntDistributionAmountMax = 0;
+	++mCount;
+	const double delta = value - mMean;
+	mMean += delta / (double)mCount;
+	mSumSquaredDeltas += delta * (value - mMean);
+	mMin = std::min(mMin, value);
+	mMax = std::max(mMax, value);
 }
 
-void Stats::AddToIntDistribution(int32_t distributionId, int32_t value, int32_t amount /*= 1*/)
+void StatsMoments::Merge(const StatsMoments& other)
+{
+	if (other.mCount == 0)
+	{
+		return;
+	}
+	if (mCount == 0)
+	{
+		*this = other;
+		return;
+	}
+
+	// Chan et al.'s pairwise update
+	const double count = (double)mCount + (double)other.mCount;
+	const double delta = other.mMean - mMean;
+	mMean += delta * ((double)other.mCount / count);
+	mSumSquaredDeltas += other.mSumSquaredDeltas + (delta * delta * ((double)mCount * (double)other.mCount / count));
+	mCount += other.mCount;
+	mMin = std::min(mMin, other.mMin);
+	mMax = std::max(mMax, other.mMax);
+}
+
+QuantileSketch::QuantileSketch(double relativeAccuracy /*= 0.01*/)
+: mRelativeAccuracy(relativeAccuracy)
+, mGamma((1.0 + relativeAccuracy) / (1.0 - relativeAccuracy))
+, mInverseLogGamma(1.0 / std::log(mGamma))
+{
+}
+
+void QuantileSketch::Add(double value, uint64_t count /*= 1*/)
+{
+	if (value > cMinMagnitude)
+	{
+		mPositive.Add(GetKey(value), count);
+	}
+	else if (value < -cMinMagnitude)
+	{
+		mNegative.Add(GetKey(-value), count);
+	}
+	else
+	{
+		mZeroCount += count;
+	}
+}
+
+void QuantileSketch::Merge(const QuantileSketch& other)
+{
+	// Re-adding each bin's middle lands it in the same bin when the accuracies match, and the nearest one when they don't
+	for (int32_t binIndex = 0; binIndex < (int32_t)other.mPositive.mBins.size(); ++binIndex)
+	{
+		if (other.mPositive.mBins[binIndex] != 0)
+		{
+			Add(other.GetValue(other.mPositive.mFirstKey + binIndex), other.mPositive.mBins[binIndex]);
+		}
+	}
+	for (int32_t binIndex = 0; binIndex < (int32_t)other.mNegative.mBins.size(); ++binIndex)
+	{
+		if (other.mNegative.mBins[binIndex] != 0)
+		{
+			Add(-other.GetValue(other.mNegative.mFirstKey + binIndex), other.mNegative.mBins[binIndex]);
+		}
+	}
+	mZeroCount += other.mZeroCount;
+}
+
+double QuantileSketch::GetQuantile(double quantile) const
+{
+	const uint64_t count = GetCount();
+	if (count == 0)
+	{
+		return 0.0;
+	}
+
+	const uint64_t rank = (uint64_t)(std::clamp(quantile, 0.0, 1.0) * (double)(count - 1));
+	uint64_t countBelow = 0;
+
+	// Most negative first, which is the highest key of the negative bins
+	for (int32_t binIndex = (int32_t)mNegative.mBins.size() - 1; binIndex >= 0; --binIndex)
+	{
+		countBelow += mNegative.mBins[binIndex];
+		if (countBelow > rank)
+		{
+			return -GetValue(mNegative.mFirstKey + binIndex);
+		}
+	}
+
+	countBelow += mZeroCount;
+	if (countBelow > rank)
+	{
+		return 0.0;
+	}
+
+	for (int32_t binIndex = 0; binIndex < (int32_t)mPositive.mBins.size(); ++binIndex)
+	{
+		countBelow += mPositive.mBins[binIndex];
+		if (countBelow > rank)
+		{
+			return GetValue(mPositive.mFirstKey + binIndex);
+		}
+	}
+	return GetValue(mPositive.mFirstKey + (int32_t)mPositive.mBins.size() - 1);
+}
+
+void QuantileSketch::AddBins(bool bNegative, int32_t firstKey, std::span<const uint64_t> binCounts)
+{
+	BinStore& binStore = bNegative ? mNegative : mPositive;
+	for (int32_t binIndex = 0; binIndex < (int32_t)binCounts.size(); ++binIndex)
+	{
+		if (binCounts[binIndex] != 0)
+		{
+			binStore.Add(firstKey + binIndex, binCounts[binIndex]);
+		}
+	}
+}
+
+double QuantileSketch::GetValue(int32_t key) const
+{
+	return 2.0 * std::pow(mGamma, (double)key) / (mGamma + 1.0);
+}
+
+void QuantileSketch::BinStore::Add(int32_t key, uint64_t count)
+{
+	if (mBins.empty())
+	{
+		mFirstKey = key;
+		mBins.assign(1, 0);
+	}
+
+	const int32_t oldLastKey = mFirstKey + (int32_t)mBins.size() - 1;
+	const int32_t lastKey = std::max(oldLastKey, key);
+	const int32_t firstKey = std::max(std::min(mFirstKey, key), lastKey - (cMaxBins - 1));
+	if ((firstKey != mFirstKey) || (lastKey != oldLastKey))
+	{
+		std::vector<uint64_t> newBins(lastKey - firstKey + 1, 0);
+		for (int32_t binIndex = 0; binIndex < (int32_t)mBins.size(); ++binIndex)
+		{
+			// Bins that no longer fit fold into the lowest one
+			newBins[std::max(mFirstKey + binIndex, firstKey) - firstKey] += mBins[binIndex];
+		}
+		mBins.swap(newBins);
+		mFirstKey = firstKey;
+	}
+
+	mBins[std::max(key, mFirstKey) - mFirstKey] += count;
+	mTotal += count;
+}
+
+void StatsSummary::Print(const char* const name) const
+{
+	if (mMoments.mCount == 0)
+	{
+		printf("\n%s: ==Empty==", name);
+		return;
+	}
+
+	printf("\n%s: %" PRIu64 " values, mean %.2f, sd %.2f, min %.2f, max %.2f, P50 %.2f, P90 %.2f, P99 %.2f",
+		name, mMoments.mCount, mMoments.mMean, mMoments.GetStandardDeviation(), mMoments.mMin, mMoments.mMax,
+		mQuantiles.GetQuantile(0.5), mQuantiles.GetQuantile(0.9), mQuantiles.GetQuantile(0.99));
+}
+
+static void AppendJsonString(std::string& outText, const std::string& value)
+{
+	outText += '"';
+	for (const char c : value)
+	{
+		if (c == '"' || c == '\\')
+		{
+			outText += '\\';
+			outText += c;
+		}
+		else if ((unsigned char)c < 0x20)
+		{
+			char escaped[8];
+			snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned int)c);
+			outText += escaped;
+		}
+		else
+		{
+			outText += c;
+		}
+	}
+	outText += '"';
+}
+
+static void AppendCsvString(std::string& outText, const std::string& value)
+{
+	if (value.find_first_of(",\"\n") == std::string::npos)
+	{
+		outText += value;
+		return;
+	}
+
+	outText += '"';
+	for (const char c : value)
+	{
+		if (c == '"')
+		{
+			outText += '"';
+		}
+		outText += c;
+	}
+	outText += '"';
+}
+
+template<typename T>
+static void AppendBinaryValue(std::string& outBytes, T value)
+{
+	outBytes.append((const char*)&value, sizeof(value));
+}
+
+static void AppendBinaryString(std::string& outBytes, const std::string& value)
+{
+	AppendBinaryValue(outBytes, (uint32_t)value.size());
+	outBytes += value;
+}
+
+template<typename T>
+static bool ReadBinaryValue(std::string_view& inOutBytes, T& outValue)
+{
+	if (inOutBytes.size() < sizeof(T))
+	{
+		return false;
+	}
+	std::memcpy(&outValue, inOutBytes.data(), sizeof(T));
+	inOutBytes.remove_prefix(sizeof(T));
+	return true;
+}
+
+static bool ReadBinaryString(std::string_view& inOutBytes, std::string& outValue)
+{
+	uint32_t size = 0;
+	if (!ReadBinaryValue(inOutBytes, size) || (inOutBytes.size() < size))
+	{
+		return false;
+	}
+	outValue.assign(inOutBytes.data(), size);
+	inOutBytes.remove_prefix(size);
+	return true;
+}
+
+template<typename T>
+static bool ReadBinaryList(std::string_view& inOutBytes, std::vector<T>& outValues)
+{
+	uint32_t count = 0;
+	if (!ReadBinaryValue(inOutBytes, count) || ((inOutBytes.size() / sizeof(T)) < count))
+	{
+		return false;
+	}
+	outValues.resize(count);
+	if (count > 0)
+	{
+		std::memcpy(outValues.data(), inOutBytes.data(), count * sizeof(T));
+		inOutBytes.remove_prefix(count * sizeof(T));
+	}
+	return true;
+}
+
+static void AppendBinarySketch(std::string& outBytes, const QuantileSketch& quantiles)
+{
+	AppendBinaryValue(outBytes, quantiles.GetRelativeAccuracy());
+	AppendBinaryValue(outBytes, quantiles.GetZeroCount());
+	for (const bool bNegative : { true, false })
+	{
+		const std::vector<uint64_t>& binCounts = quantiles.GetBinCounts(bNegative);
+		AppendBinaryValue(outBytes, quantiles.GetFirstKey(bNegative));
+		AppendBinaryValue(outBytes, (uint32_t)binCounts.size());
+		outBytes.append((const char*)binCounts.data(), binCounts.size() * sizeof(uint64_t));
+	}
+}
+
+static void AppendJsonBins(std::string& outText, const char* const name, int32_t firstKey, const std::vector<uint64_t>& binCounts)
+{
+	char number[48];
+	snprintf(number, sizeof(number), ",\"%sFirstKey\":%d,\"%s\":[", name, firstKey, name);
+	outText += number;
+	for (size_t binIndex = 0; binIndex < binCounts.size(); ++binIndex)
+	{
+		snprintf(number, sizeof(number), "%s%" PRIu64, (binIndex > 0) ? "," : "", binCounts[binIndex]);
+		outText += number;
+	}
+	outText += ']';
+}
+
+bool StatsSnapshot::Export(const char* const fileName, StatsExportFormat format, const std::string& runLabel) const
+{
+	bool bNewFile = true;
+	{
+		std::ifstream existingFile(fileName, std::ios::binary | std::ios::ate);
+		bNewFile = !existingFile.is_open() || (existingFile.tellg() <= 0);
+	}
+
+	std::string record;
+	switch (format)
+	{
+	case StatsExportFormat::Csv:
+		AppendCsv(record, runLabel, bNewFile);
+		break;
+	case StatsExportFormat::Json:
+		AppendJson(record, runLabel);
+		break;
+	case StatsExportFormat::Binary:
+		AppendBinary(record, runLabel);
+		break;
+	default:
+		return false;
+	}
+
+	std::ofstream file(fileName, std::ios::binary | std::ios::app);
+	if (!file.is_open())
+	{
+		printf("\nCould not open %s for writing\n", fileName);
+		return false;
+	}
+	file.write(record.data(), (std::streamsize)record.size());
+	return file.good();
+}
+
+void StatsSnapshot::AppendCsv(std::string& outText, const std::string& runLabel, bool bWithHeader) const
+{
+	if (bWithHeader)
+	{
+		outText += "Run,Kind,Id,XName,YName,Value,Amount,Count,Mean,SD,Min,Max,P50,P90,P99\n";
+	}
+
+	char columns[192];
+	for (const IntDistribution& distribution : mIntDistributions)
+	{
+		for (int32_t binIndex = 0; binIndex < (int32_t)distribution.mAmounts.size(); ++binIndex)
+		{
+			if (distribution.mAmounts[binIndex] == 0)
+			{
+				continue;
+			}
+
+			AppendCsvString(outText, runLabel);
+			snprintf(columns, sizeof(columns), ",Distribution,%d,", distribution.mId);
+			outText += columns;
+			AppendCsvString(outText, distribution.mXName);
+			outText += ',';
+			AppendCsvString(outText, distribution.mYName);
+			snprintf(columns, sizeof(columns), ",%d,%d,,,,,,,,\n", distribution.mFirstValue + binIndex, distribution.mAmounts[binIndex]);
+			outText += columns;
+		}
+	}
+
+	for (const Summary& summary : mSummaries)
+	{
+		const StatsMoments& moments = summary.mSummary.mMoments;
+		const QuantileSketch& quantiles = summary.mSummary.mQuantiles;
+		AppendCsvString(outText, runLabel);
+		snprintf(columns, sizeof(columns), ",Summary,%d,,,,,%" PRIu64 ",%.17g,%.17g,%.17g,%.17g,%.17g,%.17g,%.17g\n",
+			summary.mId, moments.mCount, moments.mMean, moments.GetStandardDeviation(), moments.mMin, moments.mMax,
+			quantiles.GetQuantile(0.5), quantiles.GetQuantile(0.9), quantiles.GetQuantile(0.99));
+		outText += columns;
+	}
+}
+
+void StatsSnapshot::AppendJson(std::string& outText, const std::string& runLabel) const
+{
+	char number[32];
+	outText += "{\"run\":";
+	AppendJsonString(outText, runLabel);
+
+	outText += ",\"distributions\":[";
+	for (size_t distributionIndex = 0; distributionIndex < mIntDistributions.size(); ++distributionIndex)
+	{
+		const IntDistribution& distribution = mIntDistributions[distributionIndex];
+		snprintf(number, sizeof(number), "%s{\"id\":%d", (distributionIndex > 0) ? "," : "", distribution.mId);
+		outText += number;
+		outText += ",\"xName\":";
+		AppendJsonString(outText, distribution.mXName);
+		outText += ",\"yName\":";
+		AppendJsonString(outText, distribution.mYName);
+		snprintf(number, sizeof(number), ",\"firstValue\":%d", distribution.mFirstValue);
+		outText += number;
+		outText += ",\"amounts\":[";
+		for (size_t binIndex = 0; binIndex < distribution.mAmounts.size(); ++binIndex)
+		{
+			snprintf(number, sizeof(number), "%s%d", (binIndex > 0) ? "," : "", distribution.mAmounts[binIndex]);
+			outText += number;
+		}
+		snprintf(number, sizeof(number), "],\"below\":%" PRId64, distribution.mUnderflowAmount);
+		outText += number;
+		snprintf(number, sizeof(number), ",\"above\":%" PRId64 "}", distribution.mOverflowAmount);
+		outText += number;
+	}
+
+	outText += "],\"summaries\":[";
+	char fields[320];
+	for (size_t summaryIndex = 0; summaryIndex < mSummaries.size(); ++summaryIndex)
+	{
+		const Summary& summary = mSummaries[summaryIndex];
+		const StatsMoments& moments = summary.mSummary.mMoments;
+		const QuantileSketch& quantiles = summary.mSummary.mQuantiles;
+		if (moments.mCount == 0)
+		{
+			// Min and max are still infinite, which JSON can't hold
+			snprintf(fields, sizeof(fields), "%s{\"id\":%d,\"count\":0}", (summaryIndex > 0) ? "," : "", summary.mId);
+			outText += fields;
+			continue;
+		}
+
+		snprintf(fields, sizeof(fields),
+			"%s{\"id\":%d,\"count\":%" PRIu64 ",\"mean\":%.17g,\"sd\":%.17g,\"min\":%.17g,\"max\":%.17g,\"p50\":%.17g,\"p90\":%.17g,\"p99\":%.17g",
+			(summaryIndex > 0) ? "," : "", summary.mId, moments.mCount, moments.mMean, moments.GetStandardDeviation(), moments.mMin, moments.mMax,
+			quantiles.GetQuantile(0.5), quantiles.GetQuantile(0.9), quantiles.GetQuantile(0.99));
+		outText += fields;
+
+		// The whole sketch, so quantiles of separate runs can be merged
+		snprintf(fields, sizeof(fields), ",\"sketch\":{\"accuracy\":%.17g,\"zero\":%" PRIu64, quantiles.GetRelativeAccuracy(), quantiles.GetZeroCount());
+		outText += fields;
+		AppendJsonBins(outText, "negative", quantiles.GetFirstKey(true), quantiles.GetBinCounts(true));
+		AppendJsonBins(outText, "positive", quantiles.GetFirstKey(false), quantiles.GetBinCounts(false));
+		outText += "}}";
+	}
+	outText += "]}\n";
+}
+
+void StatsSnapshot::AppendBinary(std::string& outBytes, const std::string& runLabel) const
+{
+	outBytes += "WPST";
+	AppendBinaryValue(outBytes, cBinaryVersion);
+	AppendBinaryString(outBytes, runLabel);
+
+	AppendBinaryValue(outBytes, (uint32_t)mIntDistributions.size());
+	for (const IntDistribution& distribution : mIntDistributions)
+	{
+		AppendBinaryValue(outBytes, distribution.mId);
+		AppendBinaryString(outBytes, distribution.mXName);
+		AppendBinaryString(outBytes, distribution.mYName);
+		AppendBinaryValue(outBytes, distribution.mFirstValue);
+		AppendBinaryValue(outBytes, (uint32_t)distribution.mAmounts.size());
+		outBytes.append((const char*)distribution.mAmounts.data(), distribution.mAmounts.size() * sizeof(int32_t));
+		AppendBinaryValue(outBytes, distribution.mUnderflowAmount);
+		AppendBinaryValue(outBytes, distribution.mOverflowAmount);
+	}
+
+	AppendBinaryValue(outBytes, (uint32_t)mSummaries.size());
+	for (const Summary& summary : mSummaries)
+	{
+		const StatsMoments& moments = summary.mSummary.mMoments;
+		const QuantileSketch& quantiles = summary.mSummary.mQuantiles;
+		AppendBinaryValue(outBytes, summary.mId);
+		AppendBinaryValue(outBytes, moments.mCount);
+		AppendBinaryValue(outBytes, moments.mMean);
+		AppendBinaryValue(outBytes, moments.mSumSquaredDeltas);
+		AppendBinaryValue(outBytes, moments.mMin);
+		AppendBinaryValue(outBytes, moments.mMax);
+		AppendBinaryValue(outBytes, quantiles.GetQuantile(0.5));
+		AppendBinaryValue(outBytes, quantiles.GetQuantile(0.9));
+		AppendBinaryValue(outBytes, quantiles.GetQuantile(0.99));
+		AppendBinarySketch(outBytes, quantiles);
+	}
+}
+
+/*static*/ bool StatsSnapshot::ReadBinary(std::string_view& inOutBytes, std::string& outRunLabel, StatsSnapshot& outSnapshot)
 {
-	IntDistribution& distribution = mIntDistributions[distributionId];
+	std::string_view bytes = inOutBytes;
+	uint32_t version = 0;
+	StatsSnapshot snapshot;
+	uint32_t count = 0;
+	if (!bytes.starts_with("WPST"))
+	{
+		return false;
+	}
+	bytes.remove_prefix(4);
+	if (!ReadBinaryValue(bytes, version) || (version != cBinaryVersion) || !ReadBinaryString(bytes, outRunLabel) || !ReadBinaryValue(bytes, count))
+	{
+		return false;
+	}
 
-	int32_t& currentAmount = distribution.mValueToAmount.try_emplace(value, 0).first->second;
-	currentAmount += amount;
+	for (uint32_t distributionIndex = 0; distributionIndex < count; ++distributionIndex)
+	{
+		IntDistribution& distribution = snapshot.mIntDistributions.emplace_back();
+		if (!ReadBinaryValue(bytes, distribution.mId) || !ReadBinaryString(bytes, distribution.mXName) || !ReadBinaryString(bytes, distribution.mYName)
+			|| !ReadBinaryValue(bytes, distribution.mFirstValue) || !ReadBinaryList(bytes, distribution.mAmounts)
+			|| !ReadBinaryValue(bytes, distribution.mUnderflowAmount) || !ReadBinaryValue(bytes, distribution.mOverflowAmount))
+		{
+			return false;
+		}
+	}
 
-	if (value < distribution.mValueMin)
+	if (!ReadBinaryValue(bytes, count))
 	{
-		distribution.mValueMin = value;
+		return false;
 	}
-	if (value > distribution.mValueMax)
+	for (uint32_t summaryIndex = 0; summaryIndex < count; ++summaryIndex)
 	{
-		distribution.mValueMax = value;
+		Summary& summary = snapshot.mSummaries.emplace_back();
+		StatsMoments& moments = summary.mSummary.mMoments;
+		std::array<double, 3> quantiles = {}; // Derived from the sketch
+		double relativeAccuracy = 0.0;
+		uint64_t zeroCount = 0;
+		if (!ReadBinaryValue(bytes, summary.mId) || !ReadBinaryValue(bytes, moments.mCount) || !ReadBinaryValue(bytes, moments.mMean)
+			|| !ReadBinaryValue(bytes, moments.mSumSquaredDeltas) || !ReadBinaryValue(bytes, moments.mMin) || !ReadBinaryValue(bytes, moments.mMax)
+			|| !ReadBinaryValue(bytes, quantiles) || !ReadBinaryValue(bytes, relativeAccuracy) || !ReadBinaryValue(bytes, zeroCount)
+			|| !(relativeAccuracy > 0.0) || !(relativeAccuracy < 1.0))
+		{
+			return false;
+		}
+
+		summary.mSummary.mQuantiles = QuantileSketch(relativeAccuracy);
+		summary.mSummary.mQuantiles.AddZeroCount(zeroCount);
+		for (const bool bNegative : { true, false })
+		{
+			int32_t firstKey = 0;
+			std::vector<uint64_t> binCounts;
+			if (!ReadBinaryValue(bytes, firstKey) || !ReadBinaryList(bytes, binCounts) || ((int64_t)firstKey + (int64_t)binCounts.size() > INT32_MAX))
+			{
+				return false;
+			}
+			summary.mSummary.mQuantiles.AddBins(bNegative, firstKey, binCounts);
+		}
 	}
-	if (currentAmount > distribution.mAmountMax)
+
+	inOutBytes = bytes;
+	outSnapshot = std::move(snapshot);
+	return true;
+}
+
+/*static*/ std::atomic<uint64_t> Stats::sNextStatsId = 1;
+
+Stats::Stats()
+: mStatsId(sNextStatsId++)
+{
+}
+
+void Stats::ClearIntDistribution()
+{
+	std::lock_guard<std::mutex> lock(mShardsMutex);
+	for (std::unique_ptr<Shard>& shard : mShards)
 	{
-		distribution.mAmountMax = currentAmount;
+		for (IntHistogram& histogram : shard->mIntDistributions)
+		{
+			histogram.Clear();
+		}
 	}
 }
 
+void Stats::AddToIntDistribution(int32_t distributionId, int32_t value, int32_t amount /*= 1*/)
+{
+	GetOrAdd(GetThreadShard().mIntDistributions, distributionId).Add(value, amount);
+}
+
 void Stats::SetIntDistributionAxisNames(int32_t distributionId, const char* const xName, const char* const yName)
 {
-	IntDistribution& distribution = mIntDistributions[distributionId];
-	distribution.mXName = xName;
-	distribution.mYName = yName;
+	AxisNames& axisNames = mAxisNames[distributionId];
+	axisNames.mXName = xName;
+	axisNames.mYName = yName;
 }
 
-void Stats::PrintIntDistribution(int32_t distributionId, int32_t width, int32_t height)
+void Stats::ClearSummaries()
 {
-	if (mIntDistributions.find(distributionId) == mIntDistributions.end())
+	std::lock_guard<std::mutex> lock(mShardsMutex);
+	for (std::unique_ptr<Shard>& shard : mShards)
+	{
+		shard->mSummaries.clear();
+	}
+}
+
+void Stats::AddToSummary(int32_t summaryId, double value)
+{
+	GetOrAdd(GetThreadShard().mSummaries, summaryId).Add(value);
+}
+
+StatsSummary Stats::GetSummary(int32_t summaryId)
+{
+	StatsSummary merged;
+	std::lock_guard<std::mutex> lock(mShardsMutex);
+	for (const std::unique_ptr<Shard>& shard : mShards)
+	{
+		if (summaryId < (int32_t)shard->mSummaries.size())
+		{
+			merged.Merge(shard->mSummaries[summaryId]);
+		}
+	}
+	return merged;
+}
+
+void Stats::PrintSummary(int32_t summaryId, const char* const name)
+{
+	GetSummary(summaryId).Print(name);
+}
+
+void Stats::Merge(Stats& other)
+{
+	if (&other == this)
 	{
-		printf("\n\n==Empty==\n\n");
 		return;
 	}
 
-	IntDistribution& distribution = mIntDistributions[distributionId];
-	if (distribution.mValueToAmount.empty())
+	Shard& shard = GetThreadShard();
+	std::lock_guard<std::mutex> lock(other.mShardsMutex);
+	for (const std::unique_ptr<Shard>& otherShard : other.mShards)
+	{
+		for (int32_t distributionId = 0; distributionId < (int32_t)otherShard->mIntDistributions.size(); ++distributionId)
+		{
+			GetOrAdd(shard.mIntDistributions, distributionId).Merge(otherShard->mIntDistributions[distributionId]);
+		}
+		for (int32_t summaryId = 0; summaryId < (int32_t)otherShard->mSummaries.size(); ++summaryId)
+		{
+			GetOrAdd(shard.mSummaries, summaryId).Merge(otherShard->mSummaries[summaryId]);
+		}
+	}
+
+	for (const auto& [distributionId, axisNames] : other.mAxisNames)
+	{
+		mAxisNames.try_emplace(distributionId, axisNames);
+	}
+}
+
+StatsSnapshot Stats::TakeSnapshot()
+{
+	std::map<int32_t, IntHistogram> distributions;
+	std::map<int32_t, StatsSummary> summaries;
+	{
+		std::lock_guard<std::mutex> lock(mShardsMutex);
+		for (const std::unique_ptr<Shard>& shard : mShards)
+		{
+			for (int32_t distributionId = 0; distributionId < (int32_t)shard->mIntDistributions.size(); ++distributionId)
+			{
+				distributions[distributionId].Merge(shard->mIntDistributions[distributionId]);
+			}
+			for (int32_t summaryId = 0; summaryId < (int32_t)shard->mSummaries.size(); ++summaryId)
+			{
+				summaries[summaryId].Merge(shard->mSummaries[summaryId]);
+			}
+		}
+	}
+
+	StatsSnapshot snapshot;
+	for (const auto& [distributionId, histogram] : distributions)
+	{
+		int32_t valueMin = 0;
+		int32_t valueMax = 0;
+		if (!histogram.FindValueRange(valueMin, valueMax))
+		{
+			if ((histogram.GetUnderflowAmount() == 0) && (histogram.GetOverflowAmount() == 0))
+			{
+				continue;
+			}
+			valueMin = histogram.GetFirstValue();
+			valueMax = valueMin - 1;
+		}
+
+		StatsSnapshot::IntDistribution& distribution = snapshot.mIntDistributions.emplace_back();
+		distribution.mId = distributionId;
+		distribution.mFirstValue = valueMin;
+		const auto firstBin = histogram.GetBins().begin() + (valueMin - histogram.GetFirstValue());
+		distribution.mAmounts.assign(firstBin, firstBin + (valueMax - valueMin + 1));
+		distribution.mUnderflowAmount = histogram.GetUnderflowAmount();
+		distribution.mOverflowAmount = histogram.GetOverflowAmount();
+
+		auto axisNamesIt = mAxisNames.find(distributionId);
+		if (axisNamesIt != mAxisNames.end())
+		{
+			distribution.mXName = axisNamesIt->second.mXName;
+			distribution.mYName = axisNamesIt->second.mYName;
+		}
+	}
+
+	for (const auto& [summaryId, summary] : summaries)
+	{
+		if (summary.mMoments.mCount > 0)
+		{
+			snapshot.mSummaries.push_back({ summaryId, summary });
+		}
+	}
+	return snapshot;
+}
+
+bool Stats::Export(const char* const fileName, StatsExportFormat format, const std::string& runLabel)
+{
+	return TakeSnapshot().Export(fileName, format, runLabel);
+}
+
+Stats::Shard& Stats::GetThreadShard()
+{
+	thread_local uint64_t tStatsId = 0;
+	thread_local Shard* tShard = nullptr;
+	if (tStatsId == mStatsId)
+	{
+		return *tShard;
+	}
+
+	// First add from this thread since it last added to a different Stats
+	const std::thread::id threadId = std::this_thread::get_id();
+	std::lock_guard<std::mutex> lock(mShardsMutex);
+	auto shardIt = std::find_if(mShards.begin(), mShards.end(), [threadId](const std::unique_ptr<Shard>& shard) { return shard->mThreadId == threadId; });
+	if (shardIt == mShards.end())
+	{
+		mShards.push_back(std::make_unique<Shard>());
+		mShards.back()->mThreadId = threadId;
+		shardIt = mShards.end() - 1;
+	}
+
+	tStatsId = mStatsId;
+	tShard = shardIt->get();
+	return *tShard;
+}
+
+Stats::IntHistogram Stats::MergeShards(int32_t distributionId)
+{
+	IntHistogram merged;
+	std::lock_guard<std::mutex> lock(mShardsMutex);
+	for (const std::unique_ptr<Shard>& shard : mShards)
+	{
+		if (distributionId < (int32_t)shard->mIntDistributions.size())
+		{
+			merged.Merge(shard->mIntDistributions[distributionId]);
+		}
+	}
+	return merged;
+}
+
+void Stats::IntHistogram::Merge(const IntHistogram& other)
+{
+	for (int32_t binIndex = 0; binIndex < (int32_t)other.mBins.size(); ++binIndex)
+	{
+		if (other.mBins[binIndex] != 0)
+		{
+			Add(other.mFirstValue + binIndex, other.mBins[binIndex]);
+		}
+	}
+	mUnderflowAmount += other.mUnderflowAmount;
+	mOverflowAmount += other.mOverflowAmount;
+}
+
+void Stats::IntHistogram::Clear()
+{
+	std::fill(mBins.begin(), mBins.end(), 0);
+	mUnderflowAmount = 0;
+	mOverflowAmount = 0;
+}
+
+int32_t Stats::IntHistogram::GetAmount(int64_t value) const
+{
+	const uint64_t binIndex = (uint64_t)((int64_t)value - mFirstValue);
+	return (binIndex < mBins.size()) ? mBins[binIndex] : 0;
+}
+
+bool Stats::IntHistogram::FindValueRange(int32_t& outValueMin, int32_t& outValueMax) const
+{
+	auto isNonZero = [](int32_t amount) { return amount != 0; };
+	const auto firstIt = std::find_if(mBins.begin(), mBins.end(), isNonZero);
+	if (firstIt == mBins.end())
+	{
+		return false;
+	}
+
+	const auto lastIt = std::find_if(mBins.rbegin(), mBins.rend(), isNonZero);
+	outValueMin = (int32_t)(mFirstValue + (int64_t)(firstIt - mBins.begin()));
+	outValueMax = (int32_t)(mFirstValue + (int64_t)(mBins.rend() - lastIt) - 1);
+	return true;
+}
+
+int32_t Stats::IntHistogram::GetAmountMax() const
+{
+	return mBins.empty() ? 0 : *std::max_element(mBins.begin(), mBins.end());
+}
+
+void Stats::IntHistogram::AddOutside(int32_t value, int32_t amount)
+{
+	if (Grow(value))
+	{
+		mBins[(int64_t)value - mFirstValue] += amount;
+	}
+	else if (value < mFirstValue)
+	{
+		mUnderflowAmount += amount;
+	}
+	else
+	{
+		mOverflowAmount += amount;
+	}
+}
+
+bool Stats::IntHistogram::Grow(int32_t value)
+{
+	if (mBins.empty())
+	{
+		mFirstValue = value - (value & (cMinBins - 1));
+		mBins.assign(cMinBins, 0);
+		return true;
+	}
+
+	// In 64 bits, as the range can reach past either end of int32_t before it's clamped back in
+	int64_t newFirstValue = mFirstValue;
+	int64_t newNumBins = (int64_t)mBins.size();
+	while (((value < newFirstValue) || (value >= newFirstValue + newNumBins)) && (newNumBins < cMaxBins))
+	{
+		if (value < newFirstValue)
+		{
+			newFirstValue -= newNumBins;
+		}
+		newNumBins *= 2;
+	}
+	newFirstValue = std::clamp<int64_t>(newFirstValue, INT32_MIN, (int64_t)INT32_MAX + 1 - newNumBins);
+
+	if (newNumBins != (int64_t)mBins.size())
+	{
+		std::vector<int32_t> newBins(newNumBins, 0);
+		std::copy(mBins.begin(), mBins.end(), newBins.begin() + (mFirstValue - newFirstValue));
+		mBins.swap(newBins);
+		mFirstValue = (int32_t)newFirstValue;
+	}
+	return (value >= newFirstValue) && (value < newFirstValue + newNumBins);
+}
+
+void Stats::PrintIntDistribution(int32_t distributionId, int32_t width, int32_t height)
+{
+	const IntHistogram distribution = MergeShards(distributionId);
+	int32_t valueMin = 0;
+	int32_t valueMax = 0;
+	if (!distribution.FindValueRange(valueMin, valueMax))
 	{
 		printf("\n\n==Empty==\n\n");
 		return;
 	}
 
-	const int32_t xDelta = distribution.mValueMax - distribution.mValueMin;
+	const int32_t amountMax = distribution.GetAmountMax();
+	const std::string& xName = mAxisNames[distributionId].mXName;
+
+	const int32_t xDelta = valueMax - valueMin;
 	const int32_t xSpacePer = std::max(1, xDelta / width);
-	const int32_t ySpacePer = std::max(1, distribution.mAmountMax / height);
+	const int32_t ySpacePer = std::max(1, amountMax / height);
 	const int32_t yHalfSpace = ySpacePer / 2;
 
-	const int32_t xPrintSpace = (int32_t)distribution.mXName.length() + 1;
+	const int32_t xPrintSpace = (int32_t)xName.length() + 1;
 
 	int32_t xSubspacePre = 0;
 	int32_t xSubspacePost = 0;
@@ -67,23 +849,23 @@ void Stats::PrintIntDistribution(int32_t distributionId, int32_t width, int32_t
 		xSubspacePost = (xSpacePer - 1) / 2;
 	}
 
-	for (int32_t y = distribution.mAmountMax; y > 0; y -= ySpacePer)
+	for (int32_t y = amountMax; y > 0; y -= ySpacePer)
 	{
 		printf("\n%*d|", xPrintSpace, y);
 		
-		for (int32_t x = distribution.mValueMin; x <= distribution.mValueMax; x += xSpacePer)
+		for (int64_t x = valueMin; x <= valueMax; x += xSpacePer)
 		{
 			putchar(' ');
 
 			// Combine nearby numbers if they are hidden
-			int32_t accumulatedAmount = distribution.mValueToAmount.try_emplace(x, 0).first->second;
+			int32_t accumulatedAmount = distribution.GetAmount(x);
 			for (int32_t subspaceOffset = 1; subspaceOffset <= xSubspacePre; ++subspaceOffset)
 			{
-				accumulatedAmount += distribution.mValueToAmount.try_emplace(x - subspaceOffset, 0).first->second;
+				accumulatedAmount += distribution.GetAmount(x - subspaceOffset);
 			}
 			for (int32_t subspaceOffset = 1; subspaceOffset <= xSubspacePost; ++subspaceOffset)
 			{
-				accumulatedAmount += distribution.mValueToAmount.try_emplace(x + subspaceOffset, 0).first->second;
+				accumulatedAmount += distribution.GetAmount(x + subspaceOffset);
 			}
 			accumulatedAmount /= (1 + xSubspacePre + xSubspacePost);
 
@@ -103,7 +885,7 @@ void Stats::PrintIntDistribution(int32_t distributionId, int32_t width, int32_t
 		}
 	}
 
-	printf("\n%*s|", xPrintSpace, distribution.mXName.c_str());
+	printf("\n%*s|", xPrintSpace, xName.c_str());
 
 	int32_t digit = 2;
 	while (true)
@@ -111,9 +893,9 @@ void Stats::PrintIntDistribution(int32_t distributionId, int32_t width, int32_t
 		const int32_t within = (int32_t)std::pow(10.0, (double)digit);
 		const int32_t place = (int32_t)std::pow(10.0, (double)(digit - 1));
 
-		for (int32_t x = distribution.mValueMin; x <= distribution.mValueMax; x += xSpacePer)
+		for (int64_t x = valueMin; x <= valueMax; x += xSpacePer)
 		{
-			const int32_t xThisDigit = (x % within) / place;
+			const int32_t xThisDigit = (int32_t)((x % within) / place);
 			if (xThisDigit > 0)
 			{
 				printf(" %d", xThisDigit);
@@ -142,4 +924,9 @@ void Stats::PrintIntDistribution(int32_t distributionId, int32_t width, int32_t
 			break;
 		}
 	}
+
+	if ((distribution.GetUnderflowAmount() != 0) || (distribution.GetOverflowAmount() != 0))
+	{
+		printf("\n%*s Not shown: %" PRId64 " below, %" PRId64 " above", xPrintSpace, "", distribution.GetUnderflowAmount(), distribution.GetOverflowAmount());
+	}
 }
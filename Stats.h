@@ -1,34 +1,269 @@
 #pragma once
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include "MathCommon.h"
 
+/**
+ * Count, mean, variance and range of a stream of values, updated in place with Welford's method
+ */
+struct StatsMoments
+{
+	uint64_t mCount = 0;
+	double mMean = 0.0;
+	double mSumSquaredDeltas = 0.0; // From the mean
+	double mMin = std::numeric_limits<double>::infinity();
+	double mMax = -std::numeric_limits<double>::infinity();
+
+	void Add(double value);
+	void Merge(const StatsMoments& other);
+
+	double GetVariance() const { return (mCount > 1) ? (mSumSquaredDeltas / (double)(mCount - 1)) : 0.0; } // Sample variance
+	double GetStandardDeviation() const { return std::sqrt(GetVariance()); }
+};
+
+/**
+ * DDSketch: quantiles of a stream of values to within a relative error, in bounded memory.
+ * Values are counted in bins whose bounds grow geometrically, so any quantile is off by at most mRelativeAccuracy of
+ * its value. Past cMaxBins bins per sign the bins closest to zero are folded together, which only affects the
+ * smallest magnitudes. Sketches with the same accuracy merge exactly, in any order.
+ */
+class QuantileSketch
+{
+public:
+	QuantileSketch(double relativeAccuracy = 0.01);
+
+	void Add(double value, uint64_t count = 1);
+	void Merge(const QuantileSketch& other);
+
+	uint64_t GetCount() const { return mNegative.mTotal + mZeroCount + mPositive.mTotal; }
+	double GetQuantile(double quantile) const; // quantile in [0, 1]. 0 if empty
+
+	// The bins themselves, so a sketch can be exported and merged with other runs later. Keys are ceil(log base gamma) of the
+	// magnitude, and the counts run from the first key up
+	double GetRelativeAccuracy() const { return mRelativeAccuracy; }
+	uint64_t GetZeroCount() const { return mZeroCount; }
+	int32_t GetFirstKey(bool bNegative) const { return (bNegative ? mNegative : mPositive).mFirstKey; }
+	const std::vector<uint64_t>& GetBinCounts(bool bNegative) const { return (bNegative ? mNegative : mPositive).mBins; }
+	void AddBins(bool bNegative, int32_t firstKey, std::span<const uint64_t> binCounts); // Exact when the accuracy is the same as the sketch they came from
+	void AddZeroCount(uint64_t count) { mZeroCount += count; }
+
+private:
+	struct BinStore
+	{
+		int32_t mFirstKey = 0;
+		std::vector<uint64_t> mBins;
+		uint64_t mTotal = 0;
+
+		void Add(int32_t key, uint64_t count);
+	};
+
+	int32_t GetKey(double magnitude) const { return (int32_t)std::ceil(std::log(magnitude) * mInverseLogGamma); }
+	double GetValue(int32_t key) const; // Middle of the bin, to within the relative accuracy of every value in it
+
+	static constexpr int32_t cMaxBins = 2048;
+	static constexpr double cMinMagnitude = 1e-9; // Smaller values count as zero
+
+	double mRelativeAccuracy = 0.0;
+	double mGamma = 0.0;
+	double mInverseLogGamma = 0.0;
+
+	BinStore mPositive;
+	BinStore mNegative; // By magnitude
+	uint64_t mZeroCount = 0;
+};
+
+struct StatsSummary
+{
+	StatsMoments mMoments;
+	QuantileSketch mQuantiles;
+
+	void Add(double value)
+	{
+		mMoments.Add(value);
+		mQuantiles.Add(value);
+	}
+
+	void Merge(const StatsSummary& other)
+	{
+		mMoments.Merge(other.mMoments);
+		mQuantiles.Merge(other.mQuantiles);
+	}
+
+	void Print(const char* const name) const;
+};
+
+enum class StatsExportFormat : uint8_t
+{
+	Csv,
+	Json, // One object per line (JSON Lines)
+	Binary,
+
+	Count
+};
+ENUM_OPS(StatsExportFormat);
+
+/**
+ * A copy of everything in a Stats, merged over its shards. Once taken it's independent of the Stats, so it can be
+ * exported from any thread while the Stats is added to again.
+ *
+ * Export appends one run to a file, so runs from separate processes or configurations can share a file:
+ * - Csv: a row per histogram value and per summary, under a header written only to a new file
+ * - Json: one object per run and line
+ * - Binary: one little endian record per run. "WPST", uint32 version, then the run label, the histograms and the summaries.
+ *   A histogram's underflow and overflow amounts (int64 each) follow its amounts. A summary is its id, the moments (count,
+ *   mean, sum of squared deltas, min, max), P50, P90 and P99, then its quantile sketch: relative accuracy, zero count, and
+ *   the negative then positive bins, each as an int32 first key and a list of uint64 counts. ReadBinary reads a record back.
+ * Json carries the same sketch, so quantiles of separate runs can be merged from either. Csv leaves the histogram
+ * underflow and overflow and the sketch out.
+ *   Strings are a uint32 length then the bytes, lists are a uint32 count then the items.
+ * Each run is formatted in memory first and appended with a single write.
+ */
+struct StatsSnapshot
+{
+	struct IntDistribution
+	{
+		int32_t mId = 0;
+		int32_t mFirstValue = 0;
+		std::vector<int32_t> mAmounts; // From mFirstValue up to the highest value with a non zero amount
+		int64_t mUnderflowAmount = 0; // Of values too far out for the histogram to keep, see Stats::IntHistogram
+		int64_t mOverflowAmount = 0;
+		std::string mXName;
+		std::string mYName;
+	};
+
+	struct Summary
+	{
+		int32_t mId = 0;
+		StatsSummary mSummary;
+	};
+
+	std::vector<IntDistribution> mIntDistributions;
+	std::vector<Summary> mSummaries;
+
+	bool Export(const char* const fileName, StatsExportFormat format, const std::string& runLabel) const;
+	static bool ReadBinary(std::string_view& inOutBytes, std::string& outRunLabel, StatsSnapshot& outSnapshot); // One record from Export. Consumes it, or returns false
+
+	static constexpr uint32_t cBinaryVersion = 3;
+
+private:
+	void AppendCsv(std::string& outText, const std::string& runLabel, bool bWithHeader) const;
+	void AppendJson(std::string& outText, const std::string& runLabel) const;
+	void AppendBinary(std::string& outBytes, const std::string& runLabel) const;
+};
+
+/**
+ * Integer histograms, one per distribution id, and streaming summaries (moments and quantiles), one per summary id.
+ * Ids index flat arrays, so keep them small (e.g. WPStatsIds).
+ *
+ * Every thread that adds gets its own shard, found through a thread_local cache, so adding takes no lock and no atomic.
+ * Shards are merged when reading, which must not overlap with adding: reading walks vectors that an add can grow under
+ * it. Nothing (no seqlock or double buffer) guards against that, to keep adds free, so a caller that exports mid run
+ * has to pause its adding threads (e.g. between ThreadPool batches) for the TakeSnapshot.
+ */
 class Stats
 {
 public:
-	Stats()
-	{}
+	Stats();
+
+	Stats(const Stats&) = delete;
+	Stats& operator=(const Stats&) = delete;
 
-	void ClearIntDistribution();
+	void ClearIntDistribution(); // Every distribution, every shard
 	void AddToIntDistribution(int32_t distributionId, int32_t value, int32_t amount = 1);
 	void SetIntDistributionAxisNames(int32_t distributionId, const char* const xName, const char* const yName);
 	void PrintIntDistribution(int32_t distributionId, int32_t width, int32_t height);
 
+	void ClearSummaries();
+	void AddToSummary(int32_t summaryId, double value);
+	StatsSummary GetSummary(int32_t summaryId);
+	void PrintSummary(int32_t summaryId, const char* const name);
+
+	void Merge(Stats& other); // Adds everything in other, e.g. from another run. other must not be added to meanwhile
+
+	StatsSnapshot TakeSnapshot(); // A read like any other: no thread may be adding while it runs. The copy can then be exported from any thread
+	bool Export(const char* const fileName, StatsExportFormat format, const std::string& runLabel); // See StatsSnapshot
+
 private:
-	struct IntDistribution
+	/**
+	 * Dense counts for a contiguous range of values. The range doubles towards any value that lands outside it, up to
+	 * cMaxBins values. Past that, values below or above the range are only counted, so outliers can't blow up the memory.
+	 */
+	class IntHistogram
 	{
-		std::map<int32_t, int32_t> mValueToAmount;
-		int32_t mValueMin = INT_MAX;
-		int32_t mValueMax = 0;
-		int32_t mAmountMax = 0;
+	public:
+		void Add(int32_t value, int32_t amount)
+		{
+			const uint64_t binIndex = (uint64_t)((int64_t)value - mFirstValue);
+			if (binIndex < mBins.size())
+			{
+				mBins[binIndex] += amount;
+			}
+			else
+			{
+				AddOutside(value, amount);
+			}
+		}
 
+		void Merge(const IntHistogram& other);
+		void Clear();
+
+		int32_t GetAmount(int64_t value) const; // 0 outside the range
+		bool FindValueRange(int32_t& outValueMin, int32_t& outValueMax) const; // Lowest and highest values with a non zero amount
+		int32_t GetAmountMax() const;
+
+		int32_t GetFirstValue() const { return mFirstValue; }
+		const std::vector<int32_t>& GetBins() const { return mBins; }
+		int64_t GetUnderflowAmount() const { return mUnderflowAmount; }
+		int64_t GetOverflowAmount() const { return mOverflowAmount; }
+
+	private:
+		void AddOutside(int32_t value, int32_t amount);
+		bool Grow(int32_t value); // False if the range is already as wide as it gets and value is still outside it
+
+		static constexpr int64_t cMinBins = 16;
+		static constexpr int64_t cMaxBins = 1 << 20;
+
+		int32_t mFirstValue = 0;
+		std::vector<int32_t> mBins;
+		int64_t mUnderflowAmount = 0; // Of values below the range, once it stopped growing
+		int64_t mOverflowAmount = 0; // And above
+	};
+
+	struct Shard
+	{
+		std::thread::id mThreadId;
+		std::vector<IntHistogram> mIntDistributions; // Indexed by distribution id
+		std::vector<StatsSummary> mSummaries; // Indexed by summary id
+	};
+
+	struct AxisNames
+	{
 		std::string mXName;
 		std::string mYName;
 	};
 
-	std::map<int32_t, IntDistribution> mIntDistributions;
+	Shard& GetThreadShard();
+	IntHistogram MergeShards(int32_t distributionId);
 
-	std::map<int32_t, int32_t> mIntDistribution;
-	int32_t mIntDistributionValueMin = INT_MAX;
-	int32_t mIntDistributionValueMax = 0;
-	int32_t mIntDistributionAmountMax = 0;
-};
+	template<typename T>
+	static T& GetOrAdd(std::vector<T>& items, int32_t id)
+	{
+		if (id >= (int32_t)items.size())
+		{
+			items.resize(id + 1);
+		}
+		return items[id];
+	}
 
+	static std::atomic<uint64_t> sNextStatsId;
+
+	const uint64_t mStatsId; // Never reused, unlike the address, so thread_local caches can't point at a dead Stats
+
+	std::mutex mShardsMutex;
+	std::vector<std::unique_ptr<Shard>> mShards;
+
+	std::map<int32_t, AxisNames> mAxisNames;
+};
@@ -0,0 +1,93 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(size_t numRunners /*= 0*/)
+{
+	if (numRunners == 0)
+	{
+		numRunners = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+	}
+
+	const size_t numThreads = numRunners - 1;
+
+	mThreads.reserve(numThreads);
+	for (size_t i = 0; i < numThreads; ++i)
+	{
+		// Runner 0 is the thread calling ParallelFor
+		mThreads.emplace_back(&ThreadPool::WorkerLoop, this, i + 1);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mShutdown = true;
+	}
+	mWakeWorkers.notify_all();
+
+	for (std::thread& thread : mThreads)
+	{
+		thread.join();
+	}
+}
+
+void ThreadPool::ParallelFor(size_t numJobs, const Job& job)
+{
+	if (numJobs == 0)
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mJob = &job;
+		mNumJobs = numJobs;
+		mNextJob = 0;
+		mActiveWorkers = mThreads.size();
+		mGeneration++;
+	}
+	mWakeWorkers.notify_all();
+
+	RunJobs(0);
+
+	std::unique_lock<std::mutex> lock(mMutex);
+	mWakeCaller.wait(lock, [this]() { return mActiveWorkers == 0; });
+	mJob = nullptr;
+}
+
+void ThreadPool::WorkerLoop(size_t runnerIndex)
+{
+	uint64_t lastGeneration = 0;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mWakeWorkers.wait(lock, [this, lastGeneration]() { return mShutdown || mGeneration != lastGeneration; });
+			if (mShutdown)
+			{
+				return;
+			}
+			lastGeneration = mGeneration;
+		}
+
+		RunJobs(runnerIndex);
+
+		bool bLastWorker = false;
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			bLastWorker = (--mActiveWorkers == 0);
+		}
+		if (bLastWorker)
+		{
+			mWakeCaller.notify_one();
+		}
+	}
+}
+
+void ThreadPool::RunJobs(size_t runnerIndex)
+{
+	for (size_t jobIndex = mNextJob.fetch_add(1); jobIndex < mNumJobs; jobIndex = mNextJob.fetch_add(1))
+	{
+		(*mJob)(jobIndex, runnerIndex);
+	}
+}
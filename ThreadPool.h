@@ -0,0 +1,43 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+/**
+ * Fixed set of worker threads that run index based jobs.
+ * ParallelFor blocks until every job index has been run. The calling thread is runner 0, so a pool of N runners owns N-1 threads.
+ * Jobs are claimed one index at a time from an atomic counter, so uneven job lengths balance themselves.
+ */
+class ThreadPool
+{
+public:
+	using Job = std::function<void(size_t jobIndex, size_t runnerIndex)>;
+
+	ThreadPool(size_t numRunners = 0); // 0 uses the hardware thread count
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	void ParallelFor(size_t numJobs, const Job& job);
+
+	size_t GetNumRunners() const { return mThreads.size() + 1; }
+
+private:
+	void WorkerLoop(size_t runnerIndex);
+	void RunJobs(size_t runnerIndex);
+
+	std::vector<std::thread> mThreads;
+
+	std::mutex mMutex;
+	std::condition_variable mWakeWorkers;
+	std::condition_variable mWakeCaller;
+
+	const Job* mJob = nullptr;
+	size_t mNumJobs = 0;
+	std::atomic<size_t> mNextJob = 0;
+	size_t mActiveWorkers = 0;
+	uint64_t mGeneration = 0;
+	bool mShutdown = false;
+};
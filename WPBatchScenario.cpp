@@ -0,0 +1,381 @@
+#include "WPBatchScenario.h"
+
+#include "RNG.h"
+
+namespace
+{
+	constexpr int32_t cMaxSlotKey = DicePool::cCapacity - 1;
+
+	int32_t GetSlotFromKey(int32_t key)
+	{
+		return cMaxSlotKey - (key & 0xF);
+	}
+}
+
+void WPBatchScenario::LaneSide::Setup(WorkerType workerType, int32_t cardVariation, int32_t numLanes)
+{
+	const WPCatalog& catalog = WPCatalog::Get();
+	mStats = catalog.GetWorkerStats(workerType);
+
+	const WPDeck& deck = catalog.GetDeck(cardVariation);
+	mNumCards = deck.mNumCards;
+	for (int32_t deckIndex = 0; deckIndex < deck.mNumCards; ++deckIndex)
+	{
+		mCardSkillBonuses[deckIndex] = catalog.GetCard(deck.mCardIndexes[deckIndex]).mCardLevel * 10;
+	}
+
+	mHealth.resize(numLanes);
+	mSkill.resize(numLanes);
+	mFleeCurrent.resize(numLanes);
+	mDeck.resize(numLanes);
+	mHand.resize(numLanes);
+	mFleeing.resize(numLanes);
+
+	mTotalValue.resize(numLanes);
+	mBestPossibleTotal.resize(numLanes);
+	mResultBonusDice.resize(numLanes);
+
+	mTens.resize(numLanes);
+	mOnes.resize(numLanes);
+	mRollTotal.resize(numLanes);
+	mRollResultBonuses.resize(numLanes);
+	mRollCardPlays.resize(numLanes);
+
+	mDiceValue.resize(DicePool::cCapacity * numLanes);
+	mDicePredicted.resize(DicePool::cCapacity * numLanes);
+	mDiceBest.resize(DicePool::cCapacity * numLanes);
+	mDiceEffect.resize(DicePool::cCapacity * numLanes);
+}
+
+WPBatchScenario::WPBatchScenario(const RNG& rng, const WPMatchup& matchup, int32_t numLanes /*= cDefaultNumLanes*/)
+: mRng(rng)
+, mMatchup(matchup)
+, mNumLanes(std::max(numLanes, 1))
+, mIsLaned(IsSupported(matchup))
+{
+	if (mIsLaned)
+	{
+		mAttacker.Setup(matchup.mAttackerType, matchup.mAttackerCardVariation, mNumLanes);
+		mDefender.Setup(matchup.mDefenderType, matchup.mDefenderCardVariation, mNumLanes);
+		mResults.resize(mNumLanes);
+		mKeys.resize(mNumLanes);
+	}
+}
+
+/*static*/ bool WPBatchScenario::IsSupported(const WPMatchup& matchup)
+{
+	const std::vector<DicePlayStrategy> lanedDiceStrategy = MakeLanedDiceStrategy();
+	return (matchup.mAttackerDiceStrategy == lanedDiceStrategy)
+		&& (matchup.mDefenderDiceStrategy == lanedDiceStrategy)
+		&& matchup.mAttackerCardStrategy.empty()
+		&& matchup.mDefenderCardStrategy.empty();
+}
+
+/*static*/ std::vector<DicePlayStrategy> WPBatchScenario::MakeLanedDiceStrategy()
+{
+	return { DicePlayStrategy::TensTopOrdered, DicePlayStrategy::OnesBottomOrdered };
+}
+
+void WPBatchScenario::Run(uint64_t numFights, WPResultCounts& inOutResults)
+{
+	if (!mIsLaned)
+	{
+		WPScenario scenario(mRng);
+		mMatchup.Apply(scenario);
+		for (uint64_t fight = 0; fight < numFights; ++fight)
+		{
+			++inOutResults[+scenario.Execute()];
+		}
+		return;
+	}
+
+	while (numFights > 0)
+	{
+		const int32_t numActiveLanes = (int32_t)std::min(numFights, (uint64_t)mNumLanes);
+		std::fill_n(mResults.begin(), numActiveLanes, ScenarioResult::Count);
+		PrepLanes(mAttacker, numActiveLanes);
+		PrepLanes(mDefender, numActiveLanes);
+
+		for (int32_t numDice = DicePool::cCapacity; numDice > 1; numDice -= 2)
+		{
+			DetermineCommands(mAttacker, mDefender, numDice, numActiveLanes);
+			DetermineCommands(mDefender, mAttacker, numDice, numActiveLanes);
+
+			PullDice(mAttacker, numDice, numActiveLanes);
+			PullDice(mDefender, numDice, numActiveLanes);
+
+			PlayCards(mAttacker, numActiveLanes);
+			PlayCards(mDefender, numActiveLanes);
+
+			ResolveRound(numActiveLanes);
+		}
+
+		for (int32_t lane = 0; lane < numActiveLanes; ++lane)
+		{
+			++inOutResults[(mResults[lane] == ScenarioResult::Count) ? +ScenarioResult::Stall : +mResults[lane]];
+		}
+		numFights -= numActiveLanes;
+	}
+}
+
+void WPBatchScenario::PrepLanes(LaneSide& side, int32_t numActiveLanes)
+{
+	std::fill_n(side.mHealth.begin(), numActiveLanes, side.mStats.mHealth_Max);
+	std::fill_n(side.mSkill.begin(), numActiveLanes, side.mStats.mSkill);
+	std::fill_n(side.mFleeCurrent.begin(), numActiveLanes, 0);
+	std::fill_n(side.mDeck.begin(), numActiveLanes, CardMasks::MakeFirstN(side.mNumCards));
+	std::fill_n(side.mHand.begin(), numActiveLanes, 0);
+
+	for (int32_t lane = 0; lane < numActiveLanes; ++lane)
+	{
+		for (int32_t card = 0; card < side.mStats.mStartingHandSize; ++card)
+		{
+			DrawCard(side, lane);
+		}
+	}
+
+	// Two of each setup die, in the order WPExecutionResources::RollNOfEachDie adds them.
+	// Both faces of a pair come from one draw, which halves the RNG calls
+	constexpr int32_t cNumPairFaces = +DiceFace::Count * +DiceFace::Count;
+	for (DiceType diceType = DiceType::Heavy; diceType < DiceType::CountCombatSetupDice; ++diceType)
+	{
+		const int32_t firstDie = (+diceType * 2) * mNumLanes;
+		for (int32_t lane = 0; lane < numActiveLanes; ++lane)
+		{
+			const int32_t pairFaces = (int32_t)mRng.RandomIndex(cNumPairFaces);
+			SetDie(side, firstDie + lane, diceType, (DiceFace)(pairFaces % +DiceFace::Count));
+			SetDie(side, firstDie + mNumLanes + lane, diceType, (DiceFace)(pairFaces / +DiceFace::Count));
+		}
+	}
+
+	// Running totals of the remaining dice
+	int32_t* const totalValue = side.mTotalValue.data();
+	int32_t* const bestPossibleTotal = side.mBestPossibleTotal.data();
+	int32_t* const resultBonusDice = side.mResultBonusDice.data();
+	std::fill_n(totalValue, numActiveLanes, 0);
+	std::fill_n(bestPossibleTotal, numActiveLanes, 0);
+	std::fill_n(resultBonusDice, numActiveLanes, 0);
+	for (int32_t slot = 0; slot < DicePool::cCapacity; ++slot)
+	{
+		const int8_t* const diceValue = &side.mDiceValue[slot * mNumLanes];
+		const int8_t* const diceBest = &side.mDiceBest[slot * mNumLanes];
+		const DiceEffect* const diceEffect = &side.mDiceEffect[slot * mNumLanes];
+		for (int32_t lane = 0; lane < numActiveLanes; ++lane)
+		{
+			totalValue[lane] += diceValue[lane];
+			bestPossibleTotal[lane] += diceBest[lane];
+			resultBonusDice[lane] += (diceEffect[lane] == DiceEffect::ResultBonus) ? 1 : 0;
+		}
+	}
+}
+
+void WPBatchScenario::SetDie(LaneSide& side, int32_t die, DiceType diceType, DiceFace diceFace)
+{
+	const DieFace& dieFace = cDieFaces[+diceType][+diceFace];
+	side.mDiceValue[die] = dieFace.mValue;
+	side.mDicePredicted[die] = dieFace.mValue + ((dieFace.mDiceEffect == DiceEffect::PlayCard) ? 1 : 0);
+	side.mDiceBest[die] = cDieFaces[+diceType][+DiceFace::Best].mValue;
+	side.mDiceEffect[die] = dieFace.mDiceEffect;
+}
+
+void WPBatchScenario::DrawCard(LaneSide& side, int32_t lane)
+{
+	CardMask& deck = side.mDeck[lane];
+	if (deck != 0)
+	{
+		const int32_t drawnIndex = CardMasks::SelectNth(deck, (int32_t)mRng.RandomIndex(CardMasks::Count(deck)));
+		deck &= ~CardMasks::FromIndex(drawnIndex);
+		side.mHand[lane] |= CardMasks::FromIndex(drawnIndex);
+	}
+}
+
+/**
+ * Same as WPWorker::DetermineCommand
+ */
+void WPBatchScenario::DetermineCommands(LaneSide& side, const LaneSide& opponent, int32_t numDice, int32_t numActiveLanes)
+{
+	const int32_t remainingRounds = numDice / 2;
+	const int32_t fleeFromRounds = side.mStats.mFlee * remainingRounds;
+	const int32_t opponentDamage = opponent.mStats.mDamage;
+	const int32_t opponentHold = opponent.mStats.mHold;
+
+	const int32_t* const fleeCurrent = side.mFleeCurrent.data();
+	const int32_t* const resultBonusDice = side.mResultBonusDice.data();
+	const int32_t* const totalValue = side.mTotalValue.data();
+	const int32_t* const health = side.mHealth.data();
+	const int32_t* const opponentBestPossibleTotal = opponent.mBestPossibleTotal.data();
+	uint8_t* const fleeing = side.mFleeing.data();
+
+	for (int32_t lane = 0; lane < numActiveLanes; ++lane)
+	{
+		const int32_t maxFleeWeCanGenerate = fleeCurrent[lane] + resultBonusDice[lane] + fleeFromRounds;
+		const int32_t delta = opponentBestPossibleTotal[lane] - totalValue[lane];
+		const int32_t roundsWeThinkWeWillLose = std::min(remainingRounds, delta / 4);
+		const int32_t opponentOkayPlayDamage = roundsWeThinkWeWillLose * opponentDamage;
+		fleeing[lane] = (uint8_t)((opponentOkayPlayDamage >= health[lane]) & (maxFleeWeCanGenerate >= opponentHold));
+	}
+}
+
+void WPBatchScenario::PullDice(LaneSide& side, int32_t numDice, int32_t numActiveLanes)
+{
+	int32_t* const keys = mKeys.data();
+
+	// TensTopOrdered: highest predicted value, lowest slot on ties. Same keys as WPExecutionResources' rankings
+	std::fill_n(keys, numActiveLanes, INT_MIN);
+	for (int32_t slot = 0; slot < numDice; ++slot)
+	{
+		const int8_t* const predicted = &side.mDicePredicted[slot * mNumLanes];
+		const int32_t slotKey = cMaxSlotKey - slot;
+		for (int32_t lane = 0; lane < numActiveLanes; ++lane)
+		{
+			keys[lane] = std::max(keys[lane], (predicted[lane] * 16) + slotKey);
+		}
+	}
+	for (int32_t lane = 0; lane < numActiveLanes; ++lane)
+	{
+		side.mTens[lane] = GetSlotFromKey(keys[lane]);
+	}
+
+	// OnesBottomOrdered: lowest predicted value of the other dice, lowest slot on ties
+	std::fill_n(keys, numActiveLanes, INT_MIN);
+	for (int32_t slot = 0; slot < numDice; ++slot)
+	{
+		const int8_t* const predicted = &side.mDicePredicted[slot * mNumLanes];
+		const int32_t slotKey = cMaxSlotKey - slot;
+		for (int32_t lane = 0; lane < numActiveLanes; ++lane)
+		{
+			const int32_t key = (side.mTens[lane] != slot) ? ((-predicted[lane] * 16) + slotKey) : INT_MIN;
+			keys[lane] = std::max(keys[lane], key);
+		}
+	}
+	for (int32_t lane = 0; lane < numActiveLanes; ++lane)
+	{
+		side.mOnes[lane] = GetSlotFromKey(keys[lane]);
+	}
+
+	// Commit. Each lane removes different slots, so this part is per lane
+	for (int32_t lane = 0; lane < numActiveLanes; ++lane)
+	{
+		if (mResults[lane] != ScenarioResult::Count)
+		{
+			continue;
+		}
+
+		// Always put the highest number first
+		const int32_t pickedDieA = (side.mTens[lane] * mNumLanes) + lane;
+		const int32_t pickedDieB = (side.mOnes[lane] * mNumLanes) + lane;
+		const bool bSwapPicked = (side.mDiceValue[pickedDieB] > side.mDiceValue[pickedDieA]);
+		const int32_t tensDie = bSwapPicked ? pickedDieB : pickedDieA;
+		const int32_t onesDie = bSwapPicked ? pickedDieA : pickedDieB;
+
+		const int32_t tensValue = side.mDiceValue[tensDie];
+		const int32_t onesValue = side.mDiceValue[onesDie];
+		const int32_t resultBonuses = (int32_t)(side.mDiceEffect[tensDie] == DiceEffect::ResultBonus) + (int32_t)(side.mDiceEffect[onesDie] == DiceEffect::ResultBonus);
+
+		side.mRollTotal[lane] = (tensValue * 10) + onesValue + side.mSkill[lane];
+		side.mRollResultBonuses[lane] = resultBonuses;
+		side.mRollCardPlays[lane] = (int32_t)(side.mDiceEffect[tensDie] == DiceEffect::PlayCard) + (int32_t)(side.mDiceEffect[onesDie] == DiceEffect::PlayCard);
+
+		side.mTotalValue[lane] -= tensValue + onesValue;
+		side.mBestPossibleTotal[lane] -= side.mDiceBest[tensDie] + side.mDiceBest[onesDie];
+		side.mResultBonusDice[lane] -= resultBonuses;
+
+		// Remove the higher slot first, swapping the last die into it like DicePool::SwapRemove
+		const int32_t lastDie = ((numDice - 1) * mNumLanes) + lane;
+		RemoveDie(side, std::max(tensDie, onesDie), lastDie);
+		RemoveDie(side, std::min(tensDie, onesDie), lastDie - mNumLanes);
+	}
+}
+
+void WPBatchScenario::RemoveDie(LaneSide& side, int32_t removedDie, int32_t lastDie)
+{
+	side.mDiceValue[removedDie] = side.mDiceValue[lastDie];
+	side.mDicePredicted[removedDie] = side.mDicePredicted[lastDie];
+	side.mDiceBest[removedDie] = side.mDiceBest[lastDie];
+	side.mDiceEffect[removedDie] = side.mDiceEffect[lastDie];
+}
+
+/**
+ * Same as the fallback in WPWorker::PlayCards, the only way cards are played without a card strategy
+ */
+void WPBatchScenario::PlayCards(LaneSide& side, int32_t numActiveLanes)
+{
+	for (int32_t lane = 0; lane < numActiveLanes; ++lane)
+	{
+		int32_t numCards = side.mRollCardPlays[lane];
+		if ((numCards == 0) || (mResults[lane] != ScenarioResult::Count))
+		{
+			continue;
+		}
+
+		int32_t permanentSkillIncrease = 0;
+		CardMask& hand = side.mHand[lane];
+		while ((numCards > 0) && (hand != 0))
+		{
+			const int32_t randomIndex = CardMasks::SelectNth(hand, (int32_t)mRng.RandomIndex(CardMasks::Count(hand)));
+			permanentSkillIncrease += side.mCardSkillBonuses[randomIndex];
+			hand &= ~CardMasks::FromIndex(randomIndex);
+			--numCards;
+			DrawCard(side, lane);
+		}
+
+		side.mSkill[lane] += permanentSkillIncrease;
+		side.mRollTotal[lane] += permanentSkillIncrease;
+	}
+}
+
+/**
+ * Same as the end of a round in WPScenario::ExecuteInnerLoop. With no card effects every worker evaluates once.
+ */
+void WPBatchScenario::ResolveRound(int32_t numActiveLanes)
+{
+	const int32_t attackerFlee = mAttacker.mStats.mFlee;
+	const int32_t defenderFlee = mDefender.mStats.mFlee;
+	const int32_t attackerHold = mAttacker.mStats.mHold;
+	const int32_t defenderHold = mDefender.mStats.mHold;
+	const int32_t attackerDamage = mAttacker.mStats.mDamage;
+	const int32_t defenderDamage = mDefender.mStats.mDamage;
+
+	// Pulled out of the vectors so the compiler can see the lanes don't alias
+	const int32_t* const attackerRollTotal = mAttacker.mRollTotal.data();
+	const int32_t* const defenderRollTotal = mDefender.mRollTotal.data();
+	const int32_t* const attackerResultBonuses = mAttacker.mRollResultBonuses.data();
+	const int32_t* const defenderResultBonuses = mDefender.mRollResultBonuses.data();
+	const uint8_t* const attackerFleeing = mAttacker.mFleeing.data();
+	const uint8_t* const defenderFleeing = mDefender.mFleeing.data();
+	int32_t* const attackerFleeCurrent = mAttacker.mFleeCurrent.data();
+	int32_t* const defenderFleeCurrent = mDefender.mFleeCurrent.data();
+	int32_t* const attackerHealth = mAttacker.mHealth.data();
+	int32_t* const defenderHealth = mDefender.mHealth.data();
+	ScenarioResult* const results = mResults.data();
+
+	for (int32_t lane = 0; lane < numActiveLanes; ++lane)
+	{
+		// Flags are 0 or 1 and combined with & and | so the loop has no branches
+		const int32_t attackerWonRollResult = (int32_t)(attackerRollTotal[lane] > defenderRollTotal[lane]);
+		const int32_t defenderWonRollResult = (int32_t)(defenderRollTotal[lane] > attackerRollTotal[lane]);
+		const int32_t attackerIsFleeing = attackerFleeing[lane];
+		const int32_t defenderIsFleeing = defenderFleeing[lane];
+
+		attackerFleeCurrent[lane] += attackerIsFleeing * (attackerFlee + (attackerResultBonuses[lane] * attackerWonRollResult));
+		defenderFleeCurrent[lane] += defenderIsFleeing * (defenderFlee + (defenderResultBonuses[lane] * defenderWonRollResult));
+		const int32_t attackerFled = attackerIsFleeing & (int32_t)(attackerFleeCurrent[lane] >= defenderHold);
+		const int32_t defenderFled = defenderIsFleeing & (int32_t)(defenderFleeCurrent[lane] >= attackerHold);
+		const int32_t nobodyFled = 1 - (attackerFled | defenderFled);
+
+		const int32_t attackerHits = nobodyFled & attackerWonRollResult & (1 - attackerIsFleeing);
+		const int32_t defenderHits = nobodyFled & defenderWonRollResult & (1 - defenderIsFleeing);
+		defenderHealth[lane] -= attackerHits * (attackerDamage + attackerResultBonuses[lane]);
+		attackerHealth[lane] -= defenderHits * (defenderDamage + defenderResultBonuses[lane]);
+
+		int32_t result = +ScenarioResult::Count;
+		result = (attackerHits & (int32_t)(defenderHealth[lane] <= 0)) ? +ScenarioResult::AttackerWin : result;
+		result = (defenderHits & (int32_t)(attackerHealth[lane] <= 0)) ? +ScenarioResult::DefenderWin : result;
+		result = defenderFled ? +ScenarioResult::DefenderFlee : result;
+		result = attackerFled ? +ScenarioResult::AttackerFlee : result;
+		result = (attackerFled & defenderFled) ? +ScenarioResult::BothFlee : result;
+
+		// Finished lanes keep their first result
+		results[lane] = (results[lane] == ScenarioResult::Count) ? (ScenarioResult)result : results[lane];
+	}
+}
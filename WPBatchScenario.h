@@ -0,0 +1,91 @@
+#pragma once
+#include "WPCatalog.h"
+#include "WPComparison.h"
+
+class RNG;
+
+using WPResultCounts = std::array<uint64_t, +ScenarioResult::Count>;
+
+/**
+ * Runs many fights of one matchup side by side, one lane per fight. Every piece of fight state is an array over the
+ * lanes, and dice are stored slot by slot ([slot * numLanes + lane]), so each step of a round is a straight loop over
+ * lanes that the compiler can vectorize: commands, picking the tens and ones dice, flee and damage.
+ *
+ * Lanes step their rounds together. A lane that has finished keeps its result and is skipped by the scalar parts,
+ * which are card plays (how many cards and which ones is different in every lane) and removing the picked dice.
+ *
+ * Only matchups where both workers pick dice with TensTopOrdered then OnesBottomOrdered and have no card strategy
+ * can be laned, since their cards are only ever played as random skill bonuses. Any other matchup runs one
+ * WPScenario fight at a time, with the same results.
+ */
+class WPBatchScenario
+{
+public:
+	static constexpr int32_t cDefaultNumLanes = 1024;
+
+	WPBatchScenario(const RNG& rng, const WPMatchup& matchup, int32_t numLanes = cDefaultNumLanes);
+
+	void Run(uint64_t numFights, WPResultCounts& inOutResults);
+
+	bool IsLaned() const { return mIsLaned; } // False when fights fall back to WPScenario
+
+	static bool IsSupported(const WPMatchup& matchup);
+	static std::vector<DicePlayStrategy> MakeLanedDiceStrategy();
+
+private:
+	struct LaneSide
+	{
+		// Same for every lane
+		WPWorkerStats mStats;
+		int32_t mNumCards = 0;
+		std::array<int32_t, cMaxCardsPerDeck> mCardSkillBonuses = {};
+
+		// One per lane
+		std::vector<int32_t> mHealth;
+		std::vector<int32_t> mSkill;
+		std::vector<int32_t> mFleeCurrent;
+		std::vector<CardMask> mDeck;
+		std::vector<CardMask> mHand;
+		std::vector<uint8_t> mFleeing; // This round's command
+
+		// Running totals of the remaining dice, one per lane
+		std::vector<int32_t> mTotalValue;
+		std::vector<int32_t> mBestPossibleTotal;
+		std::vector<int32_t> mResultBonusDice;
+
+		// This round's pulled dice, one per lane
+		std::vector<int32_t> mTens;
+		std::vector<int32_t> mOnes;
+		std::vector<int32_t> mRollTotal;
+		std::vector<int32_t> mRollResultBonuses;
+		std::vector<int32_t> mRollCardPlays;
+
+		// One per die slot per lane
+		std::vector<int8_t> mDiceValue;
+		std::vector<int8_t> mDicePredicted;
+		std::vector<int8_t> mDiceBest;
+		std::vector<DiceEffect> mDiceEffect;
+
+		void Setup(WorkerType workerType, int32_t cardVariation, int32_t numLanes);
+	};
+
+	void PrepLanes(LaneSide& side, int32_t numActiveLanes);
+	void SetDie(LaneSide& side, int32_t die, DiceType diceType, DiceFace diceFace);
+	void DrawCard(LaneSide& side, int32_t lane);
+
+	void DetermineCommands(LaneSide& side, const LaneSide& opponent, int32_t numDice, int32_t numActiveLanes);
+	void PullDice(LaneSide& side, int32_t numDice, int32_t numActiveLanes);
+	void RemoveDie(LaneSide& side, int32_t removedDie, int32_t lastDie);
+	void PlayCards(LaneSide& side, int32_t numActiveLanes);
+	void ResolveRound(int32_t numActiveLanes);
+
+	const RNG& mRng;
+	WPMatchup mMatchup;
+	int32_t mNumLanes = 0;
+	bool mIsLaned = false;
+
+	LaneSide mAttacker;
+	LaneSide mDefender;
+	std::vector<ScenarioResult> mResults; // ScenarioResult::Count while the fight is still going
+	std::vector<int32_t> mKeys; // Scratch for ranking dice, one per lane
+};
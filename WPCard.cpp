@@ -1,24 +1,46 @@
 #include "WPCard.h"
 
+static const std::string kCardEffectNames[] =
+{
+	"PermanentDamage",
+	"PermanentHold",
+	"PermanentFlee",
+	"ForceDamage",
+	"TempSkill",
+	"TempBonusResult",
+	"RerollDice",
+	"ReplaceWithRandomEffectDice",
+	"ExtraEvaluate",
+	"Heal",
+	"SwapOpponentDice",
+	"StealVP",
+	"DrawCard"
+};
+ENUM_STRING_CONVERT_DEFINE(CardEffect, Count, kCardEffectNames);
+
 const WPCard WPCard::kInvalidCard(0, "Invalid", {});
 
 WPCard::WPCard(int32_t cardLevel, const char* const cardName, std::vector<CardEffectAndMagnitude> cardEffectsAndMagnitude)
 : mCardLevel(cardLevel)
 , mCardName(cardName)
-, mCardEffectsAndMagnitude(cardEffectsAndMagnitude)
 {
-
+	for (const CardEffectAndMagnitude& pair : cardEffectsAndMagnitude)
+	{
+		// First listing of an effect wins, matching the old scan
+		if (!HasCardEffect(pair.mCardEffect))
+		{
+			mMagnitudes[+pair.mCardEffect] = (int16_t)pair.mMagnitude;
+			mCardEffectMask |= (CardEffectMask)(1 << +pair.mCardEffect);
+		}
+	}
 }
 
 bool WPCard::GetCardEffect(CardEffect cardEffect, int32_t& outMagnitude) const
 {
-	for (const CardEffectAndMagnitude& pair : mCardEffectsAndMagnitude)
+	if (HasCardEffect(cardEffect))
 	{
-		if (pair.mCardEffect == cardEffect)
-		{
-			outMagnitude = pair.mMagnitude;
-			return true;
-		}
+		outMagnitude = mMagnitudes[+cardEffect];
+		return true;
 	}
 	return false;
 }
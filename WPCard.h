@@ -1,6 +1,13 @@
 #pragma once
+#include <bit>
 #include "MathCommon.h"
 
+// pdep needs BMI2. MSVC has no __BMI2__, but /arch:AVX2 targets CPUs with it. GCC and Clang need -mbmi2 whatever the AVX level
+#if defined(__BMI2__) || (defined(_MSC_VER) && defined(__AVX2__))
+#define WP_CARD_MASK_PDEP 1
+#include <immintrin.h>
+#endif
+
 enum class CardEffect : uint8_t
 {
 	PermanentDamage,
@@ -15,9 +22,58 @@ enum class CardEffect : uint8_t
 	Heal,
 	SwapOpponentDice,
 	StealVP,
-	DrawCard
+	DrawCard,
+
+	Count
 };
 ENUM_OPS(CardEffect);
+ENUM_STRING_CONVERT_DECLARE(CardEffect);
+
+using CardEffectMask = uint16_t;
+static_assert(+CardEffect::Count <= 16, "CardEffectMask needs a bit per CardEffect");
+
+/**
+ * Decks are at most 32 cards, so a deck, hand or set of played cards is one bit per card index
+ */
+using CardMask = uint32_t;
+constexpr int32_t cMaxCardsPerDeck = 32;
+
+namespace CardMasks
+{
+	inline CardMask FromIndex(int32_t index)
+	{
+		return (CardMask)1 << index;
+	}
+
+	inline CardMask MakeFirstN(int32_t n)
+	{
+		return (n >= cMaxCardsPerDeck) ? ~(CardMask)0 : (FromIndex(n) - 1);
+	}
+
+	inline int32_t Count(CardMask mask)
+	{
+		return std::popcount(mask);
+	}
+
+	inline int32_t GetLowestIndex(CardMask mask)
+	{
+		return std::countr_zero(mask);
+	}
+
+	// Card index of the nth (0 based) set bit. n must be less than Count(mask)
+	inline int32_t SelectNth(CardMask mask, int32_t n)
+	{
+#if defined(WP_CARD_MASK_PDEP)
+		return std::countr_zero(_pdep_u32(FromIndex(n), mask));
+#else
+		for (; n > 0; --n)
+		{
+			mask &= mask - 1;
+		}
+		return GetLowestIndex(mask);
+#endif
+	}
+}
 
 struct CardEffectAndMagnitude
 {
@@ -34,9 +90,27 @@ public:
 	std::string mCardName;
 
 	bool GetCardEffect(CardEffect cardEffect, int32_t& outMagnitude) const;
+	bool HasCardEffect(CardEffect cardEffect) const { return (mCardEffectMask & (1 << +cardEffect)) != 0; }
+	int32_t GetMagnitude(CardEffect cardEffect) const { return mMagnitudes[+cardEffect]; } // 0 if the card doesn't have the effect
+	CardEffectMask GetCardEffectMask() const { return mCardEffectMask; }
+
 	static const WPCard kInvalidCard;
 
 private:
-	std::vector<CardEffectAndMagnitude> mCardEffectsAndMagnitude;
+	/**
+	 * Effects are compiled into a dense table on construction, so lookups don't scan
+	 */
+	std::array<int16_t, +CardEffect::Count> mMagnitudes = {};
+	CardEffectMask mCardEffectMask = 0;
 };
 
+/**
+ * One card variation. Cards are indexes into the catalog's card table, and the effect lookups are computed when the catalog loads.
+ */
+struct WPDeck
+{
+	std::array<int16_t, cMaxCardsPerDeck> mCardIndexes = {};
+	int32_t mNumCards = 0;
+	std::array<CardMask, +CardEffect::Count> mCardsWithEffect = {};
+	std::array<int32_t, +CardEffect::Count> mMaxCardMagnitudes = {}; // Highest single card magnitude in the deck
+};
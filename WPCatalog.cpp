@@ -0,0 +1,266 @@
+#include "WPCatalog.h"
+
+#include <charconv>
+#include <fstream>
+
+static const std::string kCatalogReadModeNames[] =
+{
+	"None",
+	"Workers",
+	"Cards",
+	"Decks"
+};
+ENUM_STRING_CONVERT_DEFINE(CatalogReadMode, Count, kCatalogReadModeNames);
+
+namespace
+{
+	std::vector<std::string> SplitCatalogLine(const std::string& line, char separator)
+	{
+		std::vector<std::string> fields;
+		size_t fieldStartPos = 0;
+		size_t fieldEndPos;
+		do
+		{
+			fieldEndPos = line.find(separator, fieldStartPos);
+			fields.emplace_back(line.substr(fieldStartPos, fieldEndPos - fieldStartPos));
+			fieldStartPos = fieldEndPos + 1;
+
+		} while (fieldEndPos != std::string::npos);
+		return fields;
+	}
+
+	// The whole field must be the number, unlike atoi
+	bool ParseCatalogInt(std::string_view field, int32_t& outValue)
+	{
+		const std::from_chars_result result = std::from_chars(field.data(), field.data() + field.size(), outValue);
+		return !field.empty() && (result.ec == std::errc()) && (result.ptr == field.data() + field.size());
+	}
+}
+
+/*static*/ const WPCatalog& WPCatalog::Get()
+{
+	static const WPCatalog sCatalog("Data/WPCatalog.txt");
+	return sCatalog;
+}
+
+WPCatalog::WPCatalog(const char* const fileName)
+{
+	std::ifstream catalogFile(fileName);
+	if (!catalogFile.is_open())
+	{
+		ReportError("Could not open ", fileName);
+	}
+
+	CatalogReadMode readMode = CatalogReadMode::None;
+	std::string line;
+	while (std::getline(catalogFile, line))
+	{
+		if (!line.empty() && (line.back() == '\r'))
+		{
+			line.pop_back();
+		}
+
+		if (line.empty() || line.starts_with("//"))
+		{
+			continue;
+		}
+
+		if (line.at(0) == '#')
+		{
+			const CatalogReadMode newReadMode = ToEnum<CatalogReadMode>(line.substr(1));
+			if (newReadMode != CatalogReadMode::Count)
+			{
+				readMode = newReadMode;
+			}
+			else
+			{
+				ReportError("Unknown catalog section: ", line);
+			}
+		}
+		else
+		{
+			switch (readMode)
+			{
+			case CatalogReadMode::Workers: ReadWorkerLine(line); break;
+			case CatalogReadMode::Cards: ReadCardLine(line); break;
+			case CatalogReadMode::Decks: ReadDeckLine(line); break;
+			default: ReportError("Catalog line outside of a section: ", line); break;
+			}
+		}
+	}
+
+	for (WorkerType workerType = WorkerType::Basic; workerType < WorkerType::Count; ++workerType)
+	{
+		if (!mWorkersRead[+workerType])
+		{
+			ReportError("Catalog has no stats for ", ToString(workerType));
+		}
+	}
+	if (mDecksRead.empty() || !mDecksRead[0])
+	{
+		ReportError("Catalog has no deck 0");
+	}
+
+	PostProcessDecks();
+}
+
+void WPCatalog::ReportError(const char* const message, const std::string& detail)
+{
+	printf("\n%s%s\n", message, detail.c_str());
+	mIsValid = false;
+}
+
+const WPDeck& WPCatalog::GetDeck(int32_t variationId) const
+{
+	if ((variationId > 0) && (variationId < (int32_t)mDecks.size()))
+	{
+		return mDecks[variationId];
+	}
+	return mDecks[0];
+}
+
+void WPCatalog::ReadWorkerLine(const std::string& line)
+{
+	// Trained|10|2|6|4|1|1
+	const std::vector<std::string> fields = SplitCatalogLine(line, '|');
+	const WorkerType workerType = ToEnum<WorkerType>(fields[0]);
+	if ((workerType == WorkerType::Count) || (fields.size() < 7))
+	{
+		ReportError("Skipping catalog worker: ", line);
+		return;
+	}
+
+	WPWorkerStats workerStats;
+	if (!ParseCatalogInt(fields[1], workerStats.mSkill)
+		|| !ParseCatalogInt(fields[2], workerStats.mDamage)
+		|| !ParseCatalogInt(fields[3], workerStats.mHealth_Max)
+		|| !ParseCatalogInt(fields[4], workerStats.mHold)
+		|| !ParseCatalogInt(fields[5], workerStats.mFlee)
+		|| !ParseCatalogInt(fields[6], workerStats.mStartingHandSize))
+	{
+		ReportError("Skipping catalog worker: ", line);
+		return;
+	}
+	mWorkerStats[+workerType] = workerStats;
+	mWorkersRead[+workerType] = true;
+}
+
+void WPCatalog::ReadCardLine(const std::string& line)
+{
+	// DrawAndBonus|2|Draw a Card, +1 Temp Bonus Result|DrawCard:1,TempBonusResult:1
+	const std::vector<std::string> fields = SplitCatalogLine(line, '|');
+	int32_t cardLevel = 0;
+	if ((fields.size() < 4) || (FindCardIndex(fields[0]) != -1) || !ParseCatalogInt(fields[1], cardLevel))
+	{
+		ReportError("Skipping catalog card: ", line);
+		return;
+	}
+
+	std::vector<CardEffectAndMagnitude> cardEffectsAndMagnitude;
+	if (!fields[3].empty())
+	{
+		for (const std::string& effectField : SplitCatalogLine(fields[3], ','))
+		{
+			const size_t colonPos = effectField.find(':');
+			const CardEffect cardEffect = ToEnum<CardEffect>(effectField.substr(0, colonPos));
+			if (cardEffect == CardEffect::Count)
+			{
+				ReportError("Unknown card effect ", effectField + " on " + fields[0]);
+				continue;
+			}
+
+			int32_t magnitude = 1;
+			if ((colonPos != std::string::npos) && !ParseCatalogInt(std::string_view(effectField).substr(colonPos + 1), magnitude))
+			{
+				ReportError("Bad card effect magnitude ", effectField + " on " + fields[0]);
+				continue;
+			}
+			cardEffectsAndMagnitude.push_back({ cardEffect, magnitude });
+		}
+	}
+
+	mCards.emplace_back(cardLevel, fields[2].c_str(), std::move(cardEffectsAndMagnitude));
+	mCardIds.push_back(fields[0]);
+}
+
+void WPCatalog::ReadDeckLine(const std::string& line)
+{
+	// 1|DrawAndBonus,Reroll2,ExtraEval,Skill50
+	const std::vector<std::string> fields = SplitCatalogLine(line, '|');
+	int32_t variationId = -1;
+	if ((fields.size() < 2) || !ParseCatalogInt(fields[0], variationId) || (variationId < 0))
+	{
+		ReportError("Skipping catalog deck: ", line);
+		return;
+	}
+
+	if (variationId >= (int32_t)mDecks.size())
+	{
+		mDecks.resize(variationId + 1);
+		mDecksRead.resize(variationId + 1, false);
+	}
+
+	WPDeck& deck = mDecks[variationId];
+	deck = {};
+	mDecksRead[variationId] = true;
+
+	for (const std::string& cardId : SplitCatalogLine(fields[1], ','))
+	{
+		const int32_t cardIndex = FindCardIndex(cardId);
+		if (cardIndex == -1)
+		{
+			ReportError("Unknown card ", cardId + " in deck " + fields[0]);
+			continue;
+		}
+		if (deck.mNumCards == cMaxCardsPerDeck)
+		{
+			ReportError("Too many cards in deck ", fields[0]);
+			break;
+		}
+		deck.mCardIndexes[deck.mNumCards++] = (int16_t)cardIndex;
+	}
+}
+
+void WPCatalog::PostProcessDecks()
+{
+	if (mDecks.empty())
+	{
+		mDecks.resize(1);
+		mDecksRead.resize(1, true);
+	}
+
+	for (WPDeck& deck : mDecks)
+	{
+		for (int32_t deckIndex = 0; deckIndex < deck.mNumCards; ++deckIndex)
+		{
+			const WPCard& card = mCards[deck.mCardIndexes[deckIndex]];
+			for (CardEffectMask remaining = card.GetCardEffectMask(); remaining != 0; remaining &= (CardEffectMask)(remaining - 1))
+			{
+				const CardEffect cardEffect = (CardEffect)std::countr_zero(remaining);
+				deck.mCardsWithEffect[+cardEffect] |= CardMasks::FromIndex(deckIndex);
+				deck.mMaxCardMagnitudes[+cardEffect] = std::max(deck.mMaxCardMagnitudes[+cardEffect], card.GetMagnitude(cardEffect));
+			}
+		}
+	}
+
+	// Gaps in the variation ids play the default deck
+	for (size_t variationId = 1; variationId < mDecks.size(); ++variationId)
+	{
+		if (!mDecksRead[variationId])
+		{
+			mDecks[variationId] = mDecks[0];
+		}
+	}
+}
+
+int32_t WPCatalog::FindCardIndex(const std::string& cardId) const
+{
+	for (size_t cardIndex = 0; cardIndex < mCardIds.size(); ++cardIndex)
+	{
+		if (mCardIds[cardIndex] == cardId)
+		{
+			return (int32_t)cardIndex;
+		}
+	}
+	return -1;
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include "MathCommon.h"
+#include "WPCard.h"
+#include "WPWorker.h"
+
+enum class CatalogReadMode : uint8_t
+{
+	None,
+	Workers,
+	Cards,
+	Decks,
+
+	Count
+};
+ENUM_OPS(CatalogReadMode);
+ENUM_STRING_CONVERT_DECLARE(CatalogReadMode);
+
+struct WPWorkerStats
+{
+	int32_t mSkill = 0;
+	int32_t mDamage = 0;
+	int32_t mHealth_Max = 0;
+	int32_t mHold = 0;
+	int32_t mFlee = 0;
+	int32_t mStartingHandSize = 0;
+};
+
+/**
+ * Every worker type, card and deck variation, read once from Data/WPCatalog.txt into flat tables that are never
+ * modified afterwards. Decks are built with their effect lookups already computed, so picking a variation is a lookup.
+ * Safe to read from any thread once Get() has returned.
+ *
+ * A missing file, or any line that can't be read, leaves the catalog invalid: fights would silently run with zeroed
+ * workers or missing cards, so main checks IsValid() before anything else and exits.
+ */
+class WPCatalog
+{
+public:
+	static const WPCatalog& Get();
+
+	bool IsValid() const { return mIsValid; } // Every worker type and deck 0 read, and no line skipped
+
+	const WPWorkerStats& GetWorkerStats(WorkerType workerType) const { return mWorkerStats[+workerType]; }
+	const WPCard& GetCard(int32_t cardIndex) const { return mCards[cardIndex]; }
+	const WPDeck& GetDeck(int32_t variationId) const; // Variation 0 if the variation isn't in the catalog
+
+	int32_t GetNumCards() const { return (int32_t)mCards.size(); }
+	int32_t GetNumDeckVariations() const { return (int32_t)mDecks.size(); }
+
+private:
+	WPCatalog(const char* const fileName);
+
+	void ReadWorkerLine(const std::string& line);
+	void ReadCardLine(const std::string& line);
+	void ReadDeckLine(const std::string& line);
+	void PostProcessDecks();
+	void ReportError(const char* const message, const std::string& detail = ""); // Prints the message then the detail
+
+	int32_t FindCardIndex(const std::string& cardId) const;
+
+	std::array<WPWorkerStats, +WorkerType::Count> mWorkerStats = {};
+	std::vector<WPCard> mCards;
+	std::vector<std::string> mCardIds;
+	std::vector<WPDeck> mDecks; // Indexed by variation id
+	std::vector<bool> mDecksRead;
+	std::array<bool, +WorkerType::Count> mWorkersRead = {};
+	bool mIsValid = true;
+};
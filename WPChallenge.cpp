@@ -1,5 +1,7 @@
 #include "WPChallenge.h"
 
+#include <mutex>
+
 WPChallenge::WPChallenge(const RNG& rng, Stats* stats /*= nullptr*/)
 : mExecutionResources(rng)
 , mRng(rng)
@@ -9,18 +11,22 @@ WPChallenge::WPChallenge(const RNG& rng, Stats* stats /*= nullptr*/)
 
 ChallengeResult WPChallenge::Execute()
 {
-	ChallengeResult result;
-
 	mExecutionResources.RollNOfEachDie(1);
+	return EvaluateRolledDice();
+}
+
+ChallengeResult WPChallenge::EvaluateRolledDice() const
+{
+	ChallengeResult result;
 
 	/**
 	 * Figure out the best values we can use for all the possible rounds we can participate in
 	 */
 	const int32_t maxWins = std::min({ mExecutionResources.GetNumRemainingDice(), (int32_t)mWorkers.size() });
 
-	const std::vector<int32_t> bestDieRollIndexes = mExecutionResources.GetNBestDieRollIndexes(maxWins);
+	const DiceIndexList bestDieRollIndexes = mExecutionResources.GetNBestDieRollIndexes(maxWins);
 	std::vector<int32_t> bestDieRollValues;
-	for (int32_t dieIndex = 0; dieIndex < maxWins; ++dieIndex)
+	for (int32_t dieIndex : bestDieRollIndexes)
 	{
 		bestDieRollValues.push_back(mExecutionResources.GetDieRoll(dieIndex).mValue);
 	}
@@ -92,7 +98,7 @@ ChallengeResult WPChallenge::Execute()
 				if (totalValue >= mChallengeDifficulty)
 				{
 					bestWorkerSkill.erase(workerIt);
-					bestCardLevels.erase(std::prev(cardIt), std::prev(bestCardLevels.end()));
+					bestCardLevels.erase(std::prev(cardIt), bestCardLevels.end());
 					result.mWins++;
 					goto endcardedworkerloop;
 				}
@@ -105,6 +111,67 @@ ChallengeResult WPChallenge::Execute()
 	return result;
 }
 
+const ChallengeWinDistribution& WPChallenge::GetExactWinDistribution()
+{
+	// Challenges with the same difficulty, worker skills and card levels always have the same distribution
+	static std::mutex sCacheMutex;
+	static std::map<std::vector<int32_t>, ChallengeWinDistribution> sCache;
+
+	std::vector<int32_t> cacheKey = { mChallengeDifficulty };
+	for (const WPWorker& worker : mWorkers)
+	{
+		cacheKey.push_back(worker.GetWorkerSkill());
+	}
+	cacheKey.push_back(-1);
+	for (int32_t cardLevel : mExecutionResources.GetNHighestCardLevels(mExecutionResources.GetNumAllCards()))
+	{
+		cacheKey.push_back(cardLevel);
+	}
+
+	std::lock_guard<std::mutex> lock(sCacheMutex);
+	auto iter = sCache.find(cacheKey);
+	if (iter != sCache.end())
+	{
+		return (*iter).second;
+	}
+
+	// Every face of every die, each equally likely. Only 6^4 rolls, so evaluating each directly is cheaper than handing them to threads
+	ChallengeWinDistribution distribution;
+	std::array<DiceFace, +DiceType::CountCombatSetupDice> faces = {};
+	const double rollProbability = 1.0 / std::pow((double)+DiceFace::Count, (double)faces.size());
+	bool bHasMoreRolls = true;
+	while (bHasMoreRolls)
+	{
+		mExecutionResources.SetFixedRollFaces(faces);
+		mExecutionResources.RollNOfEachDie(1);
+		distribution.mProbabilities[EvaluateRolledDice().mWins] += rollProbability;
+
+		bHasMoreRolls = false;
+		for (DiceFace& face : faces)
+		{
+			if (++face < DiceFace::Count)
+			{
+				bHasMoreRolls = true;
+				break;
+			}
+			face = DiceFace::Worst;
+		}
+	}
+	mExecutionResources.SetFixedRollFaces({});
+
+	return (*sCache.emplace(std::move(cacheKey), distribution).first).second;
+}
+
+double ChallengeWinDistribution::GetExpectedWins() const
+{
+	double expectedWins = 0.0;
+	for (size_t wins = 0; wins < mProbabilities.size(); ++wins)
+	{
+		expectedWins += (double)wins * mProbabilities[wins];
+	}
+	return expectedWins;
+}
+
 void WPChallenge::SetupChallengeToRoundDefaults(int32_t roundNumber)
 {
 	mChallengeDifficulty = 6 + ((roundNumber - 1) / 2);
@@ -12,12 +12,20 @@ struct ChallengeResult
 	int32_t mWinningFlee = 0;
 };
 
+struct ChallengeWinDistribution
+{
+	std::array<double, DicePool::cCapacity + 1> mProbabilities = {}; // Indexed by number of wins
+
+	double GetExpectedWins() const;
+};
+
 class WPChallenge
 {
 public:
 	WPChallenge(const RNG& rng, Stats* stats = nullptr);
 
 	ChallengeResult Execute();
+	const ChallengeWinDistribution& GetExactWinDistribution(); // Every possible roll, weighted by its chance, instead of sampling Execute
 
 	void SetupChallengeToRoundDefaults(int32_t roundNumber);
 	void ResetWorkers(int32_t numWorkers);
@@ -26,6 +34,8 @@ public:
 	WPExecutionResources& GetExecutionResources() { return mExecutionResources; }
 
 private:
+	ChallengeResult EvaluateRolledDice() const;
+
 	WPExecutionResources mExecutionResources;
 	const RNG& mRng;
 	Stats* mStats = nullptr;
@@ -0,0 +1,232 @@
+#include "WPComparison.h"
+
+#include "RNG.h"
+#include "WPDice.h"
+
+namespace
+{
+	constexpr int32_t cNumQualityBuckets = 4;
+	constexpr int32_t cNumStrata = cNumQualityBuckets * cNumQualityBuckets; // Attacker bucket by defender bucket
+	constexpr int32_t cMaxSadnessScore = 64;
+
+	/**
+	 * Sadness score buckets of roughly equal probability, from every opening of one side
+	 */
+	struct QualityBuckets
+	{
+		std::array<int32_t, cMaxSadnessScore> mBucketOfScore = {};
+		std::array<double, cNumQualityBuckets> mProbabilities = {};
+	};
+
+	DicePool MakeOpeningDice(const WPOpeningFaces& faces)
+	{
+		DicePool openingDice;
+		for (int32_t i = 0; i < cNumOpeningDice; ++i)
+		{
+			openingDice.Add(WPExecutionResources::MakeDieRoll((DiceType)(i / 2), faces[i]));
+		}
+		return openingDice;
+	}
+
+	QualityBuckets MakeQualityBuckets()
+	{
+		std::array<double, cMaxSadnessScore> scoreProbabilities = {};
+		const double openingProbability = 1.0 / std::pow((double)+DiceFace::Count, (double)cNumOpeningDice);
+
+		WPOpeningFaces faces = {};
+		bool bHasMoreOpenings = true;
+		while (bHasMoreOpenings)
+		{
+			const int32_t score = WPScenario::GetOpeningQuality(MakeOpeningDice(faces)).mSadnessScore;
+			scoreProbabilities[std::clamp(score, 0, cMaxSadnessScore - 1)] += openingProbability;
+
+			bHasMoreOpenings = false;
+			for (DiceFace& face : faces)
+			{
+				if (++face < DiceFace::Count)
+				{
+					bHasMoreOpenings = true;
+					break;
+				}
+				face = DiceFace::Worst;
+			}
+		}
+
+		// Move to the next bucket once this one has its share
+		QualityBuckets buckets;
+		double cumulative = 0.0;
+		for (int32_t score = 0; score < cMaxSadnessScore; ++score)
+		{
+			const int32_t bucket = std::min((int32_t)(cumulative * cNumQualityBuckets), cNumQualityBuckets - 1);
+			buckets.mBucketOfScore[score] = bucket;
+			buckets.mProbabilities[bucket] += scoreProbabilities[score];
+			cumulative += scoreProbabilities[score];
+		}
+		return buckets;
+	}
+
+	const QualityBuckets& GetQualityBuckets()
+	{
+		static const QualityBuckets sBuckets = MakeQualityBuckets();
+		return sBuckets;
+	}
+
+	int32_t GetQualityBucket(const WPOpeningFaces& faces)
+	{
+		const int32_t score = WPScenario::GetOpeningQuality(MakeOpeningDice(faces)).mSadnessScore;
+		return GetQualityBuckets().mBucketOfScore[std::clamp(score, 0, cMaxSadnessScore - 1)];
+	}
+
+	WPOpeningFaces FlipFaces(const WPOpeningFaces& faces)
+	{
+		WPOpeningFaces flippedFaces;
+		for (int32_t i = 0; i < cNumOpeningDice; ++i)
+		{
+			flippedFaces[i] = (DiceFace)(+DiceFace::Best - +faces[i]);
+		}
+		return flippedFaces;
+	}
+
+	struct StratumSums
+	{
+		uint64_t mCount = 0;
+		double mSumA = 0.0;
+		double mSumB = 0.0;
+		double mSumDifference = 0.0;
+		double mSumDifferenceSquared = 0.0;
+	};
+}
+
+void WPMatchup::Apply(WPScenario& scenario) const
+{
+	WPWorker& attacker = scenario.GetAttacker();
+	attacker.SetWorkerType(mAttackerType);
+	attacker.SetArbitraryCardVariation(mAttackerCardVariation);
+	attacker.SetDiceStrategy(mAttackerDiceStrategy);
+	attacker.SetCardStrategy(mAttackerCardStrategy);
+
+	WPWorker& defender = scenario.GetDefender();
+	defender.SetWorkerType(mDefenderType);
+	defender.SetArbitraryCardVariation(mDefenderCardVariation);
+	defender.SetDiceStrategy(mDefenderDiceStrategy);
+	defender.SetCardStrategy(mDefenderCardStrategy);
+}
+
+double WPComparisonResult::GetVarianceReduction() const
+{
+	return (mHalfWidth > 0.0) ? ((mIndependentHalfWidth * mIndependentHalfWidth) / (mHalfWidth * mHalfWidth)) : 0.0;
+}
+
+/*static*/ WPComparisonResult WPComparison::Run(const WPMatchup& matchupA, const WPMatchup& matchupB, const WPComparisonConfig& config, uint32_t seed)
+{
+	const RNG samplingRng(seed);
+	RNG rngA;
+	RNG rngB;
+	WPScenario scenarioA(rngA);
+	WPScenario scenarioB(rngB);
+	matchupA.Apply(scenarioA);
+	matchupB.Apply(scenarioB);
+
+	const int32_t numVariants = config.mAntitheticDice ? 2 : 1;
+	// Without common random numbers B fights a different opening, so A's opening says nothing about B's stratum
+	const bool bStratifyOpenings = config.mStratifyOpenings && config.mCommonRandomNumbers;
+	std::array<StratumSums, cNumStrata> strata = {};
+	for (uint64_t sample = 0; sample < config.mNumSamples; ++sample)
+	{
+		const WPOpeningFaces attackerFacesA = WPDice::RandomOpeningFaces(samplingRng);
+		const WPOpeningFaces defenderFacesA = WPDice::RandomOpeningFaces(samplingRng);
+		const uint32_t fightSeedA = samplingRng.RandomNumber();
+
+		WPOpeningFaces attackerFacesB = attackerFacesA;
+		WPOpeningFaces defenderFacesB = defenderFacesA;
+		uint32_t fightSeedB = fightSeedA;
+		if (!config.mCommonRandomNumbers)
+		{
+			attackerFacesB = WPDice::RandomOpeningFaces(samplingRng);
+			defenderFacesB = WPDice::RandomOpeningFaces(samplingRng);
+			fightSeedB = samplingRng.RandomNumber();
+		}
+
+		double winsA = 0.0;
+		double winsB = 0.0;
+		for (int32_t variant = 0; variant < numVariants; ++variant)
+		{
+			const bool bFlipped = (variant == 1);
+
+			scenarioA.GetAttackerResources().SetFixedRollFaces(bFlipped ? FlipFaces(attackerFacesA) : attackerFacesA);
+			scenarioA.GetDefenderResources().SetFixedRollFaces(bFlipped ? FlipFaces(defenderFacesA) : defenderFacesA);
+			rngA.Seed(fightSeedA);
+			winsA += (scenarioA.Execute() == ScenarioResult::AttackerWin) ? 1.0 : 0.0;
+
+			scenarioB.GetAttackerResources().SetFixedRollFaces(bFlipped ? FlipFaces(attackerFacesB) : attackerFacesB);
+			scenarioB.GetDefenderResources().SetFixedRollFaces(bFlipped ? FlipFaces(defenderFacesB) : defenderFacesB);
+			rngB.Seed(fightSeedB);
+			winsB += (scenarioB.Execute() == ScenarioResult::AttackerWin) ? 1.0 : 0.0;
+		}
+		winsA /= (double)numVariants;
+		winsB /= (double)numVariants;
+
+		// Grouped by A's unflipped opening. The flipped opening comes along with it, so its weight is still the unflipped opening's
+		const int32_t stratum = bStratifyOpenings ? ((GetQualityBucket(attackerFacesA) * cNumQualityBuckets) + GetQualityBucket(defenderFacesA)) : 0;
+		StratumSums& sums = strata[stratum];
+		sums.mCount++;
+		sums.mSumA += winsA;
+		sums.mSumB += winsB;
+		sums.mSumDifference += winsA - winsB;
+		sums.mSumDifferenceSquared += (winsA - winsB) * (winsA - winsB);
+	}
+
+	scenarioA.GetAttackerResources().SetFixedRollFaces({});
+	scenarioA.GetDefenderResources().SetFixedRollFaces({});
+	scenarioB.GetAttackerResources().SetFixedRollFaces({});
+	scenarioB.GetDefenderResources().SetFixedRollFaces({});
+
+	// Strata that were never sampled drop out and the rest are renormalized
+	std::array<double, cNumStrata> weights = {};
+	double totalWeight = 0.0;
+	for (int32_t stratum = 0; stratum < cNumStrata; ++stratum)
+	{
+		if (strata[stratum].mCount > 0)
+		{
+			const QualityBuckets& buckets = GetQualityBuckets();
+			weights[stratum] = bStratifyOpenings
+				? (buckets.mProbabilities[stratum / cNumQualityBuckets] * buckets.mProbabilities[stratum % cNumQualityBuckets])
+				: 1.0;
+			totalWeight += weights[stratum];
+		}
+	}
+
+	WPComparisonResult result;
+	result.mNumFights = config.mNumSamples * numVariants;
+
+	double differenceVariance = 0.0;
+	for (int32_t stratum = 0; stratum < cNumStrata; ++stratum)
+	{
+		const StratumSums& sums = strata[stratum];
+		if (sums.mCount == 0)
+		{
+			continue;
+		}
+
+		const double weight = weights[stratum] / totalWeight;
+		const double count = (double)sums.mCount;
+		const double meanDifference = sums.mSumDifference / count;
+		result.mRateA += weight * (sums.mSumA / count);
+		result.mRateB += weight * (sums.mSumB / count);
+		result.mDifference += weight * meanDifference;
+
+		if (sums.mCount > 1)
+		{
+			const double sampleVariance = std::max(0.0, (sums.mSumDifferenceSquared - (count * meanDifference * meanDifference)) / (count - 1.0));
+			differenceVariance += weight * weight * sampleVariance / count;
+		}
+	}
+	result.mHalfWidth = 1.96 * std::sqrt(differenceVariance);
+
+	if (result.mNumFights > 0)
+	{
+		const double independentVariance = (result.mRateA * (1.0 - result.mRateA) + result.mRateB * (1.0 - result.mRateB)) / (double)result.mNumFights;
+		result.mIndependentHalfWidth = 1.96 * std::sqrt(independentVariance);
+	}
+	return result;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include "WPScenario.h"
+
+/**
+ * Everything that sets up one side of a comparison
+ */
+struct WPMatchup
+{
+	WorkerType mAttackerType = WorkerType::Basic;
+	WorkerType mDefenderType = WorkerType::Basic;
+	int32_t mAttackerCardVariation = 0;
+	int32_t mDefenderCardVariation = 0;
+	std::vector<DicePlayStrategy> mAttackerDiceStrategy = WPWorker::MakeDefaultDiceStrategy();
+	std::vector<DicePlayStrategy> mDefenderDiceStrategy = WPWorker::MakeDefaultDiceStrategy();
+	std::vector<CardPlayStrategy> mAttackerCardStrategy = WPWorker::MakeDefaultCardStrategy();
+	std::vector<CardPlayStrategy> mDefenderCardStrategy = WPWorker::MakeDefaultCardStrategy();
+
+	void Apply(WPScenario& scenario) const;
+};
+
+struct WPComparisonConfig
+{
+	uint64_t mNumSamples = 10000; // Openings. Each is fought once per matchup, twice with mAntitheticDice
+	bool mCommonRandomNumbers = true; // Both matchups fight from the same opening with the same draws after it
+	bool mAntitheticDice = true; // Each opening is also fought with every face flipped (Worst <-> Best)
+	bool mStratifyOpenings = true; // Weight results by the exact odds of each opening quality bucket. Needs mCommonRandomNumbers
+};
+
+struct WPComparisonResult
+{
+	double mRateA = 0.0; // Attacker win rates
+	double mRateB = 0.0;
+	double mDifference = 0.0; // A - B
+	double mHalfWidth = 0.0; // 95% on the difference
+	double mIndependentHalfWidth = 0.0; // 95% on the difference had the same number of fights been sampled independently
+	uint64_t mNumFights = 0; // Per matchup
+
+	/**
+	 * How many times more independent fights would be needed for the same half width
+	 */
+	double GetVarianceReduction() const;
+};
+
+/**
+ * Estimates the difference in attacker win rate between two matchups.
+ *
+ * Plain sampling needs the noise of both matchups to shrink below the difference between them. Instead, with
+ * common random numbers both matchups fight from the same opening roll with the same RNG seed, so their results are
+ * strongly correlated and most of the noise cancels in the difference. Antithetic dice pair every opening with its
+ * flipped opening to cancel luck in the dice. Openings are grouped by the sadness score of each side
+ * (see WPScenario::GetOpeningQuality), and each group is weighted by its exact probability instead of how often it
+ * happened to be sampled.
+ */
+class WPComparison
+{
+public:
+	static WPComparisonResult Run(const WPMatchup& matchupA, const WPMatchup& matchupB, const WPComparisonConfig& config, uint32_t seed);
+};
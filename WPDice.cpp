@@ -0,0 +1,12 @@
+#include "WPDice.h"
+#include "RNG.h"
+
+WPOpeningFaces WPDice::RandomOpeningFaces(const RNG& rng)
+{
+	WPOpeningFaces faces;
+	for (DiceFace& face : faces)
+	{
+		face = (DiceFace)rng.RandomIndex(+DiceFace::Count);
+	}
+	return faces;
+}
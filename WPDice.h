@@ -0,0 +1,13 @@
+#pragma once
+#include "WPExecutionResources.h"
+
+constexpr int32_t cNumOpeningDice = 2 * +DiceType::CountCombatSetupDice; // WPWorker::PrepForCombat rolls 2 of each setup die
+using WPOpeningFaces = std::array<DiceFace, cNumOpeningDice>;
+
+/**
+ * Openings rolled outside of a fight, to be handed to WPExecutionResources::SetFixedRollFaces
+ */
+namespace WPDice
+{
+	WPOpeningFaces RandomOpeningFaces(const RNG& rng); // In the order WPExecutionResources::RollNOfEachDie adds them
+}
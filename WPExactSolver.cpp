@@ -0,0 +1,144 @@
+#include "WPExactSolver.h"
+
+WPExactSolver::WPExactSolver()
+: mRng(0)
+, mScenario(mRng)
+{
+	mScenario.SetRoundStartCallback([this]() { return OnRoundStart(); });
+}
+
+WPOutcomeDistribution WPExactSolver::SolveOpening(const WPOpeningFaces& attackerFaces, const WPOpeningFaces& defenderFaces)
+{
+	WPOutcomeDistribution distribution;
+
+	if (mSolvedStates.size() > cMaxSolvedStates)
+	{
+		mSolvedStates.clear();
+	}
+
+	mScenario.GetAttackerResources().SetFixedRollFaces(attackerFaces);
+	mScenario.GetDefenderResources().SetFixedRollFaces(defenderFaces);
+	mRng.SetChoiceScript(&mChoiceScript);
+	mChoiceScript.Clear();
+	mOpenStates.clear();
+	do
+	{
+		mChoiceScript.Restart();
+		mNumOpenStatesReached = 0;
+		mReachedSolvedState = nullptr;
+
+		const ScenarioResult result = mScenario.Execute();
+		const double pathProbability = mChoiceScript.GetProbability();
+		if (result == ScenarioResult::Count)
+		{
+			AddOutcomes(*mReachedSolvedState, pathProbability, distribution);
+		}
+		else
+		{
+			WPOutcomeProbabilities outcome = {};
+			outcome[+result] = 1.0;
+			AddOutcomes(outcome, pathProbability, distribution);
+		}
+		distribution.mNumRuns++;
+
+		const bool bHasMoreSequences = mChoiceScript.Advance();
+		CloseStates(bHasMoreSequences ? mChoiceScript.GetNumChoices() : 0);
+		if (!bHasMoreSequences)
+		{
+			break;
+		}
+	} while (true);
+	mRng.SetChoiceScript(nullptr);
+	mScenario.GetAttackerResources().SetFixedRollFaces({});
+	mScenario.GetDefenderResources().SetFixedRollFaces({});
+
+	return distribution;
+}
+
+WPOutcomeDistribution WPExactSolver::SolveSampledOpenings(uint64_t numOpenings, uint32_t seed)
+{
+	const RNG openingRng(seed);
+
+	WPOutcomeDistribution distribution;
+	WPOutcomeProbabilities sumOfSquares = {};
+	for (uint64_t opening = 0; opening < numOpenings; ++opening)
+	{
+		const WPOpeningFaces attackerFaces = WPDice::RandomOpeningFaces(openingRng);
+		const WPOpeningFaces defenderFaces = WPDice::RandomOpeningFaces(openingRng);
+		const WPOutcomeDistribution openingDistribution = SolveOpening(attackerFaces, defenderFaces);
+		for (int32_t result = 0; result < +ScenarioResult::Count; ++result)
+		{
+			distribution.mProbabilities[result] += openingDistribution.mProbabilities[result];
+			sumOfSquares[result] += openingDistribution.mProbabilities[result] * openingDistribution.mProbabilities[result];
+		}
+		distribution.mNumRuns += openingDistribution.mNumRuns;
+	}
+
+	if (numOpenings > 0)
+	{
+		for (int32_t result = 0; result < +ScenarioResult::Count; ++result)
+		{
+			const double mean = distribution.mProbabilities[result] / (double)numOpenings;
+			const double variance = std::max(0.0, (sumOfSquares[result] / (double)numOpenings) - (mean * mean));
+			distribution.mProbabilities[result] = mean;
+			distribution.mHalfWidths[result] = 1.96 * std::sqrt(variance / (double)numOpenings);
+		}
+	}
+	return distribution;
+}
+
+bool WPExactSolver::OnRoundStart()
+{
+	// Replays pass through the open states again on the way to the part of the tree not yet visited
+	if (mNumOpenStatesReached < mOpenStates.size())
+	{
+		++mNumOpenStatesReached;
+		return false;
+	}
+
+	mStateKey.clear();
+	mScenario.GetAttacker().AppendStateKey(mStateKey);
+	mScenario.GetDefender().AppendStateKey(mStateKey);
+
+	auto iter = mSolvedStates.find(mStateKey);
+	if (iter != mSolvedStates.end())
+	{
+		mReachedSolvedState = &(*iter).second;
+		return true;
+	}
+
+	OpenState& openState = mOpenStates.emplace_back();
+	openState.mKey = mStateKey;
+	openState.mNumChoicesTaken = mChoiceScript.GetNumChoicesTaken();
+	openState.mProbability = mChoiceScript.GetProbability();
+	++mNumOpenStatesReached;
+	return false;
+}
+
+void WPExactSolver::AddOutcomes(const WPOutcomeProbabilities& probabilities, double pathProbability, WPOutcomeDistribution& inOutDistribution)
+{
+	for (int32_t result = 0; result < +ScenarioResult::Count; ++result)
+	{
+		inOutDistribution.mProbabilities[result] += probabilities[result] * pathProbability;
+	}
+
+	for (OpenState& openState : mOpenStates)
+	{
+		const double conditionalProbability = pathProbability / openState.mProbability;
+		for (int32_t result = 0; result < +ScenarioResult::Count; ++result)
+		{
+			openState.mProbabilities[result] += probabilities[result] * conditionalProbability;
+		}
+	}
+}
+
+void WPExactSolver::CloseStates(size_t numChoicesKept)
+{
+	// A state's subtree is done once the script no longer keeps every choice made before reaching it
+	while (!mOpenStates.empty() && (mOpenStates.back().mNumChoicesTaken >= numChoicesKept))
+	{
+		OpenState& openState = mOpenStates.back();
+		mSolvedStates.emplace(std::move(openState.mKey), openState.mProbabilities);
+		mOpenStates.pop_back();
+	}
+}
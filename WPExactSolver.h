@@ -0,0 +1,67 @@
+#pragma once
+#include <unordered_map>
+#include "RNG.h"
+#include "WPDice.h"
+#include "WPScenario.h"
+
+using WPOutcomeProbabilities = std::array<double, +ScenarioResult::Count>;
+
+struct WPOutcomeDistribution
+{
+	WPOutcomeProbabilities mProbabilities = {};
+	WPOutcomeProbabilities mHalfWidths = {}; // 95%, only non zero when openings were sampled
+	uint64_t mNumRuns = 0; // Partial fights replayed to visit every draw sequence
+
+	double GetProbability(ScenarioResult result) const { return mProbabilities[+result]; }
+};
+
+/**
+ * Outcome probabilities of a fight computed by visiting every sequence of draws instead of sampling fights.
+ * Every draw goes through RNG::RandomIndex, so the fight is replayed with an RNGChoiceScript until every card draw,
+ * reroll and tie break has been taken, each path weighted by the chance of its draws.
+ *
+ * Paths that reach the same state at the start of a round share the rest of the fight, so each state's outcome
+ * probabilities are memoized once its subtree is done and later paths stop there.
+ *
+ * The opening roll is 16 dice, so the full tree has 6^16 openings before any other draw. That's too many to visit,
+ * so the opening roll is either given or sampled, and everything after it is exact.
+ * Configure the workers through GetScenario(), then ClearSolvedStates() if they change between solves.
+ */
+class WPExactSolver
+{
+public:
+	WPExactSolver();
+
+	WPScenario& GetScenario() { return mScenario; }
+
+	WPOutcomeDistribution SolveOpening(const WPOpeningFaces& attackerFaces, const WPOpeningFaces& defenderFaces);
+	WPOutcomeDistribution SolveSampledOpenings(uint64_t numOpenings, uint32_t seed); // Averages SolveOpening over random openings
+
+	void ClearSolvedStates() { mSolvedStates.clear(); }
+	size_t GetNumSolvedStates() const { return mSolvedStates.size(); }
+
+private:
+	struct OpenState
+	{
+		std::string mKey;
+		size_t mNumChoicesTaken = 0;
+		double mProbability = 0.0; // Of reaching this state
+		WPOutcomeProbabilities mProbabilities = {}; // From this state on
+	};
+
+	bool OnRoundStart();
+	void AddOutcomes(const WPOutcomeProbabilities& probabilities, double pathProbability, WPOutcomeDistribution& inOutDistribution);
+	void CloseStates(size_t numChoicesKept);
+
+	static constexpr size_t cMaxSolvedStates = 1 << 20;
+
+	RNG mRng;
+	RNGChoiceScript mChoiceScript;
+	WPScenario mScenario;
+
+	std::vector<OpenState> mOpenStates; // States whose subtree is still being visited, shallowest first
+	size_t mNumOpenStatesReached = 0; // This run
+	const WPOutcomeProbabilities* mReachedSolvedState = nullptr; // This run
+	std::string mStateKey;
+	std::unordered_map<std::string, WPOutcomeProbabilities> mSolvedStates;
+};
@@ -1,5 +1,50 @@
 #include "WPExecutionResources.h"
 #include "RNG.h"
+#include "WPCatalog.h"
+
+namespace
+{
+	using DiceRankKeys = std::array<int32_t, DicePool::cCapacity>;
+
+	/**
+	 * Optimal 19 comparator network for 8 inputs, highest first.
+	 * Fixed compare order with no data dependent branching, so each comparator is a min/max pair.
+	 */
+	void SortDescending(DiceRankKeys& keys)
+	{
+		static constexpr uint8_t cNetwork[19][2] =
+		{
+			{0,2}, {1,3}, {4,6}, {5,7},
+			{0,4}, {1,5}, {2,6}, {3,7},
+			{0,1}, {2,3}, {4,5}, {6,7},
+			{2,4}, {3,5},
+			{1,4}, {3,6},
+			{1,2}, {3,4}, {5,6}
+		};
+
+		for (const auto& comparator : cNetwork)
+		{
+			const int32_t a = keys[comparator[0]];
+			const int32_t b = keys[comparator[1]];
+			keys[comparator[0]] = std::max(a, b);
+			keys[comparator[1]] = std::min(a, b);
+		}
+	}
+
+	/**
+	 * Rank goes in the high bits and (7 - index) in the low bits, so equal ranks keep the lowest index first
+	 * and the index can be recovered after sorting.
+	 */
+	int32_t MakeDiceRankKey(int32_t rank, int32_t index)
+	{
+		return (rank * 16) + ((DicePool::cCapacity - 1) - index);
+	}
+
+	int8_t GetIndexFromDiceRankKey(int32_t key)
+	{
+		return (int8_t)((DicePool::cCapacity - 1) - (key & 0xF));
+	}
+}
 
 /**
  * Dice
@@ -7,18 +52,39 @@
 
 void DieRoll::Print() const
 {
+	const MathPrint::PrintColor diceColor = GetColor();
 	MathPrint::PrintResetCC();
-	MathPrint::PrintFGColorCode(mDiceColor);
+	MathPrint::PrintFGColorCode(diceColor);
 	MathPrint::PrintCharacter(MathPrint::Character::BlockRight);
 	MathPrint::PrintResetCC();
-	MathPrint::PrintBGColorCode(mDiceColor);
+	MathPrint::PrintBGColorCode(diceColor);
 	printf("%d", mValue);
 	MathPrint::PrintResetCC();
-	MathPrint::PrintFGColorCode(mDiceColor);
+	MathPrint::PrintFGColorCode(diceColor);
 	MathPrint::PrintCharacter(MathPrint::Character::BlockLeft);
 	MathPrint::PrintResetCC();
 }
 
+MathPrint::PrintColor DieRoll::GetColor() const
+{
+	static constexpr MathPrint::PrintColor sDieColor[+DiceType::Count] =
+	{
+		MathPrint::PrintColor::DarkRed, // Heavy
+		MathPrint::PrintColor::Brown,	// Swing
+		MathPrint::PrintColor::Purple,	// Bonus
+		MathPrint::PrintColor::Blue,	// Card
+
+		// RandomEffect
+		MathPrint::PrintColor::Orange
+	};
+
+	if (mDiceFace == DiceFace::Count)
+	{
+		return MathPrint::PrintColor::Red;
+	}
+	return sDieColor[+mDiceType];
+}
+
 int32_t DieRoll::GetSimplePredictedValue() const
 {
 	return mValue + (mDiceEffect == DiceEffect::PlayCard ? 1 : 0);
@@ -26,6 +92,52 @@ int32_t DieRoll::GetSimplePredictedValue() const
 
 const DieRoll DieRoll::kInvalidDie;
 
+void DicePool::Clear()
+{
+	mCount = 0;
+	mTotalValue = 0;
+	mBestPossibleTotal = 0;
+	mWorstPossibleTotal = 0;
+	mEffectCounts = {};
+}
+
+void DicePool::Add(const DieRoll& dieRoll)
+{
+	if (mCount < cCapacity)
+	{
+		mDice[mCount++] = dieRoll;
+		Track(dieRoll, 1);
+	}
+}
+
+void DicePool::Set(int32_t index, const DieRoll& dieRoll)
+{
+	Track(mDice[index], -1);
+	mDice[index] = dieRoll;
+	Track(dieRoll, 1);
+}
+
+void DicePool::SwapRemove(int32_t index)
+{
+	Track(mDice[index], -1);
+	mDice[index] = mDice[--mCount];
+}
+
+void DicePool::Track(const DieRoll& dieRoll, int32_t direction)
+{
+	const DieFaces& dieFaces = cDieFaces[+dieRoll.mDiceType];
+	mTotalValue += direction * dieRoll.mValue;
+	mBestPossibleTotal += direction * dieFaces[+DiceFace::Best].mValue;
+	mWorstPossibleTotal += direction * dieFaces[+DiceFace::Worst].mValue;
+	mEffectCounts[+dieRoll.mDiceEffect] += direction;
+}
+
+WPExecutionResources::WPExecutionResources(const RNG& rng)
+: mRng(rng)
+, mDeck(&WPCatalog::Get().GetDeck(0))
+{
+}
+
 DiceFace WPExecutionResources::RandomDieFace() const
 {
 	return (DiceFace)mRng.RandomIndex(+DiceFace::Count);
@@ -33,146 +145,155 @@ DiceFace WPExecutionResources::RandomDieFace() const
 
 void WPExecutionResources::RollNOfEachDie(int32_t numOfEach)
 {
-	mRemainingDice.clear();
+	mRemainingDice.Clear();
 	for (DiceType diceType = DiceType::Heavy; diceType < DiceType::CountCombatSetupDice; ++diceType)
 	{
 		for (int32_t dieCount = 0; dieCount < numOfEach; ++dieCount)
 		{
-			mRemainingDice.push_back(MakeDieRoll(diceType, RandomDieFace()));
+			const int32_t dieIndex = mRemainingDice.GetCount();
+			mRemainingDice.Add(MakeDieRoll(diceType, (dieIndex < mNumFixedRollFaces) ? mFixedRollFaces[dieIndex] : RandomDieFace()));
 		}
 	}
+	RebuildDiceRankings();
+}
+
+void WPExecutionResources::SetFixedRollFaces(std::span<const DiceFace> faces)
+{
+	mNumFixedRollFaces = (int32_t)std::min(faces.size(), mFixedRollFaces.size());
+	std::copy_n(faces.begin(), mNumFixedRollFaces, mFixedRollFaces.begin());
 }
 
 void WPExecutionResources::RerollDie(int32_t index)
 {
-	mRemainingDice[index] = MakeDieRoll(mRemainingDice[index].mDiceType, RandomDieFace());
+	mRemainingDice.Set(index, MakeDieRoll(mRemainingDice[index].mDiceType, RandomDieFace()));
+	RebuildDiceRankings();
 }
 
 void WPExecutionResources::ReplaceDie(int32_t index, DiceType diceType)
 {
-	mRemainingDice[index] = MakeDieRoll(diceType, RandomDieFace());
+	mRemainingDice.Set(index, MakeDieRoll(diceType, RandomDieFace()));
+	RebuildDiceRankings();
 }
 
-void WPExecutionResources::RemoveDice(std::vector<int32_t> indexes)
+void WPExecutionResources::RemoveDice(int32_t indexA, int32_t indexB)
 {
-	std::vector<DieRoll> swappedInRolls;
-	for (int32_t i = 0; i < mRemainingDice.size(); ++i)
+	// Remove the higher index first so the swap can't move the die at the lower index
+	mRemainingDice.SwapRemove(std::max(indexA, indexB));
+	if (indexA != indexB)
 	{
-		if (std::find(indexes.begin(), indexes.end(), i) == indexes.end())
-		{
-			swappedInRolls.push_back(mRemainingDice[i]);
-		}
+		mRemainingDice.SwapRemove(std::min(indexA, indexB));
 	}
-	std::swap(mRemainingDice, swappedInRolls);
+	RebuildDiceRankings();
 }
 
 const DieRoll& WPExecutionResources::GetDieRoll(int32_t index) const
 {
-	if (index < (int32_t)mRemainingDice.size())
+	if ((index >= 0) && (index < mRemainingDice.GetCount()))
 	{
-		return mRemainingDice.at(index);
+		return mRemainingDice[index];
 	}
 	return DieRoll::kInvalidDie;
 }
 
-/*static*/ DieRoll WPExecutionResources::MakeDieRoll(DiceType diceType, DiceFace face)
+void WPExecutionResources::RebuildDiceRankings()
 {
-	//static const std::vector<int32_t> sSides[+DiceType::Count] =
-	//{
-	//	{3,3,4,4,4,9},
-	//	{1,2,2,7,7,8},
-	//	{0,5,5,5,6,6},
-	//	{1,1,1,2,2,3}
-	//};
-	static const std::vector<int32_t> sSides[+DiceType::Count] =
+	DiceRankKeys bestKeys;
+	DiceRankKeys worstKeys;
+	DiceRankKeys missingPotentialKeys;
+	for (int32_t i = 0; i < DicePool::cCapacity; ++i)
 	{
-		{6,7,7,8,8,9}, // Heavy
-		{1,2,3,4,5,6}, // Swing
-		{3,3,4,4,5,6}, // Bonus
-		{0,1,1,2,2,2}, // Card
+		if (i < mRemainingDice.GetCount())
+		{
+			const DieRoll& dieRoll = mRemainingDice[i];
+			const int32_t predictedValue = dieRoll.GetSimplePredictedValue();
+			bestKeys[i] = MakeDiceRankKey(predictedValue, i);
+			worstKeys[i] = MakeDiceRankKey(-predictedValue, i);
+			missingPotentialKeys[i] = MakeDiceRankKey(dieRoll.mMissingPotential, i);
+		}
+		else
+		{
+			// Empty slots sort to the back
+			bestKeys[i] = INT_MIN;
+			worstKeys[i] = INT_MIN;
+			missingPotentialKeys[i] = INT_MIN;
+		}
+	}
 
-		// RandomEffect
-		{2,2,6,6,9,9}
-	};
-	static const std::vector<DiceEffect> sEffects[+DiceType::Count] =
-	{
-		MakeDiceEffectList(DiceEffect::None),		 // Heavy
-		MakeDiceEffectList(DiceEffect::None),		 // Swing
-		MakeDiceEffectList(DiceEffect::ResultBonus), // Bonus
-		MakeDiceEffectList(DiceEffect::PlayCard),    // Card
+	SortDescending(bestKeys);
+	SortDescending(worstKeys);
+	SortDescending(missingPotentialKeys);
 
-		// RandomEffect
-		{DiceEffect::PlayCard, DiceEffect::PlayCard, DiceEffect::ResultBonus, DiceEffect::ResultBonus, DiceEffect::None, DiceEffect::None}
-	};
-	static const MathPrint::PrintColor sDieColor[+DiceType::Count] =
+	for (int32_t i = 0; i < mRemainingDice.GetCount(); ++i)
 	{
-		MathPrint::PrintColor::DarkRed, // Heavy
-		MathPrint::PrintColor::Brown,	// Swing
-		MathPrint::PrintColor::Purple,	// Bonus
-		MathPrint::PrintColor::Blue,	// Card
-
-		// RandomEffect
-		MathPrint::PrintColor::Orange
-	};
+		mBestRanking[i] = GetIndexFromDiceRankKey(bestKeys[i]);
+		mWorstRanking[i] = GetIndexFromDiceRankKey(worstKeys[i]);
+		mMissingPotentialRanking[i] = GetIndexFromDiceRankKey(missingPotentialKeys[i]);
+	}
+}
 
-	const int32_t missingPotential = diceType < DiceType::CountCombatSetupDice ? (sSides[+diceType][5] - sSides[+diceType][+face]) : 0;
-	return DieRoll(diceType, sSides[+diceType][+face], sEffects[+diceType][+face], sDieColor[+diceType], missingPotential);
+DiceIndexList WPExecutionResources::GetNFromRanking(const DiceRanking& ranking, size_t n, int32_t skipIndex) const
+{
+	DiceIndexList result;
+	for (int32_t i = 0; (i < mRemainingDice.GetCount()) && ((size_t)result.GetCount() < n); ++i)
+	{
+		if (ranking[i] != skipIndex)
+		{
+			result.PushBack(ranking[i]);
+		}
+	}
+	return result;
 }
 
-/*static*/ std::vector<DiceEffect> WPExecutionResources::MakeDiceEffectList(DiceEffect diceEffect)
+int32_t WPExecutionResources::GetFirstFromRanking(const DiceRanking& ranking, int32_t skipIndex) const
 {
-	std::vector<DiceEffect> returnValue;
-	for (DiceFace face = DiceFace::Worst; face < DiceFace::Count; ++face)
+	// The skipped die can only be in one slot, so the answer is always in the first two
+	if (mRemainingDice.GetCount() > 0 && ranking[0] != skipIndex)
+	{
+		return ranking[0];
+	}
+	if (mRemainingDice.GetCount() > 1)
 	{
-		returnValue.push_back(diceEffect);
+		return ranking[1];
 	}
-	return returnValue;
+	return -1;
 }
 
-std::vector<int32_t> WPExecutionResources::GetPossibleDieRollIndexes(int32_t skipIndex /*= -1*/) const
+DiceIndexList WPExecutionResources::GetPossibleDieRollIndexes(int32_t skipIndex /*= -1*/) const
 {
-	std::vector<int32_t> result;
+	DiceIndexList result;
 	for (int32_t i = 0; i < GetNumRemainingDice(); ++i)
 	{
 		if (i != skipIndex)
 		{
-			result.push_back(i);
+			result.PushBack(i);
 		}
 	}
 	return result;
 }
 
-std::vector<int32_t> WPExecutionResources::GetNWorstDieRollIndexes(size_t n, int32_t skipIndex /*= -1*/) const
+DiceIndexList WPExecutionResources::GetNWorstDieRollIndexes(size_t n, int32_t skipIndex /*= -1*/) const
 {
-	std::vector<int32_t> result = GetPossibleDieRollIndexes(skipIndex);
-	std::sort(result.begin(), result.end(), [this](int32_t indexA, int32_t indexB) -> bool
-		{
-			return GetDieRoll(indexA).GetSimplePredictedValue() < GetDieRoll(indexB).GetSimplePredictedValue();
-		});
-	result.resize(std::min(n, result.size()));
-	return result;
+	return GetNFromRanking(mWorstRanking, n, skipIndex);
 }
 
-std::vector<int32_t> WPExecutionResources::GetNBestDieRollIndexes(size_t n, int32_t skipIndex /*= -1*/) const
+DiceIndexList WPExecutionResources::GetNBestDieRollIndexes(size_t n, int32_t skipIndex /*= -1*/) const
 {
-	std::vector<int32_t> result = GetPossibleDieRollIndexes(skipIndex);
-	std::sort(result.begin(), result.end(), [this](int32_t indexA, int32_t indexB) -> bool
-		{
-			return GetDieRoll(indexA).GetSimplePredictedValue() > GetDieRoll(indexB).GetSimplePredictedValue();
-		});
-	result.resize(std::min(n, result.size()));
-	return result;
+	return GetNFromRanking(mBestRanking, n, skipIndex);
 }
 
-std::vector<int32_t> WPExecutionResources::GetNHighestMissingPotentialDieRollIndexes(size_t n, int32_t skipIndex /*= -1*/) const
+DiceIndexList WPExecutionResources::GetNHighestMissingPotentialDieRollIndexes(size_t n, int32_t skipIndex /*= -1*/) const
 {
-	std::vector<int32_t> result = GetPossibleDieRollIndexes(skipIndex);
-	std::sort(result.begin(), result.end(), [this](int32_t indexA, int32_t indexB) -> bool
-		{
-			return GetDieRoll(indexA).mMissingPotential > GetDieRoll(indexB).mMissingPotential;
-		});
-	result.resize(std::min(n, result.size()));
-	return result;
+	return GetNFromRanking(mMissingPotentialRanking, n, skipIndex);
+}
+
+int32_t WPExecutionResources::GetWorstDieRollIndex(int32_t skipIndex /*= -1*/) const
+{
+	return GetFirstFromRanking(mWorstRanking, skipIndex);
+}
+
+int32_t WPExecutionResources::GetBestDieRollIndex(int32_t skipIndex /*= -1*/) const
+{
+	return GetFirstFromRanking(mBestRanking, skipIndex);
 }
 
 int32_t WPExecutionResources::GetFirstRemainingDiceIndexWithEffect(DiceEffect diceEffect, int32_t skipIndex /*= -1*/) const
@@ -193,123 +314,26 @@ int32_t WPExecutionResources::GetFirstRemainingDiceIndexWithEffect(DiceEffect di
 
 const WPCard& WPExecutionResources::GetCard(int32_t index) const
 {
-	if (index < (int32_t)mAllAvailableCards.size())
+	if (index < mDeck->mNumCards)
 	{
-		return mAllAvailableCards.at(index);
+		return WPCatalog::Get().GetCard(mDeck->mCardIndexes[index]);
 	}
 	return WPCard::kInvalidCard;
 }
 
-void WPExecutionResources::ResetCardsToDefault()
+void WPExecutionResources::SetCardVariation(int32_t variationId)
 {
-	mAllAvailableCards.clear();
-
-	mAllAvailableCards.emplace_back(1, "Reroll 2 Dice", std::vector<CardEffectAndMagnitude>{
-		{ CardEffect::RerollDice, 2 }
-	});
-	mAllAvailableCards.emplace_back(1, "Extra Eval Next Turn", std::vector<CardEffectAndMagnitude>{
-		{ CardEffect::ExtraEvaluate, 1 }
-	});
-	mAllAvailableCards.emplace_back(1, "+50 skill", std::vector<CardEffectAndMagnitude>{
-		{ CardEffect::TempSkill, 50 }
-	});
-	mAllAvailableCards.emplace_back(1, "Heal 1", std::vector<CardEffectAndMagnitude>{
-		{ CardEffect::Heal, 1 }
-	});
-}
-
-void WPExecutionResources::AddCardVariation(int32_t variationId)
-{
-	switch (variationId)
-	{
-	case 1:
-	{
-		mAllAvailableCards.pop_back();
-		mAllAvailableCards.emplace(mAllAvailableCards.begin(), 2, "Draw a Card, +1 Temp Bonus Result", std::vector<CardEffectAndMagnitude>{
-			{ CardEffect::DrawCard, 1 },
-			{ CardEffect::TempBonusResult, 1 }
-		});
-		break;
-	}
-	case 2:
-	{
-		mAllAvailableCards.pop_back();
-		mAllAvailableCards.emplace(mAllAvailableCards.begin(), 2, "Swap Opponent Dice", std::vector<CardEffectAndMagnitude>{
-			{ CardEffect::SwapOpponentDice, 1 }
-		});
-		break;
-	}
-	case 3:
-	{
-		mAllAvailableCards.pop_back();
-		mAllAvailableCards.emplace(mAllAvailableCards.begin(), 2, "Force 1 Damage", std::vector<CardEffectAndMagnitude>{
-			{ CardEffect::ForceDamage, 1 }
-		});
-		break;
-	}
-	case 4:
-	{
-		mAllAvailableCards.pop_back();
-		mAllAvailableCards.emplace(mAllAvailableCards.begin(), 2, "+1 Permanent Damage", std::vector<CardEffectAndMagnitude>{
-			{ CardEffect::PermanentDamage, 1 }
-		});
-		break;
-	}
-	case 5:
-	{
-		mAllAvailableCards.pop_back();
-		mAllAvailableCards.emplace(mAllAvailableCards.begin(), 2, "+2x Eval Next Turn", std::vector<CardEffectAndMagnitude>{
-			{ CardEffect::ExtraEvaluate, 2 }
-		});
-		break;
-	}
-	case 6:
-	{
-		mAllAvailableCards.pop_back();
-		mAllAvailableCards.emplace(mAllAvailableCards.begin(), 2, "Heal 3", std::vector<CardEffectAndMagnitude>{
-			{ CardEffect::Heal, 3 }
-		});
-		break;
-	}
-	case 7:
-	{
-		mAllAvailableCards.pop_back();
-		mAllAvailableCards.emplace(mAllAvailableCards.begin(), 2, "Reroll 4 Dice", std::vector<CardEffectAndMagnitude>{
-			{ CardEffect::RerollDice, 4 }
-		});
-		break;
-	}
-	case 8:
-	{
-		mAllAvailableCards.pop_back();
-		mAllAvailableCards.emplace(mAllAvailableCards.begin(), 2, "+20 ONLY PERMANENT BONUS", std::vector<CardEffectAndMagnitude>{
-		});
-		break;
-	}
-	case 9:
-	{
-		mAllAvailableCards.pop_back();
-		mAllAvailableCards.emplace(mAllAvailableCards.begin(), 2, "Exchange Dice for Super Dice", std::vector<CardEffectAndMagnitude>{
-			{ CardEffect::ReplaceWithRandomEffectDice, 1 }
-		});
-		break;
-	}
-
-	default: break;
-	}
+	mDeck = &WPCatalog::Get().GetDeck(variationId);
 }
 
 std::vector<int32_t> WPExecutionResources::GetNHighestCardLevels(size_t n) const
 {
 	std::vector<int32_t> result;
-	for (const WPCard& card : mAllAvailableCards)
+	for (int32_t index = 0; index < mDeck->mNumCards; ++index)
 	{
-		result.push_back(card.mCardLevel);
+		result.push_back(GetCard(index).mCardLevel);
 	}
-	std::sort(result.begin(), result.end(), [&result](int32_t indexA, int32_t indexB) -> bool
-		{
-			return result[indexA] > result[indexB];
-		});
+	std::sort(result.begin(), result.end(), std::greater<int32_t>());
 	result.resize(std::min(n, result.size()));
 	return result;
 }
@@ -318,8 +342,9 @@ void WPExecutionResources::PrintCardVariations(const char* const headerName) con
 {
 	bool bHasPrintedHeader = false;
 
-	for (const WPCard& card : mAllAvailableCards)
+	for (int32_t index = 0; index < mDeck->mNumCards; ++index)
 	{
+		const WPCard& card = GetCard(index);
 		if (card.mCardLevel > 1)
 		{
 			if (!bHasPrintedHeader)
@@ -43,31 +43,92 @@ enum class DiceFace : uint8_t
 };
 ENUM_OPS(DiceFace);
 
+struct DieFace
+{
+	int8_t mValue = 0;
+	DiceEffect mDiceEffect = DiceEffect::None;
+	int8_t mMissingPotential = 0; // Distance to the Best face. Always 0 for RandomEffect, which isn't a setup die
+};
+using DieFaces = std::array<DieFace, +DiceFace::Count>;
+
+constexpr std::array<DieFaces, +DiceType::Count> cDieFaces = []() consteval
+	{
+		//constexpr int8_t sides[+DiceType::Count][+DiceFace::Count] =
+		//{
+		//	{3,3,4,4,4,9},
+		//	{1,2,2,7,7,8},
+		//	{0,5,5,5,6,6},
+		//	{1,1,1,2,2,3}
+		//};
+		constexpr int8_t sides[+DiceType::Count][+DiceFace::Count] =
+		{
+			{6,7,7,8,8,9}, // Heavy
+			{1,2,3,4,5,6}, // Swing
+			{3,3,4,4,5,6}, // Bonus
+			{0,1,1,2,2,2}, // Card
+
+			// RandomEffect
+			{2,2,6,6,9,9}
+		};
+		constexpr DiceEffect effects[+DiceType::Count][+DiceFace::Count] =
+		{
+			{DiceEffect::None, DiceEffect::None, DiceEffect::None, DiceEffect::None, DiceEffect::None, DiceEffect::None}, // Heavy
+			{DiceEffect::None, DiceEffect::None, DiceEffect::None, DiceEffect::None, DiceEffect::None, DiceEffect::None}, // Swing
+			{DiceEffect::ResultBonus, DiceEffect::ResultBonus, DiceEffect::ResultBonus, DiceEffect::ResultBonus, DiceEffect::ResultBonus, DiceEffect::ResultBonus}, // Bonus
+			{DiceEffect::PlayCard, DiceEffect::PlayCard, DiceEffect::PlayCard, DiceEffect::PlayCard, DiceEffect::PlayCard, DiceEffect::PlayCard}, // Card
+
+			// RandomEffect
+			{DiceEffect::PlayCard, DiceEffect::PlayCard, DiceEffect::ResultBonus, DiceEffect::ResultBonus, DiceEffect::None, DiceEffect::None}
+		};
+
+		std::array<DieFaces, +DiceType::Count> dieFaces = {};
+		for (int32_t type = 0; type < +DiceType::Count; ++type)
+		{
+			for (int32_t face = 0; face < +DiceFace::Count; ++face)
+			{
+				DieFace& dieFace = dieFaces[type][face];
+				dieFace.mValue = sides[type][face];
+				dieFace.mDiceEffect = effects[type][face];
+				if (type < +DiceType::CountCombatSetupDice)
+				{
+					dieFace.mMissingPotential = sides[type][+DiceFace::Best] - sides[type][face];
+				}
+			}
+		}
+		return dieFaces;
+	}();
+
+/**
+ * Packed to 5 bytes so a full pool of dice fits in a cache line alongside its count.
+ * Value and missing potential are filled from the face tables when the die is made; color is looked up on print.
+ */
 struct DieRoll
 {
 	DiceType mDiceType;
-	int32_t mValue;
+	DiceFace mDiceFace;
 	DiceEffect mDiceEffect;
-	MathPrint::PrintColor mDiceColor;
-	int32_t mMissingPotential;
+	int8_t mValue;
+	int8_t mMissingPotential;
 
-	DieRoll(DiceType diceType, int32_t value, DiceEffect diceEffect, MathPrint::PrintColor diceColor, int32_t missingPotential)
+	constexpr DieRoll(DiceType diceType, DiceFace diceFace, int32_t value, DiceEffect diceEffect, int32_t missingPotential)
 	: mDiceType(diceType)
-	, mValue(value)
+	, mDiceFace(diceFace)
 	, mDiceEffect(diceEffect)
-	, mDiceColor(diceColor)
-	, mMissingPotential(missingPotential)
+	, mValue((int8_t)value)
+	, mMissingPotential((int8_t)missingPotential)
 	{}
 
-	DieRoll()
+	// Invalid die, face is DiceFace::Count
+	constexpr DieRoll()
 	: mDiceType(DiceType::Swing)
-	, mValue(-10)
+	, mDiceFace(DiceFace::Count)
 	, mDiceEffect(DiceEffect::None)
-	, mDiceColor(MathPrint::PrintColor::Red)
+	, mValue(-10)
 	, mMissingPotential(0)
 	{}
 
 	void Print() const;
+	MathPrint::PrintColor GetColor() const;
 
 	// Assumes level 1 cards
 	// TODO: Take in a worker to make a more complex prediction
@@ -76,52 +137,135 @@ struct DieRoll
 	static const DieRoll kInvalidDie;
 };
 
+/**
+ * Fixed capacity dice storage. Removal swaps the last die into the removed slot, so order is not preserved.
+ */
+class DicePool
+{
+public:
+	static constexpr int32_t cCapacity = 8;
+
+	void Clear();
+	void Add(const DieRoll& dieRoll);
+	void Set(int32_t index, const DieRoll& dieRoll);
+	void SwapRemove(int32_t index);
+
+	int32_t GetCount() const { return mCount; }
+	const DieRoll& operator[](int32_t index) const { return mDice[index]; }
+
+	const DieRoll* begin() const { return mDice.data(); }
+	const DieRoll* end() const { return mDice.data() + mCount; }
+
+	/**
+	 * Running totals, kept up to date by every change to the pool
+	 */
+	int32_t GetTotalValue() const { return mTotalValue; }
+	int32_t GetBestPossibleTotal() const { return mBestPossibleTotal; }
+	int32_t GetWorstPossibleTotal() const { return mWorstPossibleTotal; }
+	int32_t CountEffect(DiceEffect diceEffect) const { return mEffectCounts[+diceEffect]; }
+
+private:
+	void Track(const DieRoll& dieRoll, int32_t direction);
+
+	std::array<DieRoll, cCapacity> mDice;
+	int32_t mCount = 0;
+
+	int32_t mTotalValue = 0;
+	int32_t mBestPossibleTotal = 0;
+	int32_t mWorstPossibleTotal = 0;
+	std::array<int32_t, +DiceEffect::PlayCard + 1> mEffectCounts = {};
+};
+
+/**
+ * Inline list of dice indexes returned by the ranking queries. Never allocates.
+ */
+class DiceIndexList
+{
+public:
+	void PushBack(int32_t index) { mIndexes[mCount++] = index; }
+
+	int32_t GetCount() const { return mCount; }
+	bool IsEmpty() const { return mCount == 0; }
+	int32_t operator[](int32_t index) const { return mIndexes[index]; }
+
+	const int32_t* begin() const { return mIndexes.data(); }
+	const int32_t* end() const { return mIndexes.data() + mCount; }
+
+	operator std::span<const int32_t>() const { return std::span<const int32_t>(mIndexes.data(), mCount); }
+
+private:
+	std::array<int32_t, DicePool::cCapacity> mIndexes;
+	int32_t mCount = 0;
+};
+
 class WPExecutionResources
 {
 public:
-	WPExecutionResources(const RNG& rng)
-	: mRng(rng)
-	{}
+	WPExecutionResources(const RNG& rng);
 
 	/**
 	 * Dice
 	 */
 	DiceFace RandomDieFace() const;
 	void RollNOfEachDie(int32_t numOfEach);
+	void SetFixedRollFaces(std::span<const DiceFace> faces); // Taken in order by RollNOfEachDie instead of rolling. Empty to roll again
 
 	void RerollDie(int32_t index);
 	void ReplaceDie(int32_t index, DiceType diceType);
-	void RemoveDice(std::vector<int32_t> indexes);
+	void RemoveDice(int32_t indexA, int32_t indexB);
 
-	const std::vector<DieRoll>& GetRemainingDice() const { return mRemainingDice; }
-	int32_t GetNumRemainingDice() const { return (int32_t)mRemainingDice.size(); }
-	int32_t GetNumRemainingCombatRounds() const { return (int32_t)mRemainingDice.size() / 2; }
+	const DicePool& GetRemainingDice() const { return mRemainingDice; }
+	int32_t GetNumRemainingDice() const { return mRemainingDice.GetCount(); }
+	int32_t GetNumRemainingCombatRounds() const { return mRemainingDice.GetCount() / 2; }
 	const DieRoll& GetDieRoll(int32_t index) const;
 
-	static DieRoll MakeDieRoll(DiceType diceType, DiceFace face);
-	static std::vector<DiceEffect> MakeDiceEffectList(DiceEffect diceEffect);
+	static constexpr DieRoll MakeDieRoll(DiceType diceType, DiceFace face)
+	{
+		const DieFace& dieFace = cDieFaces[+diceType][+face];
+		return DieRoll(diceType, face, dieFace.mValue, dieFace.mDiceEffect, dieFace.mMissingPotential);
+	}
 
-	std::vector<int32_t> GetPossibleDieRollIndexes(int32_t skipIndex = -1) const;
-	std::vector<int32_t> GetNWorstDieRollIndexes(size_t n, int32_t skipIndex = -1) const;
-	std::vector<int32_t> GetNBestDieRollIndexes(size_t n, int32_t skipIndex = -1) const;
-	std::vector<int32_t> GetNHighestMissingPotentialDieRollIndexes(size_t n, int32_t skipIndex = -1) const;
+	/**
+	 * Rankings are rebuilt whenever the remaining dice change, so these are lookups into presorted orders.
+	 * Dice with equal rank keep their pool order (lowest index first).
+	 */
+	DiceIndexList GetPossibleDieRollIndexes(int32_t skipIndex = -1) const;
+	DiceIndexList GetNWorstDieRollIndexes(size_t n, int32_t skipIndex = -1) const;
+	DiceIndexList GetNBestDieRollIndexes(size_t n, int32_t skipIndex = -1) const;
+	DiceIndexList GetNHighestMissingPotentialDieRollIndexes(size_t n, int32_t skipIndex = -1) const;
+	int32_t GetWorstDieRollIndex(int32_t skipIndex = -1) const; // -1 if there is no other die
+	int32_t GetBestDieRollIndex(int32_t skipIndex = -1) const; // -1 if there is no other die
 	int32_t GetFirstRemainingDiceIndexWithEffect(DiceEffect diceEffect, int32_t skipIndex = -1) const;
 	/**
 	 * Cards
+	 * Decks live in the WPCatalog, so changing variation only repoints the deck
 	 */
-	void ResetCardsToDefault();
-	void AddCardVariation(int32_t variationId);
+	void ResetCardsToDefault() { SetCardVariation(0); }
+	void SetCardVariation(int32_t variationId);
 
-	const int32_t GetNumAllCards() const { return (int32_t)mAllAvailableCards.size(); }
+	const int32_t GetNumAllCards() const { return mDeck->mNumCards; }
 	const WPCard& GetCard(int32_t index) const;
+	CardMask GetCardsWithEffect(CardEffect cardEffect) const { return mDeck->mCardsWithEffect[+cardEffect]; }
+	int32_t GetMaxCardMagnitude(CardEffect cardEffect) const { return mDeck->mMaxCardMagnitudes[+cardEffect]; } // Highest single card magnitude in the deck
 
 	std::vector<int32_t> GetNHighestCardLevels(size_t n) const;
 
 	void PrintCardVariations(const char* const headerName) const;
 private:
+	using DiceRanking = std::array<int8_t, DicePool::cCapacity>;
+
+	void RebuildDiceRankings();
+	DiceIndexList GetNFromRanking(const DiceRanking& ranking, size_t n, int32_t skipIndex) const;
+	int32_t GetFirstFromRanking(const DiceRanking& ranking, int32_t skipIndex) const;
+
 	const RNG& mRng;
 
-	std::vector<DieRoll> mRemainingDice;
-	std::vector<WPCard> mAllAvailableCards;
+	DicePool mRemainingDice;
+	std::array<DiceFace, DicePool::cCapacity> mFixedRollFaces = {};
+	int32_t mNumFixedRollFaces = 0;
+	DiceRanking mBestRanking = {};
+	DiceRanking mWorstRanking = {};
+	DiceRanking mMissingPotentialRanking = {};
+	const WPDeck* mDeck = nullptr;
 };
 
@@ -15,6 +15,17 @@ WPScenario::WPScenario(const RNG& rng, Stats* stats)
 	mDefender.SetStrategyAsDefault();
 	mDefender.SetRole(WorkerRole::Defender);
 	mDefenderResources.ResetCardsToDefault();
+
+	// Named up front so snapshots are labeled whether or not they were printed
+	if (mStats)
+	{
+		mStats->SetIntDistributionAxisNames(+WPStatsIds::RollValues, "Rolls", "Total Value");
+		mStats->SetIntDistributionAxisNames(+WPStatsIds::WinMissingPotential, "+Potential", "Losses");
+		mStats->SetIntDistributionAxisNames(+WPStatsIds::LossMissingPotential, "-Potential", "Losses");
+		mStats->SetIntDistributionAxisNames(+WPStatsIds::LossHighestValue, "Value", "Losses");
+		mStats->SetIntDistributionAxisNames(+WPStatsIds::Loss8Plus, "8Plus", "Losses");
+		mStats->SetIntDistributionAxisNames(+WPStatsIds::LossSadnessScore, "Score", "Losses");
+	}
 }
 
 ScenarioResult WPScenario::Execute()
@@ -35,57 +46,52 @@ ScenarioResult WPScenario::Execute()
 		printf("\n");
 	}
 
-	int32_t attackerSadnessScore = 0;
-	int32_t attackerMissingPotential = 0;
-	int32_t attackerHighestValue = 0;
-	int32_t attacker8plus = 0;
-	for (const DieRoll& roll : mAttackerResources.GetRemainingDice())
-	{
-		attackerMissingPotential += roll.mMissingPotential;
-		attackerHighestValue = std::max(attackerHighestValue, roll.mValue);
-
-		attackerSadnessScore += roll.mMissingPotential + (roll.mMissingPotential >= 4);
-		attacker8plus += (roll.mValue >= 8);
-	}
-	attackerSadnessScore += 3 - (attackerHighestValue - 6);
-
-	int32_t defenderSadnessScore = 0;
-	int32_t defenderMissingPotential = 0;
-	int32_t defenderHighestValue = 0;
-	int32_t defender8plus = 0;
-	for (const DieRoll& roll : mDefenderResources.GetRemainingDice())
-	{
-		defenderMissingPotential += roll.mMissingPotential;
-		defenderHighestValue = std::max(defenderHighestValue, roll.mValue);
-
-		defenderSadnessScore += roll.mMissingPotential + (roll.mMissingPotential >= 4);
-		defender8plus += (roll.mValue >= 8);
-	}
-	defenderSadnessScore += 3 - (defenderHighestValue - 6);
+	const OpeningQuality attackerQuality = GetOpeningQuality(mAttackerResources.GetRemainingDice());
+	const OpeningQuality defenderQuality = GetOpeningQuality(mDefenderResources.GetRemainingDice());
 
 	const ScenarioResult result = ExecuteInnerLoop();
-	if (mStats)
+	if (mStats && (result != ScenarioResult::Count))
 	{
+		// Every round pulls two of the attacker's dice
+		mStats->AddToSummary(+WPSummaryIds::FightRounds, (double)((DicePool::cCapacity - mAttackerResources.GetNumRemainingDice()) / 2));
+
 		if (result == ScenarioResult::AttackerWin)
 		{
-			mStats->AddToIntDistribution(+WPStatsIds::WinMissingPotential, attackerMissingPotential);
-			mStats->AddToIntDistribution(+WPStatsIds::LossMissingPotential, defenderMissingPotential);
-			mStats->AddToIntDistribution(+WPStatsIds::LossHighestValue, defenderHighestValue);
-			mStats->AddToIntDistribution(+WPStatsIds::Loss8Plus, defender8plus);
-			mStats->AddToIntDistribution(+WPStatsIds::LossSadnessScore, defenderSadnessScore);
+			mStats->AddToSummary(+WPSummaryIds::WinnerHealthRemaining, (double)mAttacker.GetHealth());
+			mStats->AddToIntDistribution(+WPStatsIds::WinMissingPotential, attackerQuality.mMissingPotential);
+			mStats->AddToIntDistribution(+WPStatsIds::LossMissingPotential, defenderQuality.mMissingPotential);
+			mStats->AddToIntDistribution(+WPStatsIds::LossHighestValue, defenderQuality.mHighestValue);
+			mStats->AddToIntDistribution(+WPStatsIds::Loss8Plus, defenderQuality.m8Plus);
+			mStats->AddToIntDistribution(+WPStatsIds::LossSadnessScore, defenderQuality.mSadnessScore);
 		}
 		else if (result == ScenarioResult::DefenderWin)
 		{
-			mStats->AddToIntDistribution(+WPStatsIds::WinMissingPotential, defenderMissingPotential);
-			mStats->AddToIntDistribution(+WPStatsIds::LossMissingPotential, attackerMissingPotential);
-			mStats->AddToIntDistribution(+WPStatsIds::LossHighestValue, attackerHighestValue);
-			mStats->AddToIntDistribution(+WPStatsIds::Loss8Plus, attacker8plus);
-			mStats->AddToIntDistribution(+WPStatsIds::LossSadnessScore, attackerSadnessScore);
+			mStats->AddToSummary(+WPSummaryIds::WinnerHealthRemaining, (double)mDefender.GetHealth());
+			mStats->AddToIntDistribution(+WPStatsIds::WinMissingPotential, defenderQuality.mMissingPotential);
+			mStats->AddToIntDistribution(+WPStatsIds::LossMissingPotential, attackerQuality.mMissingPotential);
+			mStats->AddToIntDistribution(+WPStatsIds::LossHighestValue, attackerQuality.mHighestValue);
+			mStats->AddToIntDistribution(+WPStatsIds::Loss8Plus, attackerQuality.m8Plus);
+			mStats->AddToIntDistribution(+WPStatsIds::LossSadnessScore, attackerQuality.mSadnessScore);
 		}
 	}
 	return result;
 }
 
+/*static*/ OpeningQuality WPScenario::GetOpeningQuality(const DicePool& openingDice)
+{
+	OpeningQuality quality;
+	for (const DieRoll& roll : openingDice)
+	{
+		quality.mMissingPotential += roll.mMissingPotential;
+		quality.mHighestValue = std::max(quality.mHighestValue, (int32_t)roll.mValue);
+
+		quality.mSadnessScore += roll.mMissingPotential + (roll.mMissingPotential >= 4);
+		quality.m8Plus += (roll.mValue >= 8);
+	}
+	quality.mSadnessScore += 3 - (quality.mHighestValue - 6);
+	return quality;
+}
+
 ScenarioResult WPScenario::ExecuteWithEndPrint()
 {
 	const ScenarioResult result = Execute();
@@ -151,23 +157,17 @@ float WPScenario::MultiExecute(uint64_t numberToExecute)
 
 		if (mStats && mPrintType == ScenarioPrintType::MultiExecuteAndStats)
 		{
-			mStats->SetIntDistributionAxisNames(+WPStatsIds::RollValues, "Rolls", "Total Value");
 			mStats->PrintIntDistribution(+WPStatsIds::RollValues, 40, 20);
-
-			mStats->SetIntDistributionAxisNames(+WPStatsIds::WinMissingPotential, "+Potential", "Losses");
 			mStats->PrintIntDistribution(+WPStatsIds::WinMissingPotential, 40, 20);
-
-			mStats->SetIntDistributionAxisNames(+WPStatsIds::LossMissingPotential, "-Potential", "Losses");
 			mStats->PrintIntDistribution(+WPStatsIds::LossMissingPotential, 40, 20);
-
-			mStats->SetIntDistributionAxisNames(+WPStatsIds::LossHighestValue, "Value", "Losses");
 			mStats->PrintIntDistribution(+WPStatsIds::LossHighestValue, 40, 20);
-
-			mStats->SetIntDistributionAxisNames(+WPStatsIds::Loss8Plus, "8Plus", "Losses");
 			mStats->PrintIntDistribution(+WPStatsIds::Loss8Plus, 40, 20);
-
-			mStats->SetIntDistributionAxisNames(+WPStatsIds::LossSadnessScore, "Score", "Losses");
 			mStats->PrintIntDistribution(+WPStatsIds::LossSadnessScore, 40, 20);
+
+			printf("\n");
+			mStats->PrintSummary(+WPSummaryIds::RollValues, "Roll Values");
+			mStats->PrintSummary(+WPSummaryIds::FightRounds, "Fight Rounds");
+			mStats->PrintSummary(+WPSummaryIds::WinnerHealthRemaining, "Winner Health");
 		}
 	}
 	return resultPercents[+ScenarioResult::AttackerWin];
@@ -175,8 +175,13 @@ float WPScenario::MultiExecute(uint64_t numberToExecute)
 
 ScenarioResult WPScenario::ExecuteInnerLoop()
 {
-	while (mAttackerResources.GetRemainingDice().size() > 1)
+	while (mAttackerResources.GetNumRemainingDice() > 1)
 	{
+		if (mRoundStartCallback && mRoundStartCallback())
+		{
+			return ScenarioResult::Count;
+		}
+
 		mAttacker.DetermineCommand();
 		mDefender.DetermineCommand();
 
@@ -306,7 +311,7 @@ ScenarioResult WPScenario::ExecuteInnerLoop()
 
 void WPScenario::PrintRemainingDice()
 {
-	const std::vector<DieRoll>& attackerRolls = mAttackerResources.GetRemainingDice();
+	const DicePool& attackerRolls = mAttackerResources.GetRemainingDice();
 	for (const DieRoll& dieRoll : attackerRolls)
 	{
 		dieRoll.Print();
@@ -314,7 +319,7 @@ void WPScenario::PrintRemainingDice()
 
 	printf(" vs ");
 
-	const std::vector<DieRoll>& defenderRolls = mDefenderResources.GetRemainingDice();
+	const DicePool& defenderRolls = mDefenderResources.GetRemainingDice();
 	for (const DieRoll& dieRoll : defenderRolls)
 	{
 		dieRoll.Print();
@@ -15,6 +15,14 @@ enum class WPStatsIds : int32_t
 };
 ENUM_OPS(WPStatsIds);
 
+enum class WPSummaryIds : int32_t
+{
+	RollValues,
+	FightRounds,
+	WinnerHealthRemaining
+};
+ENUM_OPS(WPSummaryIds);
+
 enum class ScenarioResult : uint8_t
 {
 	Stall,
@@ -27,6 +35,17 @@ enum class ScenarioResult : uint8_t
 };
 ENUM_OPS(ScenarioResult);
 
+/**
+ * How good an opening roll is for one side, before anything has been played
+ */
+struct OpeningQuality
+{
+	int32_t mMissingPotential = 0;
+	int32_t mHighestValue = 0;
+	int32_t m8Plus = 0;
+	int32_t mSadnessScore = 0;
+};
+
 enum class ScenarioPrintType : uint8_t
 {
 	None,
@@ -48,8 +67,17 @@ public:
 
 	void SetPrintType(ScenarioPrintType printType) { mPrintType = printType; }
 
+	/**
+	 * Called at the start of every round. Returning true stops the fight, and Execute returns ScenarioResult::Count
+	 */
+	void SetRoundStartCallback(std::function<bool()> roundStartCallback) { mRoundStartCallback = std::move(roundStartCallback); }
+
 	WPWorker& GetAttacker() { return mAttacker; }
 	WPWorker& GetDefender() { return mDefender; }
+	WPExecutionResources& GetAttackerResources() { return mAttackerResources; }
+	WPExecutionResources& GetDefenderResources() { return mDefenderResources; }
+
+	static OpeningQuality GetOpeningQuality(const DicePool& openingDice);
 
 private:
 	ScenarioResult ExecuteInnerLoop();
@@ -65,5 +93,6 @@ private:
 	Stats* mStats = nullptr;
 
 	ScenarioPrintType mPrintType = ScenarioPrintType::None;
+	std::function<bool()> mRoundStartCallback;
 };
 
@@ -0,0 +1,232 @@
+#include "WPSweep.h"
+
+#include <chrono>
+#include "RNG.h"
+#include "ThreadPool.h"
+
+static const char* const kSummaryCSVNames[] = { "Roll", "Rounds", "WinnerHealth" }; // By WPSummaryIds
+
+/*static*/ WPSweepConfig WPSweepConfig::MakeFullSweep(int32_t maxCardVariation)
+{
+	WPSweepConfig config;
+	for (WorkerType workerType = WorkerType::Basic; workerType < WorkerType::Count; ++workerType)
+	{
+		config.mAttackerTypes.push_back(workerType);
+		config.mDefenderTypes.push_back(workerType);
+	}
+
+	for (int32_t cardVariation = 0; cardVariation <= maxCardVariation; ++cardVariation)
+	{
+		config.mAttackerCardVariations.push_back(cardVariation);
+		config.mDefenderCardVariations.push_back(cardVariation);
+	}
+
+	const WPSweepDiceStrategy defaultDice = { "Default", WPWorker::MakeDefaultDiceStrategy() };
+	const WPSweepDiceStrategy orderedDice = { "Ordered",
+	{
+		DicePlayStrategy::IfExtraEvalThrowBestTens,
+		DicePlayStrategy::IfMaxHealthThrowWorst,
+		DicePlayStrategy::TensTopOrdered,
+		DicePlayStrategy::OnesBottomOrdered
+	} };
+	config.mAttackerDiceStrategies = { defaultDice, orderedDice };
+	config.mDefenderDiceStrategies = { defaultDice };
+
+	const WPSweepCardStrategy defaultCards = { "Default", WPWorker::MakeDefaultCardStrategy() };
+	WPSweepCardStrategy reversedCards = { "Reversed", WPWorker::MakeDefaultCardStrategy() };
+	std::reverse(reversedCards.mStrategy.begin(), reversedCards.mStrategy.end());
+	config.mAttackerCardStrategies = { defaultCards, reversedCards };
+	config.mDefenderCardStrategies = { defaultCards };
+
+	return config;
+}
+
+float WPSweepCell::GetRate(ScenarioResult result) const
+{
+	return (mSamples > 0) ? ((float)mResults[+result] / (float)mSamples) : 0.f;
+}
+
+WPSweep::WPSweep(const WPSweepConfig& config)
+: mConfig(config)
+{
+	for (WorkerType attackerType : mConfig.mAttackerTypes)
+	for (WorkerType defenderType : mConfig.mDefenderTypes)
+	for (int32_t attackerCardVariation : mConfig.mAttackerCardVariations)
+	for (int32_t defenderCardVariation : mConfig.mDefenderCardVariations)
+	for (size_t attackerDiceStrategy = 0; attackerDiceStrategy < mConfig.mAttackerDiceStrategies.size(); ++attackerDiceStrategy)
+	for (size_t defenderDiceStrategy = 0; defenderDiceStrategy < mConfig.mDefenderDiceStrategies.size(); ++defenderDiceStrategy)
+	for (size_t attackerCardStrategy = 0; attackerCardStrategy < mConfig.mAttackerCardStrategies.size(); ++attackerCardStrategy)
+	for (size_t defenderCardStrategy = 0; defenderCardStrategy < mConfig.mDefenderCardStrategies.size(); ++defenderCardStrategy)
+	{
+		WPSweepCell& cell = mCells.emplace_back();
+		cell.mAttackerType = attackerType;
+		cell.mDefenderType = defenderType;
+		cell.mAttackerCardVariation = attackerCardVariation;
+		cell.mDefenderCardVariation = defenderCardVariation;
+		cell.mAttackerDiceStrategy = attackerDiceStrategy;
+		cell.mDefenderDiceStrategy = defenderDiceStrategy;
+		cell.mAttackerCardStrategy = attackerCardStrategy;
+		cell.mDefenderCardStrategy = defenderCardStrategy;
+	}
+}
+
+void WPSweep::Run(uint32_t seed)
+{
+	const std::chrono::high_resolution_clock::time_point startTime = std::chrono::high_resolution_clock::now();
+
+	ThreadPool threadPool(mConfig.mNumThreads);
+	threadPool.ParallelFor(mCells.size(), [this, seed](size_t cellIndex, size_t)
+	{
+		// Seeded per cell rather than per thread so results don't depend on scheduling
+		RunCell(mCells[cellIndex], seed ^ (uint32_t)(cellIndex * 0x9E3779B9));
+	});
+
+	const std::chrono::high_resolution_clock::time_point endTime = std::chrono::high_resolution_clock::now();
+	mRunSeconds = std::chrono::duration<double>(endTime - startTime).count();
+}
+
+void WPSweep::RunCell(WPSweepCell& cell, uint32_t seed) const
+{
+	const RNG rng(seed);
+	Stats stats;
+	WPScenario scenario(rng, &stats);
+
+	WPWorker& attacker = scenario.GetAttacker();
+	attacker.SetWorkerType(cell.mAttackerType);
+	attacker.SetArbitraryCardVariation(cell.mAttackerCardVariation);
+	attacker.SetDiceStrategy(mConfig.mAttackerDiceStrategies[cell.mAttackerDiceStrategy].mStrategy);
+	attacker.SetCardStrategy(mConfig.mAttackerCardStrategies[cell.mAttackerCardStrategy].mStrategy);
+
+	WPWorker& defender = scenario.GetDefender();
+	defender.SetWorkerType(cell.mDefenderType);
+	defender.SetArbitraryCardVariation(cell.mDefenderCardVariation);
+	defender.SetDiceStrategy(mConfig.mDefenderDiceStrategies[cell.mDefenderDiceStrategy].mStrategy);
+	defender.SetCardStrategy(mConfig.mDefenderCardStrategies[cell.mDefenderCardStrategy].mStrategy);
+
+	const uint64_t batchSize = std::max<uint64_t>(mConfig.mBatchSize, 1);
+	while (cell.mSamples < mConfig.mMaxSamples)
+	{
+		const uint64_t batch = std::min(batchSize, mConfig.mMaxSamples - cell.mSamples);
+		for (uint64_t i = 0; i < batch; ++i)
+		{
+			cell.mResults[+scenario.Execute()]++;
+		}
+		cell.mSamples += batch;
+
+		cell.mHalfWidth = 0.f;
+		for (uint64_t resultCount : cell.mResults)
+		{
+			cell.mHalfWidth = std::max(cell.mHalfWidth, GetConfidenceHalfWidth(resultCount, cell.mSamples));
+		}
+
+		if ((cell.mSamples >= mConfig.mMinSamples) && (cell.mHalfWidth <= mConfig.mTargetHalfWidth))
+		{
+			break;
+		}
+	}
+
+	for (int32_t summaryId = 0; summaryId < (int32_t)cell.mSummaries.size(); ++summaryId)
+	{
+		cell.mSummaries[summaryId] = stats.GetSummary(summaryId);
+	}
+}
+
+/*static*/ float WPSweep::GetConfidenceHalfWidth(uint64_t successes, uint64_t samples)
+{
+	// Agresti-Coull: adding two successes and two failures keeps rare outcomes from reporting a zero width interval
+	constexpr double cZ = 1.96;
+	const double adjustedSamples = (double)samples + (cZ * cZ);
+	const double adjustedRate = ((double)successes + (cZ * cZ * 0.5)) / adjustedSamples;
+	return (float)(cZ * std::sqrt(adjustedRate * (1.0 - adjustedRate) / adjustedSamples));
+}
+
+bool WPSweep::WriteCSV(const char* const fileName) const
+{
+	std::ofstream file(fileName);
+	if (!file.is_open())
+	{
+		printf("\nCould not open %s for writing\n", fileName);
+		return false;
+	}
+
+	file << "AttackerType,DefenderType,AttackerCardVariation,DefenderCardVariation,"
+		"AttackerDiceStrategy,DefenderDiceStrategy,AttackerCardStrategy,DefenderCardStrategy,"
+		"Samples,AttackerWin,DefenderWin,AttackerFlee,DefenderFlee,BothFlee,Stall,HalfWidth95";
+	for (const char* const summaryName : kSummaryCSVNames)
+	{
+		for (const char* const columnName : { "Mean", "SD", "P50", "P90", "P99" })
+		{
+			file << ',' << summaryName << columnName;
+		}
+	}
+	file << '\n';
+
+	char rates[128];
+	char summaryColumns[96];
+	for (const WPSweepCell& cell : mCells)
+	{
+		snprintf(rates, sizeof(rates), "%.5f,%.5f,%.5f,%.5f,%.5f,%.5f,%.5f",
+			cell.GetRate(ScenarioResult::AttackerWin),
+			cell.GetRate(ScenarioResult::DefenderWin),
+			cell.GetRate(ScenarioResult::AttackerFlee),
+			cell.GetRate(ScenarioResult::DefenderFlee),
+			cell.GetRate(ScenarioResult::BothFlee),
+			cell.GetRate(ScenarioResult::Stall),
+			cell.mHalfWidth);
+
+		file << WPWorker::GetWorkerTypeName(cell.mAttackerType) << ','
+			<< WPWorker::GetWorkerTypeName(cell.mDefenderType) << ','
+			<< cell.mAttackerCardVariation << ','
+			<< cell.mDefenderCardVariation << ','
+			<< mConfig.mAttackerDiceStrategies[cell.mAttackerDiceStrategy].mName << ','
+			<< mConfig.mDefenderDiceStrategies[cell.mDefenderDiceStrategy].mName << ','
+			<< mConfig.mAttackerCardStrategies[cell.mAttackerCardStrategy].mName << ','
+			<< mConfig.mDefenderCardStrategies[cell.mDefenderCardStrategy].mName << ','
+			<< cell.mSamples << ','
+			<< rates;
+
+		for (const StatsSummary& summary : cell.mSummaries)
+		{
+			snprintf(summaryColumns, sizeof(summaryColumns), ",%.3f,%.3f,%.2f,%.2f,%.2f",
+				summary.mMoments.mMean, summary.mMoments.GetStandardDeviation(),
+				summary.mQuantiles.GetQuantile(0.5), summary.mQuantiles.GetQuantile(0.9), summary.mQuantiles.GetQuantile(0.99));
+			file << summaryColumns;
+		}
+		file << '\n';
+	}
+	return true;
+}
+
+void WPSweep::PrintSummary() const
+{
+	uint64_t totalSamples = 0;
+	size_t cellsAtMaxSamples = 0;
+	float widestHalfWidth = 0.f;
+	std::array<StatsSummary, +WPSummaryIds::WinnerHealthRemaining + 1> summaries;
+	for (const WPSweepCell& cell : mCells)
+	{
+		totalSamples += cell.mSamples;
+		cellsAtMaxSamples += (cell.mHalfWidth > mConfig.mTargetHalfWidth);
+		widestHalfWidth = std::max(widestHalfWidth, cell.mHalfWidth);
+		for (size_t summaryId = 0; summaryId < summaries.size(); ++summaryId)
+		{
+			summaries[summaryId].Merge(cell.mSummaries[summaryId]);
+		}
+	}
+
+	printf("\nCells: %zu\n"
+		"Fights: %" PRIu64 " (%.0f per second)\n"
+		"Cells stopped at max samples: %zu\n"
+		"Widest 95%% half-width: %.2f%%\n"
+		"Time: %.2fs\n",
+		mCells.size(),
+		totalSamples, (mRunSeconds > 0.0) ? ((double)totalSamples / mRunSeconds) : 0.0,
+		cellsAtMaxSamples,
+		widestHalfWidth * 100.f,
+		mRunSeconds);
+
+	summaries[+WPSummaryIds::RollValues].Print("Roll Values");
+	summaries[+WPSummaryIds::FightRounds].Print("Fight Rounds");
+	summaries[+WPSummaryIds::WinnerHealthRemaining].Print("Winner Health");
+	printf("\n");
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include "Stats.h"
+#include "WPScenario.h"
+
+struct WPSweepDiceStrategy
+{
+	std::string mName;
+	std::vector<DicePlayStrategy> mStrategy;
+};
+
+struct WPSweepCardStrategy
+{
+	std::string mName;
+	std::vector<CardPlayStrategy> mStrategy;
+};
+
+struct WPSweepConfig
+{
+	std::vector<WorkerType> mAttackerTypes;
+	std::vector<WorkerType> mDefenderTypes;
+	std::vector<int32_t> mAttackerCardVariations;
+	std::vector<int32_t> mDefenderCardVariations;
+	std::vector<WPSweepDiceStrategy> mAttackerDiceStrategies;
+	std::vector<WPSweepDiceStrategy> mDefenderDiceStrategies;
+	std::vector<WPSweepCardStrategy> mAttackerCardStrategies;
+	std::vector<WPSweepCardStrategy> mDefenderCardStrategies;
+
+	uint64_t mBatchSize = 1000;
+	uint64_t mMinSamples = 2000;
+	uint64_t mMaxSamples = 200000;
+	float mTargetHalfWidth = 0.01f;
+	size_t mNumThreads = 0; // 0 uses every hardware thread
+
+	/**
+	 * Every worker type and card variations [0, maxCardVariation] on both sides, with the default strategies
+	 * plus an ordered dice strategy and a reversed card strategy for the attacker.
+	 */
+	static WPSweepConfig MakeFullSweep(int32_t maxCardVariation);
+};
+
+struct WPSweepCell
+{
+	WorkerType mAttackerType = WorkerType::Basic;
+	WorkerType mDefenderType = WorkerType::Basic;
+	int32_t mAttackerCardVariation = 0;
+	int32_t mDefenderCardVariation = 0;
+	size_t mAttackerDiceStrategy = 0;
+	size_t mDefenderDiceStrategy = 0;
+	size_t mAttackerCardStrategy = 0;
+	size_t mDefenderCardStrategy = 0;
+
+	uint64_t mSamples = 0;
+	std::array<uint64_t, +ScenarioResult::Count> mResults = {};
+	float mHalfWidth = 1.f; // Widest 95% confidence half-width over all results
+	std::array<StatsSummary, +WPSummaryIds::WinnerHealthRemaining + 1> mSummaries; // By WPSummaryIds
+
+	float GetRate(ScenarioResult result) const;
+};
+
+/**
+ * Runs every combination of the configured matchup parameters and records the outcome rates of each.
+ * Each combination is a cell. Cells are spread across a ThreadPool and sampled in batches until the 95% confidence
+ * interval of every outcome rate is within mTargetHalfWidth, or mMaxSamples is reached.
+ */
+class WPSweep
+{
+public:
+	WPSweep(const WPSweepConfig& config);
+
+	void Run(uint32_t seed);
+	bool WriteCSV(const char* const fileName) const;
+	void PrintSummary() const;
+
+	const std::vector<WPSweepCell>& GetCells() const { return mCells; }
+
+	static float GetConfidenceHalfWidth(uint64_t successes, uint64_t samples);
+
+private:
+	void RunCell(WPSweepCell& cell, uint32_t seed) const;
+
+	WPSweepConfig mConfig;
+	std::vector<WPSweepCell> mCells;
+	double mRunSeconds = 0.0;
+};
@@ -3,6 +3,16 @@
 
 #include "RNG.h"
 #include "Stats.h"
+#include "WPCatalog.h"
+
+static const std::string kWorkerTypeNames[] =
+{
+	"Basic",
+	"Trained",
+	"Warrior",
+	"Rogue"
+};
+ENUM_STRING_CONVERT_DEFINE(WorkerType, Count, kWorkerTypeNames);
 
 WPWorker::WPWorker(const RNG& rng, WPExecutionResources& executionResources, Stats* stats)
 : mRng(rng)
@@ -19,60 +29,18 @@ void WPWorker::SetWorkerType(WorkerType workerType)
 void WPWorker::SetArbitraryCardVariation(int32_t arbitraryCardVariation)
 {
 	mArbitraryCardVariation = arbitraryCardVariation;
-	mExecutionResources.ResetCardsToDefault();
-	mExecutionResources.AddCardVariation(mArbitraryCardVariation);
+	mExecutionResources.SetCardVariation(mArbitraryCardVariation);
 }
 
 void WPWorker::SetupStatsFromWorkerType()
 {
-	switch (mWorkerType)
-	{
-	case WorkerType::Basic:
-	{
-		mSkill = 0;
-		mDamage = 1;
-		mHealth_Max = 4;
-		mHold = 3;
-		mFlee = 1;
-		mStartingHandSize = 1;
-		break;
-	}
-
-	case WorkerType::Trained:
-	{
-		mSkill = 10;
-		mDamage = 2;
-		mHealth_Max = 6;
-		mHold = 4;
-		mFlee = 1;
-		mStartingHandSize = 1;
-		break;
-	}
-
-	case WorkerType::Warrior:
-	{
-		mSkill = 20;
-		mDamage = 3;
-		mHealth_Max = 8;
-		mHold = 6;
-		mFlee = 1;
-		mStartingHandSize = 1;
-		break;
-	}
-
-	case WorkerType::Rogue:
-	{
-		mSkill = 30;
-		mDamage = 2;
-		mHealth_Max = 6;
-		mHold = 4;
-		mFlee = 2;
-		mStartingHandSize = 2;
-		break;
-	}
-
-	default: break;
-	}
+	const WPWorkerStats& workerStats = WPCatalog::Get().GetWorkerStats(mWorkerType);
+	mSkill = workerStats.mSkill;
+	mDamage = workerStats.mDamage;
+	mHealth_Max = workerStats.mHealth_Max;
+	mHold = workerStats.mHold;
+	mFlee = workerStats.mFlee;
+	mStartingHandSize = workerStats.mStartingHandSize;
 }
 
 void WPWorker::PrepForCombat()
@@ -85,11 +53,8 @@ void WPWorker::PrepForCombat()
 	MoveToNextRound();
 	ClearThisRoundStats();
 
-	mCurrentDeckIndices.clear();
-	for (int32_t i = 0; i < mExecutionResources.GetNumAllCards(); ++i)
-	{
-		mCurrentDeckIndices.push_back(i);
-	}
+	mCurrentDeck = CardMasks::MakeFirstN(mExecutionResources.GetNumAllCards());
+	mCurrentHand = 0;
 	DrawCards(mStartingHandSize);
 
 	mExecutionResources.RollNOfEachDie(2);
@@ -97,7 +62,7 @@ void WPWorker::PrepForCombat()
 
 void WPWorker::ClearThisRoundStats()
 {
-	mThisRound_CardsPlayedAsIs.clear();
+	mThisRound_CardsPlayedAsIs = 0;
 	mThisRound_Skill = 0;
 	mThisRound_BonusResult = 0;
 	mThisRound_ExtraEvaluate = 0;
@@ -128,18 +93,8 @@ void WPWorker::SetCardStrategy(std::vector<CardPlayStrategy> cardPlayStrategy)
 
 void WPWorker::SetStrategyAsDefault()
 {
-	mDicePlayStrategy = {
-		DicePlayStrategy::IfExtraEvalThrowBestTens,
-		DicePlayStrategy::IfMaxHealthThrowWorst,
-		DicePlayStrategy::TensTopHalfRandom,
-		DicePlayStrategy::OnesBottomHalfRandom
-	};
-
-	mCardPlayStrategy.clear();
-	for (CardPlayStrategy cardPlayStrategy = CardPlayStrategy::First; cardPlayStrategy < CardPlayStrategy::Count; ++cardPlayStrategy)
-	{
-		mCardPlayStrategy.push_back(cardPlayStrategy);
-	}
+	mDicePlayStrategy = MakeDefaultDiceStrategy();
+	mCardPlayStrategy = MakeDefaultCardStrategy();
 }
 
 void WPWorker::DetermineCommand()
@@ -152,13 +107,9 @@ void WPWorker::DetermineCommand()
 
 	mCurrentCommand = PlayCommand::Attack;
 
-	int32_t ourTotalValue = 0;
-	int32_t maxFleeWeCanGenerate = mFlee_Current;
-	for (const DieRoll& roll : mExecutionResources.GetRemainingDice())
-	{
-		ourTotalValue += roll.mValue;
-		maxFleeWeCanGenerate += (roll.mDiceEffect == DiceEffect::ResultBonus);
-	}
+	const DicePool& remainingDice = mExecutionResources.GetRemainingDice();
+	const int32_t ourTotalValue = remainingDice.GetTotalValue();
+	int32_t maxFleeWeCanGenerate = mFlee_Current + remainingDice.CountEffect(DiceEffect::ResultBonus);
 
 	const int32_t opponentBestPossibleValue = mOpponent->GetCurrentBestPossibleTotal();
 	const int32_t delta = opponentBestPossibleValue - ourTotalValue;
@@ -222,7 +173,7 @@ WPWorker::FullRollResult WPWorker::PullDice()
 	rollResult.mTens = mExecutionResources.GetDieRoll(selectedTens);
 	rollResult.mOnes = mExecutionResources.GetDieRoll(selectedOnes);
 
-	mExecutionResources.RemoveDice({selectedOnes, selectedTens});
+	mExecutionResources.RemoveDice(selectedOnes, selectedTens);
 
 	/**
 	 * Return
@@ -231,6 +182,7 @@ WPWorker::FullRollResult WPWorker::PullDice()
 	if (mStats)
 	{
 		mStats->AddToIntDistribution(+WPStatsIds::RollValues, rollResult.mTotalValue);
+		mStats->AddToSummary(+WPSummaryIds::RollValues, (double)rollResult.mTotalValue);
 	}
 	mTotalRolls++;
 	mTotalRollValues += rollResult.mTotalValue;
@@ -244,7 +196,7 @@ void WPWorker::AddSkillBonuses(FullRollResult& inOutRollResult)
 }
 void WPWorker::PlayCards(int32_t numCards, FullRollResult& ourCurrentRoll, FullRollResult& opponentCurrentRoll)
 {
-	if ((numCards == 0) || (mCurrentHandIndices.size() == 0))
+	if ((numCards == 0) || (mCurrentHand == 0))
 	{
 		return;
 	}
@@ -255,28 +207,27 @@ void WPWorker::PlayCards(int32_t numCards, FullRollResult& ourCurrentRoll, FullR
 	for (int32_t i = 0; i < mCardPlayStrategy.size(); ++i)
 	{
 		const CardPlayStrategy cardPlayStrategy = mCardPlayStrategy[i];
-		std::vector<int32_t> cardsToPlayAsIs;
-		std::vector<int32_t> cardsToPlayAsSkillBonus;
+		CardMask cardsToPlayAsIs = 0;
+		CardMask cardsToPlayAsSkillBonus = 0;
 		EvaluateCardStrategy(cardPlayStrategy, numCards, ourCurrentRoll, opponentCurrentRoll, cardsToPlayAsIs, cardsToPlayAsSkillBonus);
 
-		int32_t cardsPlayed = 0;
+		// A card can't be played both ways
+		cardsToPlayAsSkillBonus &= ~cardsToPlayAsIs;
 
-		for (int32_t index : cardsToPlayAsIs)
+		for (CardMask remaining = cardsToPlayAsIs; remaining != 0; remaining &= remaining - 1)
 		{
-			ExecuteSingleCard(mExecutionResources.GetCard(index), ourCurrentRoll, opponentCurrentRoll);
-			mCurrentHandIndices.erase(std::find(mCurrentHandIndices.begin(), mCurrentHandIndices.end(), index));
-			cardsPlayed++;
-
-			mThisRound_CardsPlayedAsIs.push_back(index);
+			ExecuteSingleCard(mExecutionResources.GetCard(CardMasks::GetLowestIndex(remaining)), ourCurrentRoll, opponentCurrentRoll);
 		}
 
-		for (int32_t index : cardsToPlayAsSkillBonus)
+		for (CardMask remaining = cardsToPlayAsSkillBonus; remaining != 0; remaining &= remaining - 1)
 		{
-			permanentSkillIncrease += mExecutionResources.GetCard(index).mCardLevel * 10;
-			mCurrentHandIndices.erase(std::find(mCurrentHandIndices.begin(), mCurrentHandIndices.end(), index));
-			cardsPlayed++;
+			permanentSkillIncrease += mExecutionResources.GetCard(CardMasks::GetLowestIndex(remaining)).mCardLevel * 10;
 		}
 
+		const int32_t cardsPlayed = CardMasks::Count(cardsToPlayAsIs | cardsToPlayAsSkillBonus);
+		mCurrentHand &= ~(cardsToPlayAsIs | cardsToPlayAsSkillBonus);
+		mThisRound_CardsPlayedAsIs |= cardsToPlayAsIs;
+
 		if (cardsPlayed > 0)
 		{
 			numCards -= cardsPlayed;
@@ -286,7 +237,7 @@ void WPWorker::PlayCards(int32_t numCards, FullRollResult& ourCurrentRoll, FullR
 			i = -1;
 		}
 
-		if ((numCards == 0) || (mCurrentHandIndices.size() == 0))
+		if ((numCards <= 0) || (mCurrentHand == 0))
 		{
 			break;
 		}
@@ -298,11 +249,11 @@ void WPWorker::PlayCards(int32_t numCards, FullRollResult& ourCurrentRoll, FullR
 	 * Fallback Strategy if we still have cards to play
 	 * Just play random cards for permanent bonuses
 	 */
-	while ((numCards > 0) && (mCurrentHandIndices.size() > 0))
+	while ((numCards > 0) && (mCurrentHand != 0))
 	{
-		const int32_t randomIndex = mCurrentHandIndices.at(mRng.RandomIndex(mCurrentHandIndices.size()));
+		const int32_t randomIndex = CardMasks::SelectNth(mCurrentHand, (int32_t)mRng.RandomIndex(CardMasks::Count(mCurrentHand)));
 		permanentSkillIncrease += mExecutionResources.GetCard(randomIndex).mCardLevel * 10;
-		mCurrentHandIndices.erase(std::find(mCurrentHandIndices.begin(), mCurrentHandIndices.end(), randomIndex));
+		mCurrentHand &= ~CardMasks::FromIndex(randomIndex);
 		--numCards;
 		DrawCards(1);
 	}
@@ -316,11 +267,12 @@ void WPWorker::PlayCards(int32_t numCards, FullRollResult& ourCurrentRoll, FullR
 
 void WPWorker::DrawCards(int32_t numCards)
 {
-	while ((numCards > 0) && (mCurrentDeckIndices.size() > 0))
+	while ((numCards > 0) && (mCurrentDeck != 0))
 	{
-		const size_t drawnIndex = mRng.RandomIndex(mCurrentDeckIndices.size());
-		mCurrentHandIndices.push_back(mCurrentDeckIndices.at(drawnIndex));
-		mCurrentDeckIndices.erase(mCurrentDeckIndices.begin() + drawnIndex);
+		// The deck is kept in index order, so the nth set bit is the nth card in the deck
+		const int32_t drawnIndex = CardMasks::SelectNth(mCurrentDeck, (int32_t)mRng.RandomIndex(CardMasks::Count(mCurrentDeck)));
+		mCurrentDeck &= ~CardMasks::FromIndex(drawnIndex);
+		mCurrentHand |= CardMasks::FromIndex(drawnIndex);
 		--numCards;
 	}
 }
@@ -355,22 +307,12 @@ void WPWorker::IncreaseSkill(int32_t amount)
 
 int32_t WPWorker::GetCurrentWorstPossibleTotal() const
 {
-	int32_t total = 0;
-	for (const DieRoll& dieRoll : mExecutionResources.GetRemainingDice())
-	{
-		total += WPExecutionResources::MakeDieRoll(dieRoll.mDiceType, DiceFace::Worst).mValue;
-	}
-	return total;
+	return mExecutionResources.GetRemainingDice().GetWorstPossibleTotal();
 }
 
 int32_t WPWorker::GetCurrentBestPossibleTotal() const
 {
-	int32_t total = 0;
-	for (const DieRoll& dieRoll : mExecutionResources.GetRemainingDice())
-	{
-		total += WPExecutionResources::MakeDieRoll(dieRoll.mDiceType, DiceFace::Best).mValue;
-	}
-	return total;
+	return mExecutionResources.GetRemainingDice().GetBestPossibleTotal();
 }
 
 void WPWorker::PrintHealth() const
@@ -415,12 +357,9 @@ void WPWorker::PrintCurrentRound() const
 
 void WPWorker::PrintCardsPlayedThisRound() const
 {
-	if (mThisRound_CardsPlayedAsIs.size() > 0)
+	for (CardMask remaining = mThisRound_CardsPlayedAsIs; remaining != 0; remaining &= remaining - 1)
 	{
-		for (int32_t index : mThisRound_CardsPlayedAsIs)
-		{
-			printf("%s, ", mExecutionResources.GetCard(index).mCardName.c_str());
-		}
+		printf("%s, ", mExecutionResources.GetCard(CardMasks::GetLowestIndex(remaining)).mCardName.c_str());
 	}
 }
 
@@ -447,7 +386,35 @@ int32_t WPWorker::GetTotalEvaluatesThisRound() const
 
 bool WPWorker::HasPlayedCardForTheirEffectsThisRound() const
 {
-	return mThisRound_CardsPlayedAsIs.size() > 0;
+	return mThisRound_CardsPlayedAsIs != 0;
+}
+
+void WPWorker::AppendStateKey(std::string& inOutKey) const
+{
+	// Type, strategy and max health are fixed for a fight. Also left out since they can't change the rest of it:
+	// mCurrentRound is only printed, the fight ends when the dice run out. mVP is only ever written, never read.
+	// mNextRound_ExtraEvaluate is always 0 here, MoveToNextRound already moved it into mThisRound_ExtraEvaluate.
+	// The other this round stats were cleared by ClearThisRoundStats.
+	const int16_t stats[] =
+	{
+		(int16_t)mHealth_Current,
+		(int16_t)mSkill,
+		(int16_t)mDamage,
+		(int16_t)mHold,
+		(int16_t)mFlee,
+		(int16_t)mFlee_Current,
+		(int16_t)mThisRound_ExtraEvaluate
+	};
+	inOutKey.append((const char*)stats, sizeof(stats));
+	inOutKey.append((const char*)&mCurrentDeck, sizeof(mCurrentDeck));
+	inOutKey.append((const char*)&mCurrentHand, sizeof(mCurrentHand));
+
+	// Dice order matters, rankings break ties by index
+	for (const DieRoll& dieRoll : mExecutionResources.GetRemainingDice())
+	{
+		inOutKey.push_back((char)((+dieRoll.mDiceType << 4) | +dieRoll.mDiceFace));
+	}
+	inOutKey.push_back((char)mExecutionResources.GetNumRemainingDice());
 }
 
 std::vector<DiceEffect> WPWorker::MakeDiceEffectList(DiceEffect diceEffect)
@@ -460,128 +427,149 @@ std::vector<DiceEffect> WPWorker::MakeDiceEffectList(DiceEffect diceEffect)
 	return returnValue;
 }
 
-const char* WPWorker::GetWorkerTypeName(WorkerType workerType)
+std::vector<DicePlayStrategy> WPWorker::MakeDefaultDiceStrategy()
 {
-	static const char* const sNames[+WorkerType::Count] =
-	{
-		"Basic",
-		"Trained",
-		"Warrior",
-		"Rogue"
+	return {
+		DicePlayStrategy::IfExtraEvalThrowBestTens,
+		DicePlayStrategy::IfMaxHealthThrowWorst,
+		DicePlayStrategy::TensTopHalfRandom,
+		DicePlayStrategy::OnesBottomHalfRandom
 	};
-	return sNames[+workerType];
 }
 
-void WPWorker::ExecuteSingleCard(const WPCard& card, FullRollResult& ourCurrentRoll, FullRollResult& opponentCurrentRoll)
+std::vector<CardPlayStrategy> WPWorker::MakeDefaultCardStrategy()
 {
-	int32_t magnitude;
-
-	if (card.GetCardEffect(CardEffect::PermanentDamage, magnitude))
+	std::vector<CardPlayStrategy> returnValue;
+	for (CardPlayStrategy cardPlayStrategy = CardPlayStrategy::First; cardPlayStrategy < CardPlayStrategy::Count; ++cardPlayStrategy)
 	{
-		mDamage += magnitude;
+		returnValue.push_back(cardPlayStrategy);
 	}
+	return returnValue;
+}
 
-	if (card.GetCardEffect(CardEffect::PermanentHold, magnitude))
-	{
-		mHold += magnitude;
-	}
+const char* WPWorker::GetWorkerTypeName(WorkerType workerType)
+{
+	return ToString(workerType).c_str();
+}
 
-	if (card.GetCardEffect(CardEffect::PermanentFlee, magnitude))
+void WPWorker::ExecuteSingleCard(const WPCard& card, FullRollResult& ourCurrentRoll, FullRollResult& opponentCurrentRoll)
+{
+	// Only visit the effects the card has, in CardEffect order
+	for (CardEffectMask remaining = card.GetCardEffectMask(); remaining != 0; remaining &= (CardEffectMask)(remaining - 1))
 	{
-		mFlee += magnitude;
-	}
+		const CardEffect cardEffect = (CardEffect)std::countr_zero(remaining);
+		const int32_t magnitude = card.GetMagnitude(cardEffect);
 
-	if (card.GetCardEffect(CardEffect::ForceDamage, magnitude))
-	{
-		if (mOpponent)
+		switch (cardEffect)
 		{
-			DealDamage(magnitude);
+		case CardEffect::PermanentDamage:
+		{
+			mDamage += magnitude;
+			break;
 		}
-	}
-
-	if (card.GetCardEffect(CardEffect::TempSkill, magnitude))
-	{
-		mThisRound_Skill += magnitude;
-	}
-
-	if (card.GetCardEffect(CardEffect::TempBonusResult, magnitude))
-	{
-		mThisRound_BonusResult += magnitude;
-	}
-
-	if (card.GetCardEffect(CardEffect::RerollDice, magnitude))
-	{
-		// todo: Deciding which dice to reroll should be more complex than this
-		std::vector<int32_t> missingPotentialIndices = mExecutionResources.GetNHighestMissingPotentialDieRollIndexes(magnitude);
-
-		for (int32_t index : missingPotentialIndices)
+		case CardEffect::PermanentHold:
+		{
+			mHold += magnitude;
+			break;
+		}
+		case CardEffect::PermanentFlee:
+		{
+			mFlee += magnitude;
+			break;
+		}
+		case CardEffect::ForceDamage:
 		{
-			// todo: This should probably allow even fewer through
-			// but, the worker might be rerolling out of desperation (see: CardPlayStrategy::RerollInDesperation )
-			// Likely need some sort of "this turn, card intents" that the strategy function can set to feed into this
-			if (mExecutionResources.GetDieRoll(index).mMissingPotential > 0)
+			if (mOpponent)
 			{
-				mExecutionResources.RerollDie(index);
+				DealDamage(magnitude);
 			}
+			break;
 		}
-	}
-
-	if (card.GetCardEffect(CardEffect::ReplaceWithRandomEffectDice, magnitude))
-	{
-		std::vector<int32_t> reevaluatedWorstDieRollIndexes;
-		std::vector<int32_t> worstDieRollIndexes = mExecutionResources.GetNWorstDieRollIndexes(2 + magnitude);
-
-		for (int32_t index : worstDieRollIndexes)
+		case CardEffect::TempSkill:
+		{
+			mThisRound_Skill += magnitude;
+			break;
+		}
+		case CardEffect::TempBonusResult:
 		{
-			const DieRoll& dieRoll = mExecutionResources.GetDieRoll(index);
-			if ((dieRoll.mMissingPotential > 0) && (dieRoll.GetSimplePredictedValue() < 6))
+			mThisRound_BonusResult += magnitude;
+			break;
+		}
+		case CardEffect::RerollDice:
+		{
+			// todo: Deciding which dice to reroll should be more complex than this
+			const DiceIndexList missingPotentialIndices = mExecutionResources.GetNHighestMissingPotentialDieRollIndexes(magnitude);
+
+			for (int32_t index : missingPotentialIndices)
 			{
-				reevaluatedWorstDieRollIndexes.push_back(index);
+				// todo: This should probably allow even fewer through
+				// but, the worker might be rerolling out of desperation (see: CardPlayStrategy::RerollInDesperation )
+				// Likely need some sort of "this turn, card intents" that the strategy function can set to feed into this
+				if (mExecutionResources.GetDieRoll(index).mMissingPotential > 0)
+				{
+					mExecutionResources.RerollDie(index);
+				}
 			}
+			break;
 		}
-
-		for (int32_t index : reevaluatedWorstDieRollIndexes)
+		case CardEffect::ReplaceWithRandomEffectDice:
 		{
-			mExecutionResources.ReplaceDie(index, DiceType::RandomEffect);
-		}
-	}
+			DiceIndexList reevaluatedWorstDieRollIndexes;
+			const DiceIndexList worstDieRollIndexes = mExecutionResources.GetNWorstDieRollIndexes(2 + magnitude);
 
-	if (card.GetCardEffect(CardEffect::ExtraEvaluate, magnitude))
-	{
-		mNextRound_ExtraEvaluate += magnitude;
-	}
+			for (int32_t index : worstDieRollIndexes)
+			{
+				const DieRoll& dieRoll = mExecutionResources.GetDieRoll(index);
+				if ((dieRoll.mMissingPotential > 0) && (dieRoll.GetSimplePredictedValue() < 6))
+				{
+					reevaluatedWorstDieRollIndexes.PushBack(index);
+				}
+			}
 
-	if (card.GetCardEffect(CardEffect::Heal, magnitude))
-	{
-		mHealth_Current += magnitude;
-		if (mHealth_Current > mHealth_Max)
+			for (int32_t index : reevaluatedWorstDieRollIndexes)
+			{
+				mExecutionResources.ReplaceDie(index, DiceType::RandomEffect);
+			}
+			break;
+		}
+		case CardEffect::ExtraEvaluate:
 		{
-			mHealth_Current = mHealth_Max;
+			mNextRound_ExtraEvaluate += magnitude;
+			break;
 		}
-	}
-
-	if (card.GetCardEffect(CardEffect::SwapOpponentDice, magnitude))
-	{
-		if (opponentCurrentRoll.mOnes.mValue < opponentCurrentRoll.mTens.mValue)
+		case CardEffect::Heal:
 		{
-			opponentCurrentRoll.SwapDice();
+			mHealth_Current += magnitude;
+			if (mHealth_Current > mHealth_Max)
+			{
+				mHealth_Current = mHealth_Max;
+			}
+			break;
 		}
-	}
-
-	if (card.GetCardEffect(CardEffect::StealVP, magnitude))
-	{
-		const DieRoll oldOnes = opponentCurrentRoll.mOnes;
-
-		if (mOpponent)
+		case CardEffect::SwapOpponentDice:
 		{
-			mOpponent->mVP -= magnitude;
-			mVP += magnitude;
+			if (opponentCurrentRoll.mOnes.mValue < opponentCurrentRoll.mTens.mValue)
+			{
+				opponentCurrentRoll.SwapDice();
+			}
+			break;
+		}
+		case CardEffect::StealVP:
+		{
+			if (mOpponent)
+			{
+				mOpponent->mVP -= magnitude;
+				mVP += magnitude;
+			}
+			break;
+		}
+		case CardEffect::DrawCard:
+		{
+			DrawCards(magnitude);
+			break;
+		}
+		default: break;
 		}
-	}
-
-	if (card.GetCardEffect(CardEffect::DrawCard, magnitude))
-	{
-		DrawCards(magnitude);
 	}
 }
 
@@ -593,8 +581,8 @@ void WPWorker::EvaluateDiceStrategy(DicePlayStrategy strategy, int32_t& inOutTen
 	{
 		if (GetTotalEvaluatesThisRound() > 1)
 		{
-			if (inOutOnesDigit == -1) { inOutOnesDigit = mExecutionResources.GetNBestDieRollIndexes(1, inOutTensDigit)[0]; }
-			if (inOutTensDigit == -1) { inOutTensDigit = mExecutionResources.GetNBestDieRollIndexes(1, inOutOnesDigit)[0]; }
+			if (inOutOnesDigit == -1) { inOutOnesDigit = mExecutionResources.GetBestDieRollIndex(inOutTensDigit); }
+			if (inOutTensDigit == -1) { inOutTensDigit = mExecutionResources.GetBestDieRollIndex(inOutOnesDigit); }
 		}
 		break;
 	}
@@ -602,7 +590,7 @@ void WPWorker::EvaluateDiceStrategy(DicePlayStrategy strategy, int32_t& inOutTen
 	{
 		if (GetTotalEvaluatesThisRound() > 1)
 		{
-			if (inOutTensDigit == -1) { inOutTensDigit = mExecutionResources.GetNBestDieRollIndexes(1, inOutOnesDigit)[0]; }
+			if (inOutTensDigit == -1) { inOutTensDigit = mExecutionResources.GetBestDieRollIndex(inOutOnesDigit); }
 		}
 		break;
 	}
@@ -610,8 +598,8 @@ void WPWorker::EvaluateDiceStrategy(DicePlayStrategy strategy, int32_t& inOutTen
 	{
 		if (mHealth_Current == mHealth_Max)
 		{
-			if (inOutOnesDigit == -1) { inOutOnesDigit = mExecutionResources.GetNWorstDieRollIndexes(1, inOutTensDigit)[0]; }
-			if (inOutTensDigit == -1) { inOutTensDigit = mExecutionResources.GetNWorstDieRollIndexes(1, inOutOnesDigit)[0]; }
+			if (inOutOnesDigit == -1) { inOutOnesDigit = mExecutionResources.GetWorstDieRollIndex(inOutTensDigit); }
+			if (inOutTensDigit == -1) { inOutTensDigit = mExecutionResources.GetWorstDieRollIndex(inOutOnesDigit); }
 		}
 		break;
 	}
@@ -628,7 +616,7 @@ void WPWorker::EvaluateDiceStrategy(DicePlayStrategy strategy, int32_t& inOutTen
 	}
 	case DicePlayStrategy::TensTopOrdered:
 	{
-		if (inOutTensDigit == -1) { inOutTensDigit = mExecutionResources.GetNBestDieRollIndexes(1, inOutOnesDigit)[0]; }
+		if (inOutTensDigit == -1) { inOutTensDigit = mExecutionResources.GetBestDieRollIndex(inOutOnesDigit); }
 		break;
 	}
 	case DicePlayStrategy::OnesBottomHalfRandom:
@@ -638,16 +626,16 @@ void WPWorker::EvaluateDiceStrategy(DicePlayStrategy strategy, int32_t& inOutTen
 	}
 	case DicePlayStrategy::OnesBottomOrdered:
 	{
-		if (inOutOnesDigit == -1) { inOutOnesDigit = mExecutionResources.GetNWorstDieRollIndexes(1, inOutTensDigit)[0]; }
+		if (inOutOnesDigit == -1) { inOutOnesDigit = mExecutionResources.GetWorstDieRollIndex(inOutTensDigit); }
 		break;
 	}
 	default: break;
 	}
 }
 
-void WPWorker::EvaluateCardStrategy(CardPlayStrategy cardPlayStrategy, int32_t numCards, const FullRollResult& ourCurrentRoll, const FullRollResult& opponentCurrentRoll, std::vector<int32_t>& outCardsToPlayAsIs, std::vector<int32_t>& outCardsToPlayAsSkillBonus)
+void WPWorker::EvaluateCardStrategy(CardPlayStrategy cardPlayStrategy, int32_t numCards, const FullRollResult& ourCurrentRoll, const FullRollResult& opponentCurrentRoll, CardMask& outCardsToPlayAsIs, CardMask& outCardsToPlayAsSkillBonus)
 {
-	std::vector<int32_t> indexesToPlay;
+	CardMask cardsToPlay = 0;
 	const int32_t roundsRemaining = (int32_t)mExecutionResources.GetNumRemainingCombatRounds();
 
 	int32_t ourDamage = (mCurrentCommand == PlayCommand::Attack ? mDamage + ourCurrentRoll.CountEffects(DiceEffect::ResultBonus) : 0);
@@ -668,31 +656,31 @@ void WPWorker::EvaluateCardStrategy(CardPlayStrategy cardPlayStrategy, int32_t n
 	default: break;
 	case CardPlayStrategy::UseGuaranteedKill:
 	{
-		std::vector<int32_t> forceDamageOnlyIndexesToPlay;
+		CardMask forceDamageOnlyCardsToPlay = 0;
 		int32_t potentialDamage = 0;
 
 		// Force Damage can still happen even if we're Fleeing
-		const int32_t forceDamage = GetMaxMagnitudeOfCardEffectInHand(CardEffect::ForceDamage, numCards, forceDamageOnlyIndexesToPlay);
+		const int32_t forceDamage = GetMaxMagnitudeOfCardEffectInHand(CardEffect::ForceDamage, numCards, forceDamageOnlyCardsToPlay);
 		if (forceDamage >= mOpponent->mHealth_Current)
 		{
-			outCardsToPlayAsIs = forceDamageOnlyIndexesToPlay;
+			outCardsToPlayAsIs = forceDamageOnlyCardsToPlay;
 			break;
 		}
 
 		if ((mCurrentCommand == PlayCommand::Attack) && (ourDamage < mOpponent->mHealth_Current))
 		{
-			indexesToPlay = forceDamageOnlyIndexesToPlay;
+			cardsToPlay = forceDamageOnlyCardsToPlay;
 			potentialDamage += forceDamage;
 
 			if (ourCurrentRoll.mTotalValue > opponentMaybeValue)
 			{
-				potentialDamage += GetMaxMagnitudeOfCardEffectInHand(CardEffect::PermanentDamage, numCards - (int32_t)indexesToPlay.size(), indexesToPlay);
-				potentialDamage += GetMaxMagnitudeOfCardEffectInHand(CardEffect::TempBonusResult, numCards - (int32_t)indexesToPlay.size(), indexesToPlay);
+				potentialDamage += GetMaxMagnitudeOfCardEffectInHand(CardEffect::PermanentDamage, numCards - CardMasks::Count(cardsToPlay), cardsToPlay);
+				potentialDamage += GetMaxMagnitudeOfCardEffectInHand(CardEffect::TempBonusResult, numCards - CardMasks::Count(cardsToPlay), cardsToPlay);
 			}
 
 			if ((ourDamage + potentialDamage) >= mOpponent->mHealth_Current)
 			{
-				outCardsToPlayAsIs = indexesToPlay;
+				outCardsToPlayAsIs = cardsToPlay;
 				break;
 			}
 		}
@@ -702,18 +690,19 @@ void WPWorker::EvaluateCardStrategy(CardPlayStrategy cardPlayStrategy, int32_t n
 	{
 		if (ourCurrentRoll.mTotalValue < opponentMaybeValue)
 		{
-			const int32_t potentialAddedSkill = GetMaxLevelOfCardsInHand(numCards, indexesToPlay) * 10;
+			const int32_t potentialAddedSkill = GetMaxLevelOfCardsInHand(numCards, cardsToPlay) * 10;
 			if ((ourCurrentRoll.mTotalValue + potentialAddedSkill) >= opponentMaybeValue)
 			{
-				outCardsToPlayAsSkillBonus = indexesToPlay;
+				outCardsToPlayAsSkillBonus = cardsToPlay;
 				break;
 			}
 
-			if (GetMaxMagnitudeOfCardEffectInHand(CardEffect::SwapOpponentDice, numCards, indexesToPlay) > 0)
+			cardsToPlay = 0;
+			if (GetMaxMagnitudeOfCardEffectInHand(CardEffect::SwapOpponentDice, numCards, cardsToPlay) > 0)
 			{
 				if (ourCurrentRoll.mTotalValue >= opponentCurrentRoll.GetTotalValueIfDiceSwapped())
 				{
-					outCardsToPlayAsIs = indexesToPlay;
+					outCardsToPlayAsIs = cardsToPlay;
 					break;
 				}
 			}
@@ -724,10 +713,10 @@ void WPWorker::EvaluateCardStrategy(CardPlayStrategy cardPlayStrategy, int32_t n
 	{
 		if ((ourCurrentRoll.mTotalValue < opponentMaybeValue) && (opponentDamage >= mHealth_Current))
 		{
-			const int32_t potentialAddedSkill = GetMaxMagnitudeOfCardEffectInHand(CardEffect::TempSkill, numCards, indexesToPlay);
+			const int32_t potentialAddedSkill = GetMaxMagnitudeOfCardEffectInHand(CardEffect::TempSkill, numCards, cardsToPlay);
 			if ((ourCurrentRoll.mTotalValue + potentialAddedSkill) >= opponentMaybeValue)
 			{
-				outCardsToPlayAsIs = indexesToPlay;
+				outCardsToPlayAsIs = cardsToPlay;
 			}
 		}
 		break;
@@ -736,20 +725,20 @@ void WPWorker::EvaluateCardStrategy(CardPlayStrategy cardPlayStrategy, int32_t n
 	{
 		if ((ourCurrentRoll.mTotalValue < opponentMaybeValue) && (ourDamage >= mOpponent->mHealth_Current))
 		{
-			const int32_t potentialAddedSkill = GetMaxMagnitudeOfCardEffectInHand(CardEffect::TempSkill, numCards, indexesToPlay);
+			const int32_t potentialAddedSkill = GetMaxMagnitudeOfCardEffectInHand(CardEffect::TempSkill, numCards, cardsToPlay);
 			if ((ourCurrentRoll.mTotalValue + potentialAddedSkill) >= opponentMaybeValue)
 			{
-				outCardsToPlayAsIs = indexesToPlay;
+				outCardsToPlayAsIs = cardsToPlay;
 			}
 		}
 		break;
 	}
 	case CardPlayStrategy::PermanentDamageIfDiceAreStrong:
 	{
-		if (GetMaxMagnitudeOfCardEffectInHand(CardEffect::PermanentDamage, numCards, indexesToPlay) > 0)
+		if (GetMaxMagnitudeOfCardEffectInHand(CardEffect::PermanentDamage, numCards, cardsToPlay) > 0)
 		{
 			float strengthScore = 0.f;
-			std::vector<int32_t> bestDieRollsRemaining = mExecutionResources.GetNBestDieRollIndexes(roundsRemaining);
+			const DiceIndexList bestDieRollsRemaining = mExecutionResources.GetNBestDieRollIndexes(roundsRemaining);
 			for (int32_t index : bestDieRollsRemaining)
 			{
 				if (mExecutionResources.GetDieRoll(index).mValue > 6)
@@ -769,7 +758,7 @@ void WPWorker::EvaluateCardStrategy(CardPlayStrategy cardPlayStrategy, int32_t n
 
 			if (strengthScore >= 8.0f)
 			{
-				outCardsToPlayAsIs = indexesToPlay;
+				outCardsToPlayAsIs = cardsToPlay;
 			}
 		}
 		break;
@@ -778,10 +767,10 @@ void WPWorker::EvaluateCardStrategy(CardPlayStrategy cardPlayStrategy, int32_t n
 	{
 		if ((roundsRemaining > 0) && mOpponent)
 		{
-			const int32_t extraEvals = GetMaxMagnitudeOfCardEffectInHand(CardEffect::ExtraEvaluate, numCards, indexesToPlay);
+			const int32_t extraEvals = GetMaxMagnitudeOfCardEffectInHand(CardEffect::ExtraEvaluate, numCards, cardsToPlay);
 			if (extraEvals > 0 && CanLikelyWinAgainst(DiceFace::Best))
 			{
-				outCardsToPlayAsIs = indexesToPlay;
+				outCardsToPlayAsIs = cardsToPlay;
 			}
 		}
 		break;
@@ -790,10 +779,10 @@ void WPWorker::EvaluateCardStrategy(CardPlayStrategy cardPlayStrategy, int32_t n
 	{
 		if (mHealth_Current < mHealth_Max)
 		{
-			const int32_t potentialHeal = GetMaxMagnitudeOfCardEffectInHand(CardEffect::Heal, numCards, indexesToPlay);
+			const int32_t potentialHeal = GetMaxMagnitudeOfCardEffectInHand(CardEffect::Heal, numCards, cardsToPlay);
 			if (potentialHeal > 0)
 			{
-				outCardsToPlayAsIs = indexesToPlay;
+				outCardsToPlayAsIs = cardsToPlay;
 			}
 		}
 		break;
@@ -802,11 +791,11 @@ void WPWorker::EvaluateCardStrategy(CardPlayStrategy cardPlayStrategy, int32_t n
 	{
 		if (roundsRemaining > 0)
 		{
-			const int32_t potentialReplaces = GetMaxMagnitudeOfCardEffectInHand(CardEffect::ReplaceWithRandomEffectDice, numCards, indexesToPlay);
+			const int32_t potentialReplaces = GetMaxMagnitudeOfCardEffectInHand(CardEffect::ReplaceWithRandomEffectDice, numCards, cardsToPlay);
 			if (potentialReplaces > 0)
 			{
 				bool hasValidCardToReplace = false;
-				std::vector<int32_t> worstDieRollIndexes = mExecutionResources.GetNWorstDieRollIndexes(2 + potentialReplaces);
+				const DiceIndexList worstDieRollIndexes = mExecutionResources.GetNWorstDieRollIndexes(2 + potentialReplaces);
 				for (int32_t index : worstDieRollIndexes)
 				{
 					const DieRoll& dieRoll = mExecutionResources.GetDieRoll(index);
@@ -819,7 +808,7 @@ void WPWorker::EvaluateCardStrategy(CardPlayStrategy cardPlayStrategy, int32_t n
 
 				if (hasValidCardToReplace)
 				{
-					outCardsToPlayAsIs = indexesToPlay;
+					outCardsToPlayAsIs = cardsToPlay;
 				}
 			}
 		}
@@ -829,7 +818,7 @@ void WPWorker::EvaluateCardStrategy(CardPlayStrategy cardPlayStrategy, int32_t n
 	{
 		if (roundsRemaining > 0)
 		{
-			const int32_t diceRerolls = GetMaxMagnitudeOfCardEffectInHand(CardEffect::RerollDice, numCards, indexesToPlay);
+			const int32_t diceRerolls = GetMaxMagnitudeOfCardEffectInHand(CardEffect::RerollDice, numCards, cardsToPlay);
 			if (diceRerolls > 0)
 			{
 				int32_t diceWithHighMissingPotential = CountDiceWithMissingPotentialNOrHigher(3);
@@ -837,12 +826,12 @@ void WPWorker::EvaluateCardStrategy(CardPlayStrategy cardPlayStrategy, int32_t n
 				if (diceWithHighMissingPotential > 0)
 				{
 					const int32_t maxPotential = std::min(diceWithHighMissingPotential, diceRerolls);
-					std::vector<int32_t> indexesOfPlayAsPermanent;
-					const int32_t levelOfPlayableCards = GetMaxLevelOfCardsInHand(numCards, indexesOfPlayAsPermanent);
+					CardMask cardsToPlayAsPermanent = 0;
+					const int32_t levelOfPlayableCards = GetMaxLevelOfCardsInHand(numCards, cardsToPlayAsPermanent);
 
 					if (maxPotential > levelOfPlayableCards)
 					{
-						outCardsToPlayAsIs = indexesToPlay;
+						outCardsToPlayAsIs = cardsToPlay;
 					}
 				}
 			}
@@ -853,10 +842,10 @@ void WPWorker::EvaluateCardStrategy(CardPlayStrategy cardPlayStrategy, int32_t n
 	{
 		if ((roundsRemaining > 0) && mOpponent)
 		{
-			const int32_t extraEvals = GetMaxMagnitudeOfCardEffectInHand(CardEffect::ExtraEvaluate, numCards, indexesToPlay);
+			const int32_t extraEvals = GetMaxMagnitudeOfCardEffectInHand(CardEffect::ExtraEvaluate, numCards, cardsToPlay);
 			if (extraEvals > 0 && CanLikelyWinAgainst(DiceFace::Good))
 			{
-				outCardsToPlayAsIs = indexesToPlay;
+				outCardsToPlayAsIs = cardsToPlay;
 			}
 		}
 		break;
@@ -865,7 +854,7 @@ void WPWorker::EvaluateCardStrategy(CardPlayStrategy cardPlayStrategy, int32_t n
 	{
 		if ((roundsRemaining > 0) && mOpponent)
 		{
-			const int32_t diceRerolls = GetMaxMagnitudeOfCardEffectInHand(CardEffect::RerollDice, numCards, indexesToPlay);
+			const int32_t diceRerolls = GetMaxMagnitudeOfCardEffectInHand(CardEffect::RerollDice, numCards, cardsToPlay);
 			if (diceRerolls > 0 && !CanLikelyWinAgainst(DiceFace::Worst))
 			{
 				int32_t diceWithAnyMissingPotential = CountDiceWithMissingPotentialNOrHigher(1);
@@ -873,12 +862,12 @@ void WPWorker::EvaluateCardStrategy(CardPlayStrategy cardPlayStrategy, int32_t n
 				if (diceWithAnyMissingPotential > 0)
 				{
 					const int32_t maxAnyPotential = std::min(diceWithAnyMissingPotential, diceRerolls);
-					std::vector<int32_t> indexesOfPlayAsPermanent;
-					const int32_t levelOfPlayableCards = GetMaxLevelOfCardsInHand(numCards, indexesOfPlayAsPermanent);
+					CardMask cardsToPlayAsPermanent = 0;
+					const int32_t levelOfPlayableCards = GetMaxLevelOfCardsInHand(numCards, cardsToPlayAsPermanent);
 
 					if (maxAnyPotential > levelOfPlayableCards)
 					{
-						outCardsToPlayAsIs = indexesToPlay;
+						outCardsToPlayAsIs = cardsToPlay;
 					}
 				}
 			}
@@ -889,14 +878,14 @@ void WPWorker::EvaluateCardStrategy(CardPlayStrategy cardPlayStrategy, int32_t n
 	{
 		if (roundsRemaining > 0 && (mExecutionResources.GetFirstRemainingDiceIndexWithEffect(DiceEffect::PlayCard) != -1))
 		{
-			int32_t drawsAvailable = GetMaxMagnitudeOfCardEffectInHand(CardEffect::DrawCard, numCards, indexesToPlay);
-			drawsAvailable = std::min(drawsAvailable, (int32_t)mCurrentDeckIndices.size());
+			int32_t drawsAvailable = GetMaxMagnitudeOfCardEffectInHand(CardEffect::DrawCard, numCards, cardsToPlay);
+			drawsAvailable = std::min(drawsAvailable, CardMasks::Count(mCurrentDeck));
 			if (drawsAvailable > 0)
 			{
 				const int32_t diceWithLowMissingPotential = CountDiceWithMissingPotentialNOrLower(0);
 				if (diceWithLowMissingPotential >= roundsRemaining)
 				{
-					outCardsToPlayAsIs = indexesToPlay;
+					outCardsToPlayAsIs = cardsToPlay;
 				}
 			}
 		}
@@ -907,7 +896,7 @@ void WPWorker::EvaluateCardStrategy(CardPlayStrategy cardPlayStrategy, int32_t n
 
 bool WPWorker::CanLikelyWinAgainst(DiceFace diceFaceComparison) const
 {
-	const int32_t ourPredictedValue = mExecutionResources.GetDieRoll(mExecutionResources.GetNBestDieRollIndexes(GetExecutionResources().GetNumRemainingDice())[0]).GetSimplePredictedValue();
+	const int32_t ourPredictedValue = mExecutionResources.GetDieRoll(mExecutionResources.GetBestDieRollIndex()).GetSimplePredictedValue();
 
 	for (const DieRoll& opponentDieRoll : mOpponent->GetExecutionResources().GetRemainingDice())
 	{
@@ -920,7 +909,7 @@ bool WPWorker::CanLikelyWinAgainst(DiceFace diceFaceComparison) const
 	return true;
 }
 
-int32_t WPWorker::GetRandomIndexFromList(std::vector<int32_t> list) const
+int32_t WPWorker::GetRandomIndexFromList(std::span<const int32_t> list) const
 {
 	if (list.size() < 1)
 	{
@@ -929,86 +918,103 @@ int32_t WPWorker::GetRandomIndexFromList(std::vector<int32_t> list) const
 	return list[mRng.RandomIndex(list.size())];
 }
 
-int32_t WPWorker::GetMaxMagnitudeOfCardEffectInHand(CardEffect cardEffect, int32_t numCards, std::vector<int32_t>& inOutIndexesOfMax) const
+int32_t WPWorker::GetMaxMagnitudeOfCardEffectInHand(CardEffect cardEffect, int32_t numCards, CardMask& inOutCardsOfMax) const
 {
-	if (numCards <= 0)
+	const CardMask candidates = mCurrentHand & mExecutionResources.GetCardsWithEffect(cardEffect) & ~inOutCardsOfMax;
+	const int32_t deckMaxMagnitude = mExecutionResources.GetMaxCardMagnitude(cardEffect);
+	if ((candidates == 0) || (deckMaxMagnitude <= 0))
 	{
 		return 0;
 	}
-	std::vector<std::pair<int32_t, int32_t>> indexToMagnitudePairs;
 
-	for (int32_t index : mCurrentHandIndices)
+	// Asking for one card is the usual case. The first card with the deck's highest magnitude can't be beaten, and is the
+	// one SelectHighestCards keeps on ties, so stop there
+	if (numCards == 1)
 	{
-		const WPCard& card = mExecutionResources.GetCard(index);
-		int32_t magnitude;
-		if (card.GetCardEffect(cardEffect, magnitude))
+		for (CardMask remaining = candidates; remaining != 0; remaining &= remaining - 1)
 		{
-			if (indexToMagnitudePairs.size() == numCards)
+			const int32_t index = CardMasks::GetLowestIndex(remaining);
+			if (mExecutionResources.GetCard(index).GetMagnitude(cardEffect) == deckMaxMagnitude)
 			{
-				auto iter = std::find_if(indexToMagnitudePairs.begin(), indexToMagnitudePairs.end(), [magnitude](const std::pair<int32_t, int32_t>& pair)
-				{
-					return pair.second < magnitude;
-				});
-
-				if (iter != indexToMagnitudePairs.end())
-				{
-					indexToMagnitudePairs.erase(iter);
-					indexToMagnitudePairs.emplace_back(index, magnitude);
-				}
-			}
-			else
-			{
-				indexToMagnitudePairs.emplace_back(index, magnitude);
+				inOutCardsOfMax |= CardMasks::FromIndex(index);
+				return deckMaxMagnitude;
 			}
 		}
 	}
 
+	std::array<int32_t, cMaxCardsPerDeck> magnitudes;
+	for (CardMask remaining = candidates; remaining != 0; remaining &= remaining - 1)
+	{
+		const int32_t index = CardMasks::GetLowestIndex(remaining);
+		magnitudes[index] = mExecutionResources.GetCard(index).GetMagnitude(cardEffect);
+	}
+
+	const CardMask chosen = SelectHighestCards(candidates, magnitudes, numCards);
 	int32_t totalMagnitude = 0;
-	for (const std::pair<int32_t, int32_t>& pair : indexToMagnitudePairs)
+	for (CardMask remaining = chosen; remaining != 0; remaining &= remaining - 1)
 	{
-		inOutIndexesOfMax.push_back(pair.first);
-		totalMagnitude += pair.second;
+		totalMagnitude += magnitudes[CardMasks::GetLowestIndex(remaining)];
 	}
+
+	inOutCardsOfMax |= chosen;
 	return totalMagnitude;
 }
 
-int32_t WPWorker::GetMaxLevelOfCardsInHand(int32_t numCards, std::vector<int32_t>& outIndexesOfMax) const
+int32_t WPWorker::GetMaxLevelOfCardsInHand(int32_t numCards, CardMask& outCardsOfMax) const
 {
-	outIndexesOfMax.clear();
-	if (numCards == 0)
+	std::array<int32_t, cMaxCardsPerDeck> levels;
+	for (CardMask remaining = mCurrentHand; remaining != 0; remaining &= remaining - 1)
 	{
-		return 0;
+		const int32_t index = CardMasks::GetLowestIndex(remaining);
+		levels[index] = mExecutionResources.GetCard(index).mCardLevel;
 	}
-	std::vector<std::pair<int32_t, int32_t>> indexToLevelsPairs;
-	for (int32_t index : mCurrentHandIndices)
+
+	outCardsOfMax = SelectHighestCards(mCurrentHand, levels, numCards);
+	int32_t totalLevel = 0;
+	for (CardMask remaining = outCardsOfMax; remaining != 0; remaining &= remaining - 1)
 	{
-		const WPCard& card = mExecutionResources.GetCard(index);
-		if (indexToLevelsPairs.size() == numCards)
+		totalLevel += levels[CardMasks::GetLowestIndex(remaining)];
+	}
+	return totalLevel;
+}
+
+/*static*/ CardMask WPWorker::SelectHighestCards(CardMask candidates, const std::array<int32_t, cMaxCardsPerDeck>& scores, int32_t numCards)
+{
+	// Up to numCards of the candidates with the highest positive scores. When full, a higher score evicts the current lowest
+	CardMask chosen = 0;
+	int32_t numChosen = 0;
+	for (CardMask remaining = candidates; remaining != 0; remaining &= remaining - 1)
+	{
+		const int32_t index = CardMasks::GetLowestIndex(remaining);
+		if (scores[index] <= 0)
 		{
-			auto iter = std::find_if(indexToLevelsPairs.begin(), indexToLevelsPairs.end(), [&card](const std::pair<int32_t, int32_t>& pair)
-				{
-					return pair.second < card.mCardLevel;
-				});
+			continue;
+		}
+
+		if (numChosen < numCards)
+		{
+			chosen |= CardMasks::FromIndex(index);
+			numChosen++;
+			continue;
+		}
 
-			if (iter != indexToLevelsPairs.end())
+		int32_t lowestIndex = -1;
+		for (CardMask chosenRemaining = chosen; chosenRemaining != 0; chosenRemaining &= chosenRemaining - 1)
+		{
+			const int32_t chosenIndex = CardMasks::GetLowestIndex(chosenRemaining);
+			if ((lowestIndex == -1) || (scores[chosenIndex] < scores[lowestIndex]))
 			{
-				indexToLevelsPairs.erase(iter);
-				indexToLevelsPairs.emplace_back(index, card.mCardLevel);
+				lowestIndex = chosenIndex;
 			}
 		}
-		else
+
+		if ((lowestIndex != -1) && (scores[lowestIndex] < scores[index]))
 		{
-			indexToLevelsPairs.emplace_back(index, card.mCardLevel);
+			chosen &= ~CardMasks::FromIndex(lowestIndex);
+			chosen |= CardMasks::FromIndex(index);
 		}
 	}
-
-	int32_t totalLevel = 0;
-	for (const std::pair<int32_t, int32_t>& pair : indexToLevelsPairs)
-	{
-		outIndexesOfMax.push_back(pair.first);
-		totalLevel += pair.second;
-	}
-	return totalLevel;
+	return chosen;
 }
 
 int32_t WPWorker::CountDiceWithMissingPotentialNOrHigher(int32_t threshold) const
@@ -21,10 +21,11 @@ enum class WorkerType : uint8_t
 	Warrior,
 	Rogue,
 
-	// WPWorker::SetupStatsFromWorkerType and WPWorker::GetWorkerTypeName needs to be updated if changed here
+	// kWorkerTypeNames and the #Workers section of Data/WPCatalog.txt need to be updated if changed here
 	Count
 };
 ENUM_OPS(WorkerType);
+ENUM_STRING_CONVERT_DECLARE(WorkerType);
 
 enum class PlayCommand : uint8_t
 {
@@ -130,23 +131,28 @@ public:
 	WorkerType GetWorkerType() const { return mWorkerType; }
 	WorkerRole GetWorkerRole() const { return mWorkerRole; }
 	int32_t GetWorkerSkill() const { return mSkill; }
+	int32_t GetHealth() const { return mHealth_Current; }
 	float GetTotalAverageRollValue() const;
 	int32_t GetTotalEvaluatesThisRound() const;
 	bool HasPlayedCardForTheirEffectsThisRound() const;
+	void AppendStateKey(std::string& inOutKey) const; // Everything that can change the rest of a fight from the start of a round
 
 	static std::vector<DiceEffect> MakeDiceEffectList(DiceEffect diceEffect);
+	static std::vector<DicePlayStrategy> MakeDefaultDiceStrategy();
+	static std::vector<CardPlayStrategy> MakeDefaultCardStrategy();
 	static const char* GetWorkerTypeName(WorkerType workerType);
 
 	const WPExecutionResources& GetExecutionResources() const { return mExecutionResources; }
 private:
 	void ExecuteSingleCard(const WPCard& card, FullRollResult& ourCurrentRoll, FullRollResult& opponentCurrentRoll);
 	void EvaluateDiceStrategy(DicePlayStrategy strategy, int32_t& inOutTensDigit, int32_t& inOutOnesDigit) const;
-	void EvaluateCardStrategy(CardPlayStrategy cardPlayStrategy, int32_t numCards, const FullRollResult& ourCurrentRoll, const FullRollResult& opponentCurrentRoll, std::vector<int32_t>& outCardsToPlayAsIs, std::vector<int32_t>& outCardsToPlayAsSkillBonus);
+	void EvaluateCardStrategy(CardPlayStrategy cardPlayStrategy, int32_t numCards, const FullRollResult& ourCurrentRoll, const FullRollResult& opponentCurrentRoll, CardMask& outCardsToPlayAsIs, CardMask& outCardsToPlayAsSkillBonus);
 	bool CanLikelyWinAgainst(DiceFace diceFaceComparison) const;
 
-	int32_t GetRandomIndexFromList(std::vector<int32_t> list) const;
-	int32_t GetMaxMagnitudeOfCardEffectInHand(CardEffect cardEffect, int32_t numCards, std::vector<int32_t>& inOutIndexesOfMax) const;
-	int32_t GetMaxLevelOfCardsInHand(int32_t numCards, std::vector<int32_t>& outIndexesOfMax) const;
+	int32_t GetRandomIndexFromList(std::span<const int32_t> list) const;
+	int32_t GetMaxMagnitudeOfCardEffectInHand(CardEffect cardEffect, int32_t numCards, CardMask& inOutCardsOfMax) const; // Only considers cards not already in inOutCardsOfMax
+	int32_t GetMaxLevelOfCardsInHand(int32_t numCards, CardMask& outCardsOfMax) const;
+	static CardMask SelectHighestCards(CardMask candidates, const std::array<int32_t, cMaxCardsPerDeck>& scores, int32_t numCards);
 	int32_t CountDiceWithMissingPotentialNOrHigher(int32_t threshold) const;
 	int32_t CountDiceWithMissingPotentialNOrLower(int32_t threshold) const;
 
@@ -158,11 +164,10 @@ private:
 	WorkerType mWorkerType = WorkerType::Basic;
 
 	WPExecutionResources& mExecutionResources;
-	std::vector<WPCard> mAllAvailableCards;
 
 	PlayCommand mCurrentCommand = PlayCommand::Attack;
-	std::vector<int32_t> mCurrentDeckIndices;
-	std::vector<int32_t> mCurrentHandIndices;
+	CardMask mCurrentDeck = 0;
+	CardMask mCurrentHand = 0;
 
 	/**
 	 * Persists over Executions
@@ -188,7 +193,7 @@ private:
 	 */
 	int32_t mCurrentRound = 0;
 
-	std::vector<int32_t> mThisRound_CardsPlayedAsIs;
+	CardMask mThisRound_CardsPlayedAsIs = 0;
 	int32_t mThisRound_Skill = 0;
 	int32_t mThisRound_BonusResult = 0;
 	int32_t mThisRound_ExtraEvaluate = 0;